@@ -1,71 +1,136 @@
 #include "bufferedreader.h"
 
 #include <stdexcept>
-#include <array>
 #include <algorithm>
+#include <cctype>
+#include <cstring>
 
 namespace serial {
 
+namespace {
+std::size_t roundUpPow2(std::size_t n) {
+    std::size_t p = 64;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+}
+
+BufferedReader::BufferedReader(Device &device, std::size_t capacity)
+    : buffer_(roundUpPow2(capacity)), mask_(buffer_.size() - 1), device_(device) {}
+
+void BufferedReader::copyOut(char *out, std::size_t amount) const noexcept {
+    std::size_t start = head_ & mask_;
+    std::size_t first = std::min(amount, buffer_.size() - start);
+    std::memcpy(out, buffer_.data() + start, first);
+    std::memcpy(out + first, buffer_.data(), amount - first);
+}
+
+void BufferedReader::grow() {
+    std::vector<char> larger(buffer_.size() * 2);
+    std::size_t amount = size();
+    copyOut(larger.data(), amount);
+    buffer_ = std::move(larger);
+    mask_ = buffer_.size() - 1;
+    head_ = 0;
+    tail_ = amount;
+}
 
 void BufferedReader::readSome() {
-    int preSize = buffer_.size();
-    buffer_.resize(buffer_.size() + 1024);
+    if (size() == buffer_.size()) {
+        grow();
+    }
 
-    int amountRead = device_.read(buffer_.data() + preSize, 1024);
-    buffer_.resize(preSize + amountRead);
+    // Read into the contiguous free space after the tail
+    std::size_t start = tail_ & mask_;
+    std::size_t space = std::min(buffer_.size() - size(), buffer_.size() - start);
 
+    auto timeout = timeout_.count() != 0 ? timeout_ : device_.settings().readTimeout;
+    int amountRead = device_.read(buffer_.data() + start, static_cast<int>(space), timeout);
     if (amountRead == 0) {
-        throw std::runtime_error("received 0 bytes from socket");
+        throw std::runtime_error("timed out reading from serial device");
     }
+    tail_ += amountRead;
 }
 
 std::string BufferedReader::read(int amount) {
-    while (buffer_.size() < amount) {
+    while (size() < static_cast<std::size_t>(amount)) {
         readSome();
     }
-    std::string res(buffer_.begin(), buffer_.begin() + amount);
-    buffer_.erase(buffer_.begin(), buffer_.begin() + amount);
+    std::string res(amount, '\0');
+    copyOut(res.data(), amount);
+    head_ += amount;
     return res;
 }
 
 std::string BufferedReader::readLine(const std::string &stop) {
-    constexpr std::array<char, 2> terminators{'\r', '\n'};
+    std::string line;
+    readLine(line, stop);
+    return line;
+}
 
+void BufferedReader::readLine(std::string &line, const std::string &stop) {
     skipWhitespace();
 
-    auto pos = buffer_.end();
-    std::size_t lastPos{0};
+    std::size_t pos = 0;
     while (true) {
-        // Start searching from where we left off
-        pos = std::find_first_of(buffer_.begin() + lastPos, buffer_.end(), terminators.begin(), terminators.end());
         // Check for stop
-        if (!stop.empty() && buffer_.size() >= stop.size()) {
-            if (std::equal(stop.begin(), stop.end(), buffer_.begin())) {
-                // stop was found
-                pos = buffer_.begin() + stop.size();
+        if (!stop.empty() && size() >= stop.size()) {
+            std::size_t i = 0;
+            while (i < stop.size() && at(i) == stop[i]) {
+                ++i;
+            }
+            if (i == stop.size()) {
+                pos = stop.size();
                 break;
             }
         }
 
-        if (pos != buffer_.end()) {
+        // Start searching from where we left off
+        const std::size_t end = size();
+        while (pos < end && at(pos) != '\r' && at(pos) != '\n') {
+            ++pos;
+        }
+        if (pos != end) {
             break;
         }
 
-        lastPos = buffer_.size();
         readSome();
-        skipWhitespace();
+        if (pos == 0) {
+            // Nothing but whitespace had been buffered
+            skipWhitespace();
+        }
     }
 
-    std::string line(buffer_.begin(), pos);
-    //std::advance(pos, 1);
-    buffer_.erase(buffer_.begin(), pos);
+    line.resize(pos);
+    copyOut(line.data(), pos);
+    head_ += pos;
+}
 
-    return line;
+void BufferedReader::readUntil(std::string &out, char prompt) {
+
+    std::size_t pos = 0;
+    while (true) {
+        const std::size_t end = size();
+        while (pos < end && at(pos) != prompt) {
+            ++pos;
+        }
+        if (pos != end) {
+            break;
+        }
+        readSome();
+    }
+
+    out.resize(pos);
+    copyOut(out.data(), pos);
+    // Consume the prompt
+    head_ += pos + 1;
 }
 
 void BufferedReader::skipWhitespace() {
-    buffer_.erase(buffer_.begin(), std::find_if_not(buffer_.begin(), buffer_.end(), [](char c) {
-        return std::isspace(static_cast<unsigned char>(c));
-    }));
+    while (head_ != tail_ && std::isspace(static_cast<unsigned char>(buffer_[head_ & mask_]))) {
+        ++head_;
+    }
+}
 }
-}
\ No newline at end of file
@@ -2,12 +2,18 @@
 #define SERIAL_BUFFEREDREADER_H
 
 #include "device.h"
+#include <chrono>
+#include <string>
 #include <vector>
 
 namespace serial {
+/* Buffers reads from a device in a ring buffer. Consuming data only
+ * advances an index, so reading lines never moves the remaining data. The
+ * buffer grows only if a single line does not fit. */
 class BufferedReader {
 public:
-    explicit BufferedReader(Device &device) : device_(device) {}
+    // `capacity` is rounded up to a power of two
+    explicit BufferedReader(Device &device, std::size_t capacity = 4096);
 
     // Reads exactly `amount` bytes
     std::string read(int amount);
@@ -16,16 +22,45 @@ public:
     // or if `stop` is read at the beginning of the line
     std::string readLine(const std::string &stop = "");
 
+    // Same as `readLine()` but reuses the storage of `line`
+    void readLine(std::string &line, const std::string &stop = "");
+
+    /* Reads everything up to `prompt` into `out` and consumes the prompt.
+     * Used for command/response protocols that end each response with a
+     * prompt character. */
+    void readUntil(std::string &out, char prompt);
+
     // Clears buffer
-    inline void clear() noexcept { buffer_.clear(); }
+    inline void clear() noexcept { head_ = tail_ = 0; }
 
     // Clears whitespace at the beginning of the buffer
     void skipWhitespace();
 
+    /* Sets the time to wait for more data before a read throws. Zero uses
+     * the read timeout of the device. */
+    inline void setTimeout(std::chrono::microseconds timeout) noexcept { timeout_ = timeout; }
+
+    // Amount of buffered bytes
+    inline std::size_t size() const noexcept { return tail_ - head_; }
+
 private:
     std::vector<char> buffer_;
+    std::size_t mask_;
+    // Read and write positions. Both only increase; the index into the
+    // buffer is the position masked by `mask_`.
+    std::size_t head_{0};
+    std::size_t tail_{0};
+    std::chrono::microseconds timeout_{0};
     Device &device_;
 
+    inline char at(std::size_t index) const noexcept { return buffer_[(head_ + index) & mask_]; }
+
+    // Copies `amount` bytes from the front of the buffer to `out`
+    void copyOut(char *out, std::size_t amount) const noexcept;
+
+    void grow();
+    // Reads whatever is available. Throws if nothing arrives within the
+    // timeout.
     void readSome();
 };
 }
@@ -5,9 +5,11 @@
 #include <asm/termbits.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <sys/ioctl.h>
@@ -60,6 +62,31 @@ constexpr int databits(DataBits bits) {
     return 0;
 }
 
+timespec toTimespec(std::chrono::microseconds timeout) {
+    timeout = std::max(timeout, std::chrono::microseconds(0));
+    timespec ts{};
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000);
+    ts.tv_nsec = static_cast<long>((timeout.count() % 1000000) * 1000);
+    return ts;
+}
+
+// Polls `fds` until an event occurs or the deadline passes. Retries on
+// EINTR. Returns the number of ready descriptors.
+int pollUntil(pollfd *fds, nfds_t count, std::chrono::steady_clock::time_point deadline) {
+    while (true) {
+        auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+        timespec ts = toTimespec(remaining);
+        int res = ppoll(fds, count, &ts, nullptr);
+        if (res == -1 && errno == EINTR) {
+            continue;
+        }
+        if (res == -1) {
+            throw std::runtime_error(std::string("error while polling serial: ") + strerror(errno));
+        }
+        return res;
+    }
+}
+
 } // namespace detail
 
 void Device::open() {
@@ -67,7 +94,9 @@ void Device::open() {
         throw std::runtime_error("attempt to reopen serial port");
     }
 
-    int flags = O_NOCTTY;
+    // Reads and writes are driven by poll() so timeouts are not limited to
+    // the 0.1s resolution of VTIME
+    int flags = O_NOCTTY | O_NONBLOCK;
     switch (settings_.mode) {
     case Mode::Read:
         flags |= O_RDONLY;
@@ -133,9 +162,9 @@ void Device::updateSettings() {
     // termSettings.c_oflag = 0;
     termSettings.c_oflag &= ~OPOST; /*No Output Processing*/
 
-    // Set blocking
+    // Return immediately; timeouts are handled with poll()
     termSettings.c_cc[VMIN] = 0;
-    termSettings.c_cc[VTIME] = 5; // 0.5s timeout
+    termSettings.c_cc[VTIME] = 0;
 
     // Disable hardware flow control
     termSettings.c_cflag &= ~CRTSCTS;
@@ -175,33 +204,91 @@ void Device::write(const std::string &data) {
         throw std::runtime_error("attempt to write to closed socket");
     }
 
-    int amount = ::write(fd_, data.c_str(), data.size());
-    if (amount == -1) {
-        throw std::runtime_error(
-            std::string("error while writing to serial: ") + strerror(errno));
-    }
-    if (amount != data.size()) {
-        throw std::runtime_error("could not write full message to serial "
-                                 "device. Expected to write " +
-                                 std::to_string(data.size()) + ", wrote " +
-                                 std::to_string(amount));
+    const auto deadline = std::chrono::steady_clock::now() + settings_.writeTimeout;
+    std::size_t written = 0;
+    while (written < data.size()) {
+        ssize_t amount = ::write(fd_, data.data() + written, data.size() - written);
+        if (amount >= 0) {
+            written += static_cast<std::size_t>(amount);
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            throw std::runtime_error(
+                std::string("error while writing to serial: ") + strerror(errno));
+        }
+
+        // The output buffer is full; wait for it to drain
+        pollfd fd{fd_, POLLOUT, 0};
+        if (detail::pollUntil(&fd, 1, deadline) == 0) {
+            throw std::runtime_error("timed out writing to serial device. Wrote " +
+                                     std::to_string(written) + " of " +
+                                     std::to_string(data.size()) + " bytes");
+        }
     }
 }
 
 Device::~Device() { close(); }
 
 int Device::read(char *buffer, int amount) {
+    return read(buffer, amount, settings_.readTimeout);
+}
+
+int Device::read(char *buffer, int amount, std::chrono::microseconds timeout) {
     if (!isOpen()) {
         throw std::runtime_error("attempt to read from closed socket");
     }
 
-    int res = ::read(fd_, buffer, amount);
-    if (res == -1) {
-        throw std::runtime_error(
-            std::string("error while reading from serial: ") + strerror(errno));
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        ssize_t res = ::read(fd_, buffer, amount);
+        if (res >= 0) {
+            // 0 is returned when no data is available (VMIN = 0)
+            if (res > 0) {
+                return static_cast<int>(res);
+            }
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            throw std::runtime_error(
+                std::string("error while reading from serial: ") + strerror(errno));
+        }
+
+        pollfd fd{fd_, POLLIN, 0};
+        if (detail::pollUntil(&fd, 1, deadline) == 0) {
+            return 0;
+        }
+        if ((fd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0 && (fd.revents & POLLIN) == 0) {
+            throw std::runtime_error("serial device was disconnected");
+        }
+    }
+}
+
+bool Device::waitReadable(std::chrono::microseconds timeout) {
+    if (!isOpen()) {
+        throw std::runtime_error("attempt to wait on closed socket");
+    }
+    pollfd fd{fd_, POLLIN, 0};
+    return detail::pollUntil(&fd, 1, std::chrono::steady_clock::now() + timeout) != 0;
+}
+
+std::vector<Device *> waitReadable(const std::vector<Device *> &devices, std::chrono::microseconds timeout) {
+    std::vector<pollfd> fds;
+    fds.reserve(devices.size());
+    for (Device *device : devices) {
+        fds.push_back(pollfd{device->fd(), POLLIN, 0});
     }
 
-    return res;
+    std::vector<Device *> ready;
+    if (detail::pollUntil(fds.data(), fds.size(), std::chrono::steady_clock::now() + timeout) == 0) {
+        return ready;
+    }
+    for (std::size_t i = 0; i < fds.size(); ++i) {
+        if (fds[i].revents != 0) {
+            ready.push_back(devices[i]);
+        }
+    }
+    return ready;
 }
 
 bool startsWith(const std::string &s, const std::string &start) {
@@ -1,6 +1,7 @@
 #ifndef SERIAL_NIX_DEVICE_H
 #define SERIAL_NIX_DEVICE_H
 
+#include <chrono>
 #include <string>
 #include <vector>
 #include <utility>
@@ -37,12 +38,23 @@ public:
     // If the socket is open, applies current settings to it.
     void updateSettings();
 
-    // Writes data to device
+    // Writes all of `data` to the device. Waits up to the write timeout for
+    // the device to accept it.
     void write(const std::string &data);
 
-    // Reads up to `amount` bytes. Returns amount of bytes read.
+    // Reads up to `amount` bytes, waiting up to the read timeout for data.
+    // Returns amount of bytes read, or 0 on timeout.
     int read(char *buffer, int amount);
 
+    // Same as read() with an explicit timeout
+    int read(char *buffer, int amount, std::chrono::microseconds timeout);
+
+    // Waits until data can be read. Returns false on timeout.
+    bool waitReadable(std::chrono::microseconds timeout);
+
+    // Native file descriptor; -1 if closed
+    inline int fd() const noexcept { return fd_; }
+
     ~Device();
 
 private:
@@ -53,6 +65,10 @@ private:
 
 std::vector<std::string> enumeratePorts();
 
+// Waits until at least one device can be read and returns the readable
+// devices. Returns an empty vector on timeout.
+std::vector<Device *> waitReadable(const std::vector<Device *> &devices, std::chrono::microseconds timeout);
+
 } // namespace serial
 
 #endif // SERIAL_NIX_DEVICE_H
@@ -1,6 +1,7 @@
 #ifndef SERIAL_SETTINGS_H
 #define SERIAL_SETTINGS_H
 
+#include <chrono>
 #include <cstdint>
 
 namespace serial {
@@ -57,6 +58,11 @@ struct Settings {
     StopBits stopBits{StopBits::One};
     Mode mode{Mode::ReadWrite};
     DataBits dataBits{DataBits::DB8};
+    // Time read() waits for data before returning 0. Microsecond resolution
+    // on POSIX systems, millisecond on Windows.
+    std::chrono::microseconds readTimeout{500000};
+    // Time write() waits for the device to accept all data
+    std::chrono::microseconds writeTimeout{1000000};
 };
 
 }
@@ -2,6 +2,7 @@
 
 #include <Windows.h>
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -39,17 +40,30 @@ void Device::open() {
 
     updateSettings();
 
-    // Set timeouts
+    readTimeoutMs_ = 0;
+    setReadTimeout(settings_.readTimeout);
+}
+
+void Device::setReadTimeout(std::chrono::microseconds timeout) {
+    // Round up so short timeouts do not become non-blocking reads
+    auto ms = static_cast<unsigned long>(std::max<long long>(1, (timeout.count() + 999) / 1000));
+    if (ms == readTimeoutMs_) {
+        return;
+    }
+
+    // Return as soon as any data is available, or after the timeout
     COMMTIMEOUTS timeouts{};
     timeouts.ReadIntervalTimeout = MAXDWORD;
-    timeouts.ReadTotalTimeoutConstant = 500;
+    timeouts.ReadTotalTimeoutConstant = ms;
     timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
     timeouts.WriteTotalTimeoutMultiplier = 10;
-    timeouts.WriteTotalTimeoutConstant = 500;
+    timeouts.WriteTotalTimeoutConstant = static_cast<DWORD>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(settings_.writeTimeout).count());
 
     if (SetCommTimeouts(handle_, &timeouts) == FALSE) {
         throw std::runtime_error("failed to set comm timeouts");
     }
+    readTimeoutMs_ = ms;
 }
 
 void Device::close() {
@@ -67,20 +81,33 @@ void Device::write(const std::string &data) {
     if (!isOpen()) {
         throw std::runtime_error("attempt to write to closed socket");
     }
-    DWORD written = 0;
 
-    if (WriteFile(handle_, data.c_str(), data.size(), &written, nullptr) == FALSE) {
-        throw std::runtime_error("error write writing to com device");
-    }
-    if (written != data.size()) {
-        throw std::runtime_error("could not write full message to serial "
-                                 "device. Expected to write " +
-                                 std::to_string(data.size()) + ", wrote " +
-                                 std::to_string(written));
+    std::size_t total = 0;
+    while (total < data.size()) {
+        DWORD written = 0;
+        if (WriteFile(handle_, data.c_str() + total, static_cast<DWORD>(data.size() - total), &written, nullptr) ==
+            FALSE) {
+            throw std::runtime_error("error write writing to com device");
+        }
+        if (written == 0) {
+            // The write timeout expired
+            throw std::runtime_error("timed out writing to com device. Wrote " + std::to_string(total) + " of " +
+                                     std::to_string(data.size()) + " bytes");
+        }
+        total += written;
     }
 }
 
 int Device::read(char *buffer, int amount) {
+    return read(buffer, amount, settings_.readTimeout);
+}
+
+int Device::read(char *buffer, int amount, std::chrono::microseconds timeout) {
+    if (!isOpen()) {
+        throw std::runtime_error("attempt to read from closed socket");
+    }
+    setReadTimeout(timeout);
+
     DWORD amountRead = 0;
     if (ReadFile(handle_, buffer, amount, &amountRead, nullptr) == FALSE) {
         throw std::runtime_error("error while reading from comm device");
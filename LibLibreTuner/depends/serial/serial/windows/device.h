@@ -1,6 +1,7 @@
 #ifndef SERIAL_WINDOWS_DEVICE_H
 #define SERIAL_WINDOWS_DEVICE_H
 
+#include <chrono>
 #include <string>
 #include <vector>
 #include <utility>
@@ -37,18 +38,26 @@ public:
     // If the socket is open, applies current settings to it.
     void updateSettings();
 
-    // Writes data to device
+    // Writes all of `data` to the device
     void write(const std::string &data);
 
-    // Reads up to `amount` bytes. Returns amount of bytes read.
+    // Reads up to `amount` bytes, waiting up to the read timeout for data.
+    // Returns amount of bytes read, or 0 on timeout.
     int read(char *buffer, int amount);
 
+    // Same as read() with an explicit timeout (millisecond resolution)
+    int read(char *buffer, int amount, std::chrono::microseconds timeout);
+
     ~Device();
 
 private:
     void* handle_{nullptr};
     std::string port_;
     Settings settings_;
+    // Read timeout currently applied to the handle, in milliseconds
+    unsigned long readTimeoutMs_{0};
+
+    void setReadTimeout(std::chrono::microseconds timeout);
 };
 
 std::vector<std::string> enumeratePorts();
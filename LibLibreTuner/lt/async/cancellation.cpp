@@ -0,0 +1,68 @@
+#include "cancellation.h"
+
+#include <vector>
+
+namespace lt::async
+{
+
+void CancellationRegistration::reset() noexcept
+{
+    if (auto state = state_.lock())
+    {
+        std::lock_guard lock(state->mutex);
+        state->callbacks.erase(id_);
+    }
+    state_.reset();
+}
+
+bool CancellationToken::canceled() const noexcept
+{
+    if (!state_)
+        return false;
+    std::lock_guard lock(state_->mutex);
+    return state_->canceled;
+}
+
+CancellationRegistration CancellationToken::onCancel(std::function<void()> callback) const
+{
+    if (!state_)
+        return CancellationRegistration();
+
+    {
+        std::lock_guard lock(state_->mutex);
+        if (!state_->canceled)
+        {
+            uint64_t id = state_->nextId++;
+            state_->callbacks.emplace(id, std::move(callback));
+            return CancellationRegistration(state_, id);
+        }
+    }
+    callback();
+    return CancellationRegistration();
+}
+
+void CancellationSource::cancel()
+{
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard lock(state_->mutex);
+        if (state_->canceled)
+            return;
+        state_->canceled = true;
+        for (auto & [id, callback] : state_->callbacks)
+            callbacks.emplace_back(std::move(callback));
+        state_->callbacks.clear();
+    }
+
+    // Called without the lock so callbacks may use the token
+    for (auto & callback : callbacks)
+        callback();
+}
+
+bool CancellationSource::canceled() const noexcept
+{
+    std::lock_guard lock(state_->mutex);
+    return state_->canceled;
+}
+
+} // namespace lt::async
@@ -0,0 +1,113 @@
+#ifndef LT_CANCELLATION_H
+#define LT_CANCELLATION_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace lt::async
+{
+
+// Thrown by operations that were canceled
+class OperationCanceled : public std::runtime_error
+{
+public:
+    OperationCanceled() : std::runtime_error("operation canceled") {}
+};
+
+namespace detail
+{
+struct CancellationState
+{
+    std::mutex mutex;
+    bool canceled{false};
+    uint64_t nextId{0};
+    std::map<uint64_t, std::function<void()>> callbacks;
+};
+} // namespace detail
+
+/* Unregisters a cancellation callback when destroyed */
+class CancellationRegistration
+{
+public:
+    CancellationRegistration() = default;
+    CancellationRegistration(std::weak_ptr<detail::CancellationState> state, uint64_t id)
+        : state_(std::move(state)), id_(id)
+    {
+    }
+
+    CancellationRegistration(CancellationRegistration && other) noexcept
+        : state_(std::move(other.state_)), id_(other.id_)
+    {
+        other.state_.reset();
+    }
+    CancellationRegistration & operator=(CancellationRegistration && other) noexcept
+    {
+        reset();
+        state_ = std::move(other.state_);
+        id_ = other.id_;
+        other.state_.reset();
+        return *this;
+    }
+
+    ~CancellationRegistration() { reset(); }
+
+    void reset() noexcept;
+
+private:
+    std::weak_ptr<detail::CancellationState> state_;
+    uint64_t id_{0};
+};
+
+/* Observes cancellation requested through a CancellationSource. A default
+ * constructed token can never be canceled. Tokens are cheap to copy and
+ * are passed down through every layer of an operation, so one cancel()
+ * aborts the whole operation, including transfers in progress. */
+class CancellationToken
+{
+public:
+    CancellationToken() = default;
+    explicit CancellationToken(std::shared_ptr<detail::CancellationState> state) : state_(std::move(state)) {}
+
+    bool canceled() const noexcept;
+
+    inline bool canBeCanceled() const noexcept { return static_cast<bool>(state_); }
+
+    // Throws OperationCanceled if cancellation was requested
+    void throwIfCanceled() const
+    {
+        if (canceled())
+            throw OperationCanceled();
+    }
+
+    /* Calls `callback` when cancellation is requested, on the thread calling
+     * cancel(). Calls it immediately if already canceled. The callback is
+     * unregistered when the returned registration is destroyed. */
+    CancellationRegistration onCancel(std::function<void()> callback) const;
+
+private:
+    std::shared_ptr<detail::CancellationState> state_;
+};
+
+class CancellationSource
+{
+public:
+    CancellationSource() : state_(std::make_shared<detail::CancellationState>()) {}
+
+    inline CancellationToken token() const noexcept { return CancellationToken(state_); }
+
+    // Requests cancellation. Thread-safe.
+    void cancel();
+
+    bool canceled() const noexcept;
+
+private:
+    std::shared_ptr<detail::CancellationState> state_;
+};
+
+} // namespace lt::async
+
+#endif // LT_CANCELLATION_H
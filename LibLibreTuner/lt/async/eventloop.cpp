@@ -0,0 +1,118 @@
+#include "eventloop.h"
+
+#include <algorithm>
+
+namespace lt::async
+{
+
+EventLoop::~EventLoop()
+{
+    // Suspended tasks are destroyed with the loop
+    tasks_.clear();
+}
+
+void EventLoop::post(std::function<void()> callback)
+{
+    {
+        std::lock_guard lock(mutex_);
+        posted_.emplace_back(std::move(callback));
+    }
+    cv_.notify_one();
+}
+
+EventLoop::TimerId EventLoop::addTimer(Clock::time_point deadline, std::function<void()> callback)
+{
+    TimerId id{deadline, nextTimer_++};
+    timers_.emplace(std::make_pair(id.deadline, id.sequence), std::move(callback));
+    return id;
+}
+
+bool EventLoop::cancelTimer(const TimerId & id) { return timers_.erase(std::make_pair(id.deadline, id.sequence)) != 0; }
+
+Task<void> EventLoop::wrap(Task<void> task)
+{
+    try
+    {
+        co_await std::move(task);
+    }
+    catch (...)
+    {
+        if (!exception_)
+            exception_ = std::current_exception();
+        stop();
+    }
+    finished_ = true;
+}
+
+void EventLoop::spawn(Task<void> task)
+{
+    Task<void> wrapper = wrap(std::move(task));
+    auto handle = wrapper.handle();
+    tasks_.emplace_back(std::move(wrapper));
+    post([handle]() { handle.resume(); });
+}
+
+void EventLoop::collect()
+{
+    if (!finished_)
+        return;
+    finished_ = false;
+    tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(), [](const Task<void> & task) { return task.done(); }),
+                 tasks_.end());
+}
+
+void EventLoop::stop()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_one();
+}
+
+void EventLoop::run()
+{
+    std::unique_lock lock(mutex_);
+    while (!stopped_)
+    {
+        if (!posted_.empty())
+        {
+            std::function<void()> callback = std::move(posted_.front());
+            posted_.pop_front();
+            lock.unlock();
+            callback();
+            collect();
+            lock.lock();
+            continue;
+        }
+
+        if (!timers_.empty())
+        {
+            auto it = timers_.begin();
+            if (it->first.first <= Clock::now())
+            {
+                std::function<void()> callback = std::move(it->second);
+                timers_.erase(it);
+                lock.unlock();
+                callback();
+                collect();
+                lock.lock();
+                continue;
+            }
+            cv_.wait_until(lock, it->first.first);
+            continue;
+        }
+
+        if (tasks_.empty())
+            break;
+        // Suspended tasks are waiting on another thread
+        cv_.wait(lock);
+    }
+    stopped_ = false;
+    lock.unlock();
+
+    if (exception_)
+        std::rethrow_exception(std::exchange(exception_, nullptr));
+}
+
+} // namespace lt::async
@@ -0,0 +1,230 @@
+#ifndef LT_EVENTLOOP_H
+#define LT_EVENTLOOP_H
+
+#include "cancellation.h"
+#include "task.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace lt::async
+{
+
+using Clock = std::chrono::steady_clock;
+
+/* Single-threaded executor for coroutine tasks. Tasks, timers and posted
+ * callbacks all run on the thread calling run(); post() and stop() may be
+ * called from any thread. Blocking transports feed the loop from their own
+ * threads through post(). */
+class EventLoop
+{
+public:
+    struct TimerId
+    {
+        Clock::time_point deadline;
+        uint64_t sequence{0};
+    };
+
+    EventLoop() = default;
+    ~EventLoop();
+    EventLoop(const EventLoop &) = delete;
+    EventLoop & operator=(const EventLoop &) = delete;
+
+    // Queues `callback` to run on the loop thread. Thread-safe.
+    void post(std::function<void()> callback);
+
+    // Calls `callback` on the loop thread at `deadline`. Loop thread only.
+    TimerId addTimer(Clock::time_point deadline, std::function<void()> callback);
+    // Returns false if the timer already fired or was canceled
+    bool cancelTimer(const TimerId & id);
+
+    /* Starts `task` on the loop. The loop owns the task until it finishes.
+     * The first exception escaping a spawned task stops the loop and is
+     * rethrown from run(). */
+    void spawn(Task<void> task);
+
+    // Runs until stop() is called or there is no work left
+    void run();
+
+    // Makes run() return after the current callback. Thread-safe.
+    void stop();
+
+    /* Runs the loop until `task` completes and returns its result. Other
+     * spawned tasks keep running. The loop must not be stopped by anything
+     * else meanwhile. */
+    template <typename T> T runUntilComplete(Task<T> task);
+
+    /* Awaitable that resumes after `duration`. Throws OperationCanceled if
+     * `token` is canceled first. */
+    auto sleep(Clock::duration duration, CancellationToken token = {});
+    auto sleepUntil(Clock::time_point deadline, CancellationToken token = {});
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> posted_;
+    bool stopped_{false};
+
+    // Loop thread only
+    std::map<std::pair<Clock::time_point, uint64_t>, std::function<void()>> timers_;
+    uint64_t nextTimer_{0};
+    std::vector<Task<void>> tasks_;
+    bool finished_{false};
+    std::exception_ptr exception_;
+
+    Task<void> wrap(Task<void> task);
+    // Destroys spawned tasks that have finished
+    void collect();
+};
+
+namespace detail
+{
+/* Awaiter shared by sleep() and AsyncQueue::pop(). Completes exactly once
+ * from either the timer or cancellation. */
+class SleepAwaiter
+{
+public:
+    SleepAwaiter(EventLoop & loop, Clock::time_point deadline, CancellationToken token)
+        : loop_(loop), deadline_(deadline), token_(std::move(token))
+    {
+    }
+
+    bool await_ready() const
+    {
+        token_.throwIfCanceled();
+        return Clock::now() >= deadline_;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        auto state = std::make_shared<State>();
+        state->handle = handle;
+        state_ = state;
+
+        // Clock::time_point::max() never expires
+        if (deadline_ != Clock::time_point::max())
+        {
+            timer_ = loop_.addTimer(deadline_, [state]() { complete(*state, false); });
+            hasTimer_ = true;
+        }
+        EventLoop * loop = &loop_;
+        registration_ = token_.onCancel([loop, state]() { loop->post([state]() { complete(*state, true); }); });
+    }
+
+    /* Returns a callback that resumes the awaiting coroutine early, as if the
+     * deadline passed. Valid after await_suspend(). Loop thread only. */
+    std::function<void()> waker() const
+    {
+        return [state = state_]() { complete(*state, false); };
+    }
+
+    void await_resume()
+    {
+        registration_.reset();
+        if (hasTimer_)
+            loop_.cancelTimer(timer_);
+        if (state_ && state_->canceled)
+            throw OperationCanceled();
+    }
+
+private:
+    struct State
+    {
+        std::coroutine_handle<> handle;
+        bool done{false};
+        bool canceled{false};
+    };
+
+    static void complete(State & state, bool canceled)
+    {
+        if (state.done)
+            return;
+        state.done = true;
+        state.canceled = canceled;
+        state.handle.resume();
+    }
+
+    EventLoop & loop_;
+    Clock::time_point deadline_;
+    CancellationToken token_;
+    std::shared_ptr<State> state_;
+    EventLoop::TimerId timer_;
+    bool hasTimer_{false};
+    CancellationRegistration registration_;
+};
+} // namespace detail
+
+inline auto EventLoop::sleep(Clock::duration duration, CancellationToken token)
+{
+    return detail::SleepAwaiter(*this, Clock::now() + duration, std::move(token));
+}
+
+inline auto EventLoop::sleepUntil(Clock::time_point deadline, CancellationToken token)
+{
+    return detail::SleepAwaiter(*this, deadline, std::move(token));
+}
+
+template <typename T> T EventLoop::runUntilComplete(Task<T> task)
+{
+    std::optional<T> result;
+    std::exception_ptr exception;
+    spawn([](EventLoop & loop, Task<T> task, std::optional<T> & result,
+             std::exception_ptr & exception) -> Task<void> {
+        try
+        {
+            result.emplace(co_await std::move(task));
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        loop.stop();
+    }(*this, std::move(task), result, exception));
+    run();
+
+    if (exception)
+        std::rethrow_exception(exception);
+    if (!result)
+        throw std::runtime_error("event loop stopped before the task completed");
+    return std::move(*result);
+}
+
+template <> inline void EventLoop::runUntilComplete(Task<void> task)
+{
+    bool finished = false;
+    std::exception_ptr exception;
+    spawn([](EventLoop & loop, Task<void> task, bool & finished, std::exception_ptr & exception) -> Task<void> {
+        try
+        {
+            co_await std::move(task);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        finished = true;
+        loop.stop();
+    }(*this, std::move(task), finished, exception));
+    run();
+
+    if (exception)
+        std::rethrow_exception(exception);
+    if (!finished)
+        throw std::runtime_error("event loop stopped before the task completed");
+}
+
+} // namespace lt::async
+
+#endif // LT_EVENTLOOP_H
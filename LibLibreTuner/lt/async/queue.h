@@ -0,0 +1,114 @@
+#ifndef LT_ASYNCQUEUE_H
+#define LT_ASYNCQUEUE_H
+
+#include "eventloop.h"
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace lt::async
+{
+
+/* Queue with a single awaiting consumer. All members must be called on the
+ * loop thread; producers on other threads push through EventLoop::post(). */
+template <typename T> class AsyncQueue
+{
+public:
+    explicit AsyncQueue(EventLoop & loop) : loop_(loop) {}
+
+    AsyncQueue(const AsyncQueue &) = delete;
+    AsyncQueue & operator=(const AsyncQueue &) = delete;
+
+    void push(T value)
+    {
+        items_.emplace_back(std::move(value));
+        wake();
+    }
+
+    // Makes waiting and future pops rethrow `exception`
+    void fail(std::exception_ptr exception)
+    {
+        exception_ = exception;
+        wake();
+    }
+
+    void clear() noexcept { items_.clear(); }
+
+    inline bool empty() const noexcept { return items_.empty(); }
+    inline std::size_t size() const noexcept { return items_.size(); }
+
+    /* Awaitable returning the next value, or std::nullopt if none arrives
+     * before `deadline`. Throws OperationCanceled if `token` is canceled
+     * while waiting. */
+    auto pop(Clock::time_point deadline, CancellationToken token = {})
+    {
+        struct Awaiter
+        {
+            AsyncQueue & queue;
+            Clock::time_point deadline;
+            CancellationToken token;
+            detail::SleepAwaiter sleep;
+
+            Awaiter(AsyncQueue & queue, Clock::time_point deadline, CancellationToken token)
+                : queue(queue), deadline(deadline), token(token), sleep(queue.loop_, deadline, token)
+            {
+            }
+
+            bool await_ready()
+            {
+                token.throwIfCanceled();
+                return queue.ready() || Clock::now() >= deadline;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                sleep.await_suspend(handle);
+                queue.waker_ = sleep.waker();
+            }
+
+            std::optional<T> await_resume()
+            {
+                queue.waker_ = nullptr;
+                // Throws if canceled
+                sleep.await_resume();
+                return queue.take();
+            }
+        };
+        return Awaiter(*this, deadline, std::move(token));
+    }
+
+private:
+    EventLoop & loop_;
+    std::deque<T> items_;
+    std::exception_ptr exception_;
+    // Resumes the waiting consumer
+    std::function<void()> waker_;
+
+    bool ready() const noexcept { return !items_.empty() || exception_; }
+
+    std::optional<T> take()
+    {
+        if (exception_)
+            std::rethrow_exception(exception_);
+        if (items_.empty())
+            return std::nullopt;
+        T value = std::move(items_.front());
+        items_.pop_front();
+        return value;
+    }
+
+    void wake()
+    {
+        // Resume from the loop rather than inside the producer
+        if (waker_)
+            loop_.post(std::exchange(waker_, nullptr));
+    }
+};
+
+} // namespace lt::async
+
+#endif // LT_ASYNCQUEUE_H
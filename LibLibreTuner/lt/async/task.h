@@ -0,0 +1,156 @@
+#ifndef LT_TASK_H
+#define LT_TASK_H
+
+#include <cassert>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace lt::async
+{
+
+template <typename T = void> class Task;
+
+namespace detail
+{
+// Resumes the awaiting coroutine when a task finishes
+struct FinalAwaiter
+{
+    bool await_ready() const noexcept { return false; }
+
+    template <typename Promise> std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+    {
+        std::coroutine_handle<> continuation = handle.promise().continuation;
+        return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase
+{
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+
+    // Tasks are lazy; they start when awaited
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+template <typename T> struct Promise : PromiseBase
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+
+    template <typename U> void return_value(U && result) { value.emplace(std::forward<U>(result)); }
+
+    T result()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+        return std::move(*value);
+    }
+};
+
+template <> struct Promise<void> : PromiseBase
+{
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void result() const
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+};
+} // namespace detail
+
+/* Lazily started coroutine producing a `T`. Awaiting a task runs it until
+ * it completes and returns its result or rethrows its exception. */
+template <typename T> class [[nodiscard]] Task
+{
+public:
+    using promise_type = detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle handle) noexcept : handle_(handle) {}
+
+    Task(Task && other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task & operator=(Task && other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_)
+                handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task & operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    inline bool valid() const noexcept { return static_cast<bool>(handle_); }
+    inline bool done() const noexcept { return !handle_ || handle_.done(); }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            Handle handle;
+
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result(); }
+        };
+        assert(handle_);
+        return Awaiter{handle_};
+    }
+
+    // Used by EventLoop to start a task without awaiting it
+    inline Handle handle() const noexcept { return handle_; }
+
+    // Returns the result of a finished task
+    T result()
+    {
+        assert(done());
+        return handle_.promise().result();
+    }
+
+private:
+    Handle handle_;
+};
+
+namespace detail
+{
+template <typename T> Task<T> Promise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+} // namespace detail
+
+} // namespace lt::async
+
+#endif // LT_TASK_H
@@ -0,0 +1,53 @@
+#ifndef LT_WHENALL_H
+#define LT_WHENALL_H
+
+#include "queue.h"
+
+#include <memory>
+#include <vector>
+
+namespace lt::async
+{
+
+/* Runs `tasks` concurrently on `loop` and completes when all of them have
+ * finished. Rethrows the first exception after every task has finished. */
+inline Task<void> whenAll(EventLoop & loop, std::vector<Task<void>> tasks)
+{
+    struct State
+    {
+        explicit State(EventLoop & loop) : done(loop) {}
+
+        AsyncQueue<bool> done;
+        std::exception_ptr exception;
+    };
+    auto state = std::make_shared<State>(loop);
+
+    for (Task<void> & task : tasks)
+    {
+        loop.spawn([](std::shared_ptr<State> state, Task<void> task) -> Task<void> {
+            try
+            {
+                co_await std::move(task);
+            }
+            catch (...)
+            {
+                if (!state->exception)
+                    state->exception = std::current_exception();
+            }
+            state->done.push(true);
+        }(state, std::move(task)));
+    }
+
+    for (std::size_t remaining = tasks.size(); remaining != 0;)
+    {
+        if (co_await state->done.pop(Clock::time_point::max()))
+            --remaining;
+    }
+
+    if (state->exception)
+        std::rethrow_exception(state->exception);
+}
+
+} // namespace lt::async
+
+#endif // LT_WHENALL_H
@@ -0,0 +1,64 @@
+#include "bufferdiff.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lt
+{
+
+namespace
+{
+// Bytes compared at once before looking at single words
+constexpr std::size_t blockSize = 256;
+
+inline uint64_t loadWord(const uint8_t * data) noexcept
+{
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+void addRange(std::vector<ByteRange> & ranges, std::size_t begin, std::size_t end)
+{
+    if (!ranges.empty() && ranges.back().end == begin)
+        ranges.back().end = end;
+    else
+        ranges.push_back(ByteRange{begin, end});
+}
+
+// Compares a block known to differ word by word, then byte by byte
+void diffBlock(std::vector<ByteRange> & ranges, const uint8_t * a, const uint8_t * b, std::size_t begin,
+               std::size_t end, std::size_t offset)
+{
+    std::size_t i = begin;
+    while (i < end)
+    {
+        if (end - i >= sizeof(uint64_t) && loadWord(a + i) == loadWord(b + i))
+        {
+            i += sizeof(uint64_t);
+            continue;
+        }
+
+        std::size_t stop = std::min(end, i + sizeof(uint64_t));
+        for (; i < stop; ++i)
+        {
+            if (a[i] != b[i])
+                addRange(ranges, offset + i, offset + i + 1);
+        }
+    }
+}
+} // namespace
+
+std::vector<ByteRange> diffRanges(const uint8_t * a, const uint8_t * b, std::size_t size, std::size_t offset)
+{
+    std::vector<ByteRange> ranges;
+    for (std::size_t begin = 0; begin < size; begin += blockSize)
+    {
+        std::size_t end = std::min(size, begin + blockSize);
+        if (std::memcmp(a + begin, b + begin, end - begin) != 0)
+            diffBlock(ranges, a, b, begin, end, offset);
+    }
+    return ranges;
+}
+
+} // namespace lt
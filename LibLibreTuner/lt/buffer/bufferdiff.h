@@ -0,0 +1,33 @@
+#ifndef LT_BUFFERDIFF_H
+#define LT_BUFFERDIFF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lt
+{
+
+// Bytes [begin, end)
+struct ByteRange
+{
+    std::size_t begin;
+    std::size_t end;
+
+    inline std::size_t size() const noexcept { return end - begin; }
+    inline bool operator==(const ByteRange & other) const noexcept
+    {
+        return begin == other.begin && end == other.end;
+    }
+};
+
+/* Returns the ranges in which `a` and `b` differ, in ascending order with
+ * adjacent ranges merged. Both buffers must be `size` bytes long; `offset`
+ * is added to every range. Equal blocks are skipped with a single memcmp,
+ * which the C library vectorizes, so only blocks that differ are scanned
+ * closer. */
+std::vector<ByteRange> diffRanges(const uint8_t * a, const uint8_t * b, std::size_t size, std::size_t offset = 0);
+
+} // namespace lt
+
+#endif // LT_BUFFERDIFF_H
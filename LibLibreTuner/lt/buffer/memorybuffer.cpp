@@ -1,6 +1,9 @@
 #include "memorybuffer.h"
 #include "view.h"
 
+#include <cstring>
+#include <stdexcept>
+
 namespace lt
 {
 View MemoryBuffer::view() { return View(*this, 0, size()); }
@@ -9,4 +12,17 @@ View MemoryBuffer::view(int offset, int size)
 {
     return View(*this, offset, size);
 }
+
+void MemoryBuffer::write(int offset, const uint8_t * data, int size)
+{
+    if (offset < 0 || size < 0 || offset + size > this->size())
+        throw std::runtime_error("MemoryBuffer::write(): range exceeds buffer size");
+
+    if (observer_ != nullptr)
+        observer_->beforeWrite(offset, size);
+    std::memcpy(data_.data() + offset, data, static_cast<std::size_t>(size));
+    if (observer_ != nullptr)
+        observer_->afterWrite(offset, size);
+    writeEvent_(offset, size);
+}
 }
\ No newline at end of file
@@ -5,20 +5,44 @@
 #include <cstdint>
 #include <memory>
 
+#include "../support/event.h"
+
 namespace lt
 {
 class View;
 
+/* Receives notifications when a MemoryBuffer is modified through write()
+ * (and therefore through View::set). Used to keep derived state, such as
+ * checksums, up to date without rescanning the buffer. */
+class WriteObserver
+{
+public:
+    // Called before bytes [offset, offset + size) are overwritten
+    virtual void beforeWrite(int offset, int size) = 0;
+    // Called after bytes [offset, offset + size) were overwritten
+    virtual void afterWrite(int offset, int size) = 0;
+
+    virtual ~WriteObserver() = default;
+};
+
 class MemoryBuffer
 {
 public:
     using iterator = std::vector<uint8_t>::iterator;
     using const_iterator = std::vector<uint8_t>::const_iterator;
+    using WriteEvent = Event<int, int>;
 
     MemoryBuffer(const MemoryBuffer&) = delete;
-    MemoryBuffer(MemoryBuffer&&) = default;
     MemoryBuffer & operator=(const MemoryBuffer&) = delete;
-    MemoryBuffer & operator=(MemoryBuffer&&) = default;
+
+    // The observer and write connections are not carried over; they
+    // observe a specific buffer
+    MemoryBuffer(MemoryBuffer && other) noexcept : data_(std::move(other.data_)) {}
+    MemoryBuffer & operator=(MemoryBuffer && other) noexcept
+    {
+        data_ = std::move(other.data_);
+        return *this;
+    }
 
     MemoryBuffer() = default;
     explicit MemoryBuffer(std::vector<uint8_t> && data) : data_(std::move(data))
@@ -48,6 +72,20 @@ public:
     View view();
     View view(int offset, int size);
 
+    /* Copies `size` bytes from `data` to `offset`, notifying the observer.
+     * Writes made through iterators or data() are not observed. */
+    void write(int offset, const uint8_t * data, int size);
+
+    // Sets the write observer. Pass nullptr to remove it.
+    inline void setObserver(WriteObserver * observer) noexcept { observer_ = observer; }
+
+    // Called with (offset, size) after bytes were overwritten by write(),
+    // after the observer
+    template <typename Func> WriteEvent::ConnectionPtr onWrite(Func && func) noexcept
+    {
+        return writeEvent_.connect(std::forward<Func>(func));
+    }
+
     template <class Archive>
     void serialize(Archive & archive)
     {
@@ -56,6 +94,8 @@ public:
 
 private:
     std::vector<uint8_t> data_;
+    WriteObserver * observer_{nullptr};
+    WriteEvent writeEvent_;
 };
 } // namespace lt
 
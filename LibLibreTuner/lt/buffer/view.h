@@ -38,15 +38,9 @@ public:
     {
         if (offset + static_cast<int>(sizeof(T)) > size())
             throw std::runtime_error("TuneView::get(): index out of range");
-        auto it = std::next(buffer_.begin(), offset_ + offset);
 
         T val = endian::convert<T, endian::current, endianness>(t);
-        uint8_t * repr = reinterpret_cast<uint8_t *>(&val);
-        for (std::size_t i = 0; i < sizeof(T); ++i)
-        {
-            *it = repr[i];
-            std::advance(it, 1);
-        }
+        buffer_.write(offset_ + offset, reinterpret_cast<const uint8_t *>(&val), static_cast<int>(sizeof(T)));
     }
 
     inline int size() const { return size_; }
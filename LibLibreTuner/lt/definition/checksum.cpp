@@ -16,9 +16,13 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <stdexcept>
 
 #include "checksum.h"
+#include "checksumregistry.h"
 #include "support/util.hpp"
 
 namespace lt
@@ -31,7 +35,112 @@ void Checksum::addModifiable(int offset, int size)
 
 Checksum::~Checksum() = default;
 
-uint32_t ChecksumBasic::compute(const uint8_t * data, int size, bool * ok) const
+uint32_t Checksum::partialSum(const uint8_t * /*data*/, int /*size*/,
+                              int /*offset*/, int /*length*/) const
+{
+    throw std::runtime_error("checksum does not support partial sums");
+}
+
+void Checksum::correctFrom(uint8_t * data, int size,
+                           uint32_t /*current*/) const
+{
+    correct(data, size);
+}
+
+std::pair<int, int> Checksum::correctionRange() const
+{
+    // Find a usable modifiable region
+    const int size = correctionSize();
+    for (const auto & it : modifiable_)
+    {
+        if (it.second >= size)
+            return {offset_ + it.first, size};
+    }
+    throw std::runtime_error("failed to find a usable modifiable region "
+                             "for checksum correction.");
+}
+
+ChecksumSum::ChecksumSum(int offset, int size, uint32_t target, int wordSize,
+                         Endianness endianness, ChecksumFinal final)
+    : Checksum(offset, size, target), wordSize_(wordSize),
+      endianness_(endianness), final_(final)
+{
+    if (wordSize != 1 && wordSize != 2 && wordSize != 4)
+        throw std::runtime_error("checksum word size must be 1, 2 or 4 bytes");
+    if (wordSize < 4)
+        mask_ = (1u << (wordSize * 8)) - 1;
+    if ((target & mask_) != target)
+        throw std::runtime_error("checksum target does not fit in the word size");
+}
+
+namespace
+{
+/* Sums each byte position of `size` bytes separately. The result is
+ * independent of endianness and the loop over 16 byte lanes is easily
+ * vectorized by the compiler. */
+void sumLanes(const uint8_t * data, std::size_t size,
+              std::array<uint64_t, 16> & lanes) noexcept
+{
+    // Lane accumulators are flushed before they can overflow
+    constexpr std::size_t flushChunks = 1u << 24;
+
+    std::size_t chunks = size / 16;
+    while (chunks != 0)
+    {
+        std::size_t count = std::min(chunks, flushChunks);
+        uint32_t acc[16] = {};
+        for (std::size_t i = 0; i < count; ++i, data += 16)
+        {
+            for (int k = 0; k < 16; ++k)
+                acc[k] += data[k];
+        }
+        for (int k = 0; k < 16; ++k)
+            lanes[k] += acc[k];
+        chunks -= count;
+    }
+
+    for (std::size_t k = 0; k < size % 16; ++k)
+        lanes[k] += data[k];
+}
+} // namespace
+
+uint32_t ChecksumSum::sumWords(const uint8_t * region, int begin,
+                               int end) const
+{
+    if (begin >= end)
+        return 0;
+
+    // wordSize_ divides 16, so lane k holds byte k % wordSize_ of each word
+    std::array<uint64_t, 16> lanes{};
+    sumLanes(region + begin * wordSize_,
+             static_cast<std::size_t>(end - begin) * wordSize_, lanes);
+
+    uint64_t sum = 0;
+    for (int k = 0; k < 16; ++k)
+    {
+        int byte = k % wordSize_;
+        int shift = endianness_ == Endianness::Big
+                        ? (wordSize_ - 1 - byte) * 8
+                        : byte * 8;
+        sum += lanes[k] << shift;
+    }
+    return static_cast<uint32_t>(sum);
+}
+
+uint32_t ChecksumSum::finalize(uint32_t sum) const noexcept
+{
+    switch (final_)
+    {
+    case ChecksumFinal::Invert:
+        return ~sum & mask_;
+    case ChecksumFinal::Negate:
+        return (0u - sum) & mask_;
+    default:
+        return sum & mask_;
+    }
+}
+
+uint32_t ChecksumSum::compute(const uint8_t * data, int size, bool * ok) const
 {
     assert(size >= 0);
     if (size < offset_ + size_)
@@ -41,56 +150,300 @@ uint32_t ChecksumBasic::compute(const uint8_t * data, int size, bool * ok) const
         return 0;
     }
 
-    data += offset_;
-    size -= offset_;
-
-    uint32_t sum = 0;
-    // Add up the big endian int32s
-    for (int i = 0; i < size_ / 4; ++i, data += 4)
+    if (ok != nullptr)
     {
-        sum += readBE<int32_t>(data, data + size);
+        *ok = true;
     }
+    return finalize(sumWords(data + offset_, 0, size_ / wordSize_));
+}
 
-    if (ok != nullptr)
+uint32_t ChecksumSum::partialSum(const uint8_t * data, int size, int offset,
+                                 int length) const
+{
+    assert(size >= 0);
+    if (size < offset_ + size_)
+        throw std::runtime_error("checksum region exceeds the rom size.");
+
+    // Range of words overlapping [offset, offset + length)
+    int first = std::max(0, (offset - offset_) / wordSize_);
+    int last = std::min(size_ / wordSize_,
+                        (offset + length - offset_ + wordSize_ - 1) /
+                            wordSize_);
+
+    uint32_t sum = sumWords(data + offset_, first, last);
+    // Both final operations negate the contribution of each word
+    if (final_ != ChecksumFinal::None)
+        sum = 0u - sum;
+    return sum & mask_;
+}
+
+void ChecksumSum::correctFrom(uint8_t * data, int size,
+                              uint32_t current) const
+{
+    assert(size >= 0);
+    if (size < offset_ + size_)
+        throw std::runtime_error("checksum region exceeds the rom size.");
+
+    auto [modifiableOffset, modifiableSize] = correctionRange();
+
+    // A word straddling two checksum words does not contribute linearly
+    int relative = modifiableOffset - offset_;
+    if (relative < 0 || relative % wordSize_ != 0 ||
+        relative + wordSize_ > size_)
+        throw std::runtime_error("modifiable region is not aligned to a "
+                                 "word of the checksum region");
+
+    uint32_t rest =
+        current - partialSum(data, size, modifiableOffset, modifiableSize);
+    uint32_t contribution = target_ - rest;
+    uint32_t word = (final_ == ChecksumFinal::None ? contribution
+                                                   : 0u - contribution) &
+                    mask_;
+
+    uint8_t * out = data + modifiableOffset;
+    for (int i = 0; i < wordSize_; ++i)
     {
-        *ok = true;
+        int shift = endianness_ == Endianness::Big
+                        ? (wordSize_ - 1 - i) * 8
+                        : i * 8;
+        out[i] = static_cast<uint8_t>(word >> shift);
     }
-    return sum;
+
+    assert(compute(data, size, nullptr) == target_);
 }
 
-void ChecksumBasic::correct(uint8_t * data, int size) const
+void ChecksumSum::correct(uint8_t * data, int size) const
 {
     assert(size >= 0);
     if (size < offset_ + size_)
         throw std::runtime_error("checksum region exceeds the rom size.");
 
-    bool foundMod = false;
-    int modifiableOffset{0};
+    correctFrom(data, size, compute(data, size, nullptr));
+}
 
-    // Find a usable modifiable region
-    for (const auto & it : modifiable_)
+const CrcParameters CrcParameters::crc32{32, 0x04C11DB7, 0xFFFFFFFF,
+                                         0xFFFFFFFF, true};
+const CrcParameters CrcParameters::crc16Ccitt{16, 0x1021, 0xFFFF, 0, false};
+
+namespace
+{
+uint32_t reflect(uint32_t value, int width) noexcept
+{
+    uint32_t result = 0;
+    for (int i = 0; i < width; ++i, value >>= 1)
+        result = (result << 1) | (value & 1);
+    return result;
+}
+
+// Loads four bytes as a little endian integer
+inline uint32_t loadLE(const uint8_t * data) noexcept
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    if constexpr (endian::isBig)
+    {
+        value = (value >> 24) | ((value >> 8) & 0xFF00) |
+                ((value << 8) & 0xFF0000) | (value << 24);
+    }
+    return value;
+}
+
+template <bool Reflected, int Width>
+uint32_t updateCrc(uint32_t crc, const uint8_t * data, std::size_t size,
+                   const std::vector<std::array<uint32_t, 256>> & tables) noexcept
+{
+    constexpr int bytes = Width / 8;
+    constexpr uint32_t mask =
+        Width == 32 ? 0xFFFFFFFF : (1u << Width) - 1;
+    const std::array<uint32_t, 256> * t = tables.data();
+
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        // Stream bytes in the order they enter the register
+        uint32_t low = loadLE(data);
+        uint32_t high = loadLE(data + 4);
+
+        // The register is consumed by the first `bytes` bytes
+        uint32_t head;
+        if constexpr (Reflected)
+            head = crc;
+        else if constexpr (Width == 32)
+            head = (crc >> 24) | ((crc >> 8) & 0xFF00) |
+                   ((crc << 8) & 0xFF0000) | (crc << 24);
+        else
+            head = (crc >> 8) | ((crc & 0xFF) << 8);
+        low ^= head;
+
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^
+              t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^
+              t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        static_assert(bytes <= 4, "CRC register must fit in four bytes");
+    }
+
+    const std::array<uint32_t, 256> & table = t[0];
+    for (; size != 0; --size, ++data)
+    {
+        if constexpr (Reflected)
+            crc = (crc >> 8) ^ table[(crc ^ *data) & 0xFF];
+        else
+            crc = ((crc << 8) & mask) ^
+                  table[((crc >> (Width - 8)) ^ *data) & 0xFF];
+    }
+    return crc;
+}
+} // namespace
+
+ChecksumCrc::ChecksumCrc(int offset, int size, uint32_t target,
+                         const CrcParameters & parameters)
+    : Checksum(offset, size, target), parameters_(parameters), tables_(8)
+{
+    const int width = parameters_.width;
+    if (width != 16 && width != 32)
+        throw std::runtime_error("CRC width must be 16 or 32 bits");
+    if ((parameters_.poly & 1) == 0)
+        throw std::runtime_error("CRC polynomial must include the x^0 term");
+
+    mask_ = width == 32 ? 0xFFFFFFFF : (1u << width) - 1;
+    if ((target & mask_) != target)
+        throw std::runtime_error("checksum target does not fit in the CRC width");
+
+    const uint32_t top = 1u << (width - 1);
+    const uint32_t poly = parameters_.reflected
+                              ? reflect(parameters_.poly, width)
+                              : parameters_.poly;
+
+    for (uint32_t b = 0; b < 256; ++b)
+    {
+        uint32_t crc;
+        if (parameters_.reflected)
+        {
+            crc = b;
+            for (int i = 0; i < 8; ++i)
+                crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+        }
+        else
+        {
+            crc = b << (width - 8);
+            for (int i = 0; i < 8; ++i)
+                crc = ((crc & top) ? (crc << 1) ^ poly : crc << 1) & mask_;
+        }
+        tables_[0][b] = crc;
+    }
+
+    // Feed a zero byte into each entry of the previous table
+    for (int k = 1; k < 8; ++k)
+    {
+        for (int b = 0; b < 256; ++b)
+        {
+            uint32_t crc = tables_[k - 1][b];
+            if (parameters_.reflected)
+                tables_[k][b] = (crc >> 8) ^ tables_[0][crc & 0xFF];
+            else
+                tables_[k][b] = ((crc << 8) & mask_) ^
+                                tables_[0][crc >> (width - 8)];
+        }
+    }
+
+    // With an odd polynomial, the byte of the entry furthest from the
+    // input is unique per index
+    for (int b = 0; b < 256; ++b)
+    {
+        uint32_t crc = tables_[0][b];
+        reverse_[parameters_.reflected ? crc >> (width - 8) : crc & 0xFF] =
+            static_cast<uint8_t>(b);
+    }
+}
+
+uint32_t ChecksumCrc::update(uint32_t crc, const uint8_t * data,
+                             std::size_t size) const noexcept
+{
+    if (parameters_.reflected)
     {
-        if (it.second >= 4)
+        if (parameters_.width == 32)
+            return updateCrc<true, 32>(crc, data, size, tables_);
+        return updateCrc<true, 16>(crc, data, size, tables_);
+    }
+    if (parameters_.width == 32)
+        return updateCrc<false, 32>(crc, data, size, tables_);
+    return updateCrc<false, 16>(crc, data, size, tables_);
+}
+
+uint32_t ChecksumCrc::revert(uint32_t crc, const uint8_t * data,
+                             std::size_t size) const noexcept
+{
+    const int width = parameters_.width;
+    for (data += size; size != 0; --size)
+    {
+        uint8_t byte = *--data;
+        if (parameters_.reflected)
+        {
+            uint8_t index = reverse_[crc >> (width - 8)];
+            crc = (((crc ^ tables_[0][index]) << 8) & mask_) |
+                  static_cast<uint8_t>(index ^ byte);
+        }
+        else
         {
-            modifiableOffset = it.first;
-            foundMod = true;
-            break;
+            uint8_t index = reverse_[crc & 0xFF];
+            crc = ((crc ^ tables_[0][index]) >> 8) |
+                  (static_cast<uint32_t>(index ^ byte) << (width - 8));
         }
     }
-    if (!foundMod)
-        throw std::runtime_error("failed to find a usable modifiable region "
-                                 "for checksum correction.");
+    return crc;
+}
 
-    // Zero the region
-    writeBE<int32_t>(0, &data[offset_ + modifiableOffset], data + size);
+uint32_t ChecksumCrc::compute(const uint8_t * data, int size, bool * ok) const
+{
+    assert(size >= 0);
+    if (size < offset_ + size_)
+    {
+        if (ok != nullptr)
+            *ok = false;
+        return 0;
+    }
 
-    // compute should never fail after the check above
-    uint32_t oSum = compute(data, size, nullptr);
+    if (ok != nullptr)
+        *ok = true;
+    return (update(parameters_.init, data + offset_, size_) ^
+            parameters_.xorOut) &
+           mask_;
+}
+
+void ChecksumCrc::correct(uint8_t * data, int size) const
+{
+    assert(size >= 0);
+    if (size < offset_ + size_)
+        throw std::runtime_error("checksum region exceeds the rom size.");
+
+    auto [modifiableOffset, modifiableSize] = correctionRange();
+    int relative = modifiableOffset - offset_;
+    if (relative < 0 || relative + modifiableSize > size_)
+        throw std::runtime_error("modifiable region must be inside the CRC "
+                                 "region");
 
-    uint32_t val = target_ - oSum;
-    writeBE<int32_t>(val, &data[offset_ + modifiableOffset], data + size);
+    const uint8_t * region = data + offset_;
+    const int bytes = modifiableSize;
+
+    // Register before the modifiable bytes
+    uint32_t before = update(parameters_.init, region, relative);
+    // Register required after the modifiable bytes to reach the target
+    uint32_t after = revert((target_ ^ parameters_.xorOut) & mask_,
+                            region + relative + bytes,
+                            size_ - relative - bytes);
+
+    /* Feeding bytes `w` into register `r` is equivalent to feeding zero
+     * bytes into `r ^ w`, so `w = before ^ revert(after, zeros)`. */
+    const uint8_t zeros[4] = {};
+    uint32_t word = before ^ revert(after, zeros, bytes);
+
+    uint8_t * out = data + modifiableOffset;
+    for (int j = 0; j < bytes; ++j)
+    {
+        int shift = parameters_.reflected ? j * 8
+                                          : parameters_.width - 8 - j * 8;
+        out[j] = static_cast<uint8_t>(word >> shift);
+    }
 
-    // Check if the correction was successful
     if (compute(data, size, nullptr) != target_)
     {
         throw std::runtime_error(
@@ -98,6 +451,12 @@ void ChecksumBasic::correct(uint8_t * data, int size) const
     }
 }
 
+void Checksums::add(const ChecksumDefinition & definition)
+{
+    add(ChecksumRegistry::get().create(definition));
+    definitions_.emplace_back(definition);
+}
+
 void Checksums::correct(uint8_t * data, size_t size)
 {
     for (const ChecksumPtr & checksum : checksums_)
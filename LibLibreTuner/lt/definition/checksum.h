@@ -19,11 +19,16 @@
 #ifndef LT_CHECKSUM_H
 #define LT_CHECKSUM_H
 
+#include <array>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "../support/endianness.h"
+
 namespace lt
 {
 
@@ -46,29 +51,176 @@ public:
     virtual uint32_t compute(const uint8_t * data, int size,
                              bool * ok = nullptr) const = 0;
 
+    /* Returns true if the checksum is a sum of independent words. Additive
+     * checksums can be updated incrementally with partialSum() and
+     * corrected without a rescan with correctFrom(). */
+    virtual bool additive() const noexcept { return false; }
+
+    /* Returns the contribution to the checksum of the words overlapping
+     * bytes [offset, offset + length) of `data`. Contributions are added
+     * modulo mask() + 1. Throws an exception if the checksum is not
+     * additive. */
+    virtual uint32_t partialSum(const uint8_t * data, int size, int offset,
+                                int length) const;
+
+    /* Corrects the checksum, given `current`, the checksum of `data` before
+     * correction. The default implementation calls correct(). */
+    virtual void correctFrom(uint8_t * data, int size, uint32_t current) const;
+
+    /* Returns the absolute (offset, size) of the bytes written by
+     * correct(). Throws an exception if no modifiable region is usable. */
+    std::pair<int, int> correctionRange() const;
+
+    inline int offset() const noexcept { return offset_; }
+    inline int size() const noexcept { return size_; }
+    inline uint32_t target() const noexcept { return target_; }
+    // Mask of the significant bits of computed values
+    inline uint32_t mask() const noexcept { return mask_; }
+
     virtual ~Checksum();
 
 protected:
     int offset_;
     int size_;
     uint32_t target_;
+    uint32_t mask_{0xFFFFFFFF};
 
     std::vector<std::pair<int, int>> modifiable_;
+
+    // Number of bytes written by correct()
+    virtual int correctionSize() const noexcept { return 4; }
 };
 using ChecksumPtr = std::unique_ptr<Checksum>;
 
-/* Basic type checksum */
-class ChecksumBasic : public Checksum
+// Operation applied to a sum after adding the words
+enum class ChecksumFinal
+{
+    None,
+    // Ones' complement
+    Invert,
+    // Two's complement
+    Negate,
+};
+
+/* Sum of 1, 2 or 4 byte words */
+class ChecksumSum : public Checksum
+{
+public:
+    ChecksumSum(int offset, int size, uint32_t target, int wordSize,
+                Endianness endianness, ChecksumFinal final);
+
+    uint32_t compute(const uint8_t * data, int size, bool * ok) const override;
+
+    void correct(uint8_t * data, int size) const override;
+
+    bool additive() const noexcept override { return true; }
+
+    uint32_t partialSum(const uint8_t * data, int size, int offset,
+                        int length) const override;
+
+    void correctFrom(uint8_t * data, int size,
+                     uint32_t current) const override;
+
+protected:
+    int correctionSize() const noexcept override { return wordSize_; }
+
+private:
+    int wordSize_;
+    Endianness endianness_;
+    ChecksumFinal final_;
+
+    // Sums the words in [begin, end) of the checksum region
+    uint32_t sumWords(const uint8_t * region, int begin, int end) const;
+    // Applies the final operation to a word sum
+    uint32_t finalize(uint32_t sum) const noexcept;
+};
+
+/* Basic type checksum. Sum of big endian 32-bit words. */
+class ChecksumBasic : public ChecksumSum
 {
 public:
     ChecksumBasic(uint32_t offset, uint32_t size, uint32_t target)
-        : Checksum(offset, size, target)
+        : ChecksumSum(offset, size, target, 4, Endianness::Big,
+                      ChecksumFinal::None)
     {
     }
+};
+
+/* Parameters of a CRC algorithm in the Rocksoft model */
+struct CrcParameters
+{
+    // 16 or 32
+    int width;
+    uint32_t poly;
+    uint32_t init;
+    uint32_t xorOut;
+    // true if input and output are bit-reflected
+    bool reflected;
+
+    static const CrcParameters crc32;
+    static const CrcParameters crc16Ccitt;
+};
+
+/* Table-driven CRC. Computes eight bytes per step (slicing-by-8).
+ * Corrects by solving for the modifiable bytes with the reverse CRC, so
+ * no brute force is needed. */
+class ChecksumCrc : public Checksum
+{
+public:
+    ChecksumCrc(int offset, int size, uint32_t target,
+                const CrcParameters & parameters);
 
     uint32_t compute(const uint8_t * data, int size, bool * ok) const override;
 
     void correct(uint8_t * data, int size) const override;
+
+protected:
+    int correctionSize() const noexcept override
+    {
+        return parameters_.width / 8;
+    }
+
+private:
+    CrcParameters parameters_;
+    // Slicing tables. tables_[k][b] is the CRC register after feeding byte
+    // `b` followed by k zero bytes into a zero register.
+    std::vector<std::array<uint32_t, 256>> tables_;
+    // Maps the byte of a table entry that is unique per index back to the
+    // index. Used to run the CRC backwards.
+    std::array<uint8_t, 256> reverse_;
+
+    // Feeds bytes into the register
+    uint32_t update(uint32_t crc, const uint8_t * data, std::size_t size) const noexcept;
+    // Undoes feeding bytes into the register
+    uint32_t revert(uint32_t crc, const uint8_t * data, std::size_t size) const noexcept;
+};
+
+/* Options of a checksum definition. Each mode uses the options that apply
+ * to it. */
+struct ChecksumOptions
+{
+    int offset{0};
+    int size{0};
+    uint32_t target{0};
+
+    // Word endianness of sums
+    Endianness endianness{Endianness::Big};
+    // Final operation of sums
+    ChecksumFinal final{ChecksumFinal::None};
+
+    // Overrides of the CRC register initial value and output xor
+    std::optional<uint32_t> init;
+    std::optional<uint32_t> xorOut;
+};
+
+/* Checksum as described by a definition file. Kept alongside the created
+ * checksum so definitions can be written back out (e.g. to a cache). */
+struct ChecksumDefinition
+{
+    std::string mode;
+    ChecksumOptions options;
+    // (offset, size) relative to the checksum offset
+    std::vector<std::pair<int, int>> modifiable;
 };
 
 /**
@@ -83,12 +235,29 @@ public:
         checksums_.emplace_back(std::move(checksum));
     }
 
+    /* Creates a checksum from a definition with the checksum registry and
+     * adds it. Throws an exception if the mode is unknown. */
+    void add(const ChecksumDefinition & definition);
+
+    // Definitions of checksums added with add(const ChecksumDefinition &)
+    inline const std::vector<ChecksumDefinition> & definitions() const noexcept
+    {
+        return definitions_;
+    }
+
     /* Corrects the checksums for the data using modifiable sections.
      * Returns (false, errmsg) on failure and (true, "") on success. */
     void correct(uint8_t * data, size_t size);
 
+    inline std::size_t size() const noexcept { return checksums_.size(); }
+    inline const Checksum & operator[](std::size_t index) const
+    {
+        return *checksums_[index];
+    }
+
 private:
     std::vector<ChecksumPtr> checksums_;
+    std::vector<ChecksumDefinition> definitions_;
 };
 
 } // namespace lt
@@ -0,0 +1,81 @@
+#include "checksumregistry.h"
+
+#include <stdexcept>
+
+namespace lt
+{
+
+namespace
+{
+ChecksumFactory sum(int wordSize)
+{
+    return [wordSize](const ChecksumOptions & options) {
+        return std::make_unique<ChecksumSum>(options.offset, options.size, options.target, wordSize,
+                                             options.endianness, options.final);
+    };
+}
+
+ChecksumFactory crc(const CrcParameters & defaults)
+{
+    return [defaults](const ChecksumOptions & options) {
+        CrcParameters parameters = defaults;
+        if (options.init)
+            parameters.init = *options.init;
+        if (options.xorOut)
+            parameters.xorOut = *options.xorOut;
+        return std::make_unique<ChecksumCrc>(options.offset, options.size, options.target, parameters);
+    };
+}
+} // namespace
+
+ChecksumRegistry::ChecksumRegistry()
+{
+    add("basic", [](const ChecksumOptions & options) {
+        return std::make_unique<ChecksumBasic>(options.offset, options.size, options.target);
+    });
+    add("sum8", sum(1));
+    add("sum16", sum(2));
+    add("sum32", sum(4));
+    add("crc16-ccitt", crc(CrcParameters::crc16Ccitt));
+    add("crc32", crc(CrcParameters::crc32));
+}
+
+ChecksumRegistry & ChecksumRegistry::get()
+{
+    static ChecksumRegistry registry;
+    return registry;
+}
+
+void ChecksumRegistry::add(const std::string & mode, ChecksumFactory factory)
+{
+    factories_[mode] = std::move(factory);
+}
+
+ChecksumPtr ChecksumRegistry::create(const std::string & mode, const ChecksumOptions & options) const
+{
+    auto it = factories_.find(mode);
+    if (it == factories_.end())
+        throw std::runtime_error("invalid mode for checksum: '" + mode + "'");
+    return it->second(options);
+}
+
+ChecksumPtr ChecksumRegistry::create(const ChecksumDefinition & definition) const
+{
+    ChecksumPtr checksum = create(definition.mode, definition.options);
+    for (const auto & [offset, size] : definition.modifiable)
+        checksum->addModifiable(offset, size);
+    return checksum;
+}
+
+bool ChecksumRegistry::contains(const std::string & mode) const { return factories_.count(mode) != 0; }
+
+std::vector<std::string> ChecksumRegistry::modes() const
+{
+    std::vector<std::string> modes;
+    modes.reserve(factories_.size());
+    for (const auto & [mode, factory] : factories_)
+        modes.emplace_back(mode);
+    return modes;
+}
+
+} // namespace lt
@@ -0,0 +1,48 @@
+#ifndef LT_CHECKSUMREGISTRY_H
+#define LT_CHECKSUMREGISTRY_H
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "checksum.h"
+
+namespace lt
+{
+
+using ChecksumFactory = std::function<ChecksumPtr(const ChecksumOptions &)>;
+
+/* Maps checksum modes used in definitions to implementations. Built-in
+ * modes are "basic", "sum8", "sum16", "sum32", "crc16-ccitt" and "crc32".
+ * Additional modes must be added before definitions are loaded. */
+class ChecksumRegistry
+{
+public:
+    // Returns the global registry
+    static ChecksumRegistry & get();
+
+    // Adds a mode. Replaces any previous factory for the mode.
+    void add(const std::string & mode, ChecksumFactory factory);
+
+    // Creates a checksum. Throws an exception if the mode is unknown.
+    ChecksumPtr create(const std::string & mode,
+                       const ChecksumOptions & options) const;
+
+    // Creates a checksum with its modifiable regions
+    ChecksumPtr create(const ChecksumDefinition & definition) const;
+
+    bool contains(const std::string & mode) const;
+
+    // Returns all registered modes
+    std::vector<std::string> modes() const;
+
+private:
+    ChecksumRegistry();
+
+    std::unordered_map<std::string, ChecksumFactory> factories_;
+};
+
+} // namespace lt
+
+#endif // LT_CHECKSUMREGISTRY_H
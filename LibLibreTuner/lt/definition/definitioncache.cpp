@@ -0,0 +1,608 @@
+#include "definitioncache.h"
+
+#include "../os/mappedfile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace lt
+{
+
+namespace
+{
+constexpr char magic[4] = {'L', 'T', 'D', 'C'};
+constexpr uint32_t none = 0xFFFFFFFF;
+
+// Kinds of axis references in table records
+enum class AxisRef : uint8_t
+{
+    None,
+    Index,
+    // The axis does not exist in the platform; the id is kept as a string
+    Name,
+};
+
+// Little endian record writer with interned strings
+class Writer
+{
+public:
+    void u8(uint8_t value) { body_.push_back(value); }
+    void u16(uint16_t value) { integer(value, 2); }
+    void u32(uint32_t value) { integer(value, 4); }
+    void u64(uint64_t value) { integer(value, 8); }
+    void i32(int32_t value) { u32(static_cast<uint32_t>(value)); }
+    void f64(double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        u64(bits);
+    }
+    void bytes(const uint8_t * data, std::size_t size) { body_.insert(body_.end(), data, data + size); }
+
+    // Writes the index of an interned string
+    void str(const std::string & value)
+    {
+        auto [it, inserted] = ids_.emplace(value, static_cast<uint32_t>(strings_.size()));
+        if (inserted)
+            strings_.emplace_back(value);
+        u32(it->second);
+    }
+
+    inline const std::vector<uint8_t> & body() const noexcept { return body_; }
+    inline const std::vector<std::string> & strings() const noexcept { return strings_; }
+
+private:
+    std::vector<uint8_t> body_;
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::vector<std::string> strings_;
+
+    void integer(uint64_t value, int size)
+    {
+        for (int i = 0; i < size; ++i)
+            body_.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+};
+
+// Bounds-checked reader over a mapped cache
+class Reader
+{
+public:
+    Reader(const uint8_t * data, std::size_t size) : data_(data), end_(data + size) {}
+
+    uint8_t u8() { return static_cast<uint8_t>(integer(1)); }
+    uint16_t u16() { return static_cast<uint16_t>(integer(2)); }
+    uint32_t u32() { return static_cast<uint32_t>(integer(4)); }
+    uint64_t u64() { return integer(8); }
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    double f64()
+    {
+        uint64_t bits = u64();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    const uint8_t * bytes(std::size_t size)
+    {
+        need(size);
+        const uint8_t * data = data_;
+        data_ += size;
+        return data;
+    }
+
+    // Reads an interned string
+    std::string str() { return std::string(strings_.at(u32())); }
+
+    // Reads a count of records that each take at least `minSize` bytes
+    uint32_t count(std::size_t minSize)
+    {
+        uint32_t count = u32();
+        if (minSize != 0 && count > static_cast<std::size_t>(end_ - data_) / minSize)
+            throw std::runtime_error("definition cache is truncated");
+        return count;
+    }
+
+    void readStrings()
+    {
+        uint32_t size = count(4);
+        const uint8_t * offsets = bytes((static_cast<std::size_t>(size) + 1) * 4);
+        auto offset = [offsets](std::size_t i) {
+            return static_cast<uint32_t>(offsets[i * 4]) | (static_cast<uint32_t>(offsets[i * 4 + 1]) << 8) |
+                   (static_cast<uint32_t>(offsets[i * 4 + 2]) << 16) |
+                   (static_cast<uint32_t>(offsets[i * 4 + 3]) << 24);
+        };
+
+        const uint32_t blobSize = offset(size);
+        const char * blob = reinterpret_cast<const char *>(bytes(blobSize));
+
+        strings_.reserve(size);
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            uint32_t begin = offset(i), end = offset(i + 1);
+            if (begin > end || end > blobSize)
+                throw std::runtime_error("definition cache has an invalid string table");
+            strings_.emplace_back(blob + begin, end - begin);
+        }
+    }
+
+    inline bool atEnd() const noexcept { return data_ == end_; }
+
+private:
+    const uint8_t * data_;
+    const uint8_t * end_;
+    // Views into the mapped file
+    std::vector<std::string_view> strings_;
+
+    void need(std::size_t size) const
+    {
+        if (static_cast<std::size_t>(end_ - data_) < size)
+            throw std::runtime_error("definition cache is truncated");
+    }
+
+    uint64_t integer(int size)
+    {
+        need(size);
+        uint64_t value = 0;
+        for (int i = 0; i < size; ++i)
+            value |= static_cast<uint64_t>(data_[i]) << (i * 8);
+        data_ += size;
+        return value;
+    }
+};
+
+void writeAxisRef(Writer & w, const std::string & id, const std::unordered_map<std::string, uint32_t> & axes)
+{
+    if (id.empty())
+    {
+        w.u8(static_cast<uint8_t>(AxisRef::None));
+        w.u32(none);
+    }
+    else if (auto it = axes.find(id); it != axes.end())
+    {
+        w.u8(static_cast<uint8_t>(AxisRef::Index));
+        w.u32(it->second);
+    }
+    else
+    {
+        w.u8(static_cast<uint8_t>(AxisRef::Name));
+        w.str(id);
+    }
+}
+
+std::string readAxisRef(Reader & r, const std::vector<std::string> & axes)
+{
+    auto kind = static_cast<AxisRef>(r.u8());
+    switch (kind)
+    {
+    case AxisRef::None:
+        r.u32();
+        return std::string();
+    case AxisRef::Index:
+        return axes.at(r.u32());
+    case AxisRef::Name:
+        return r.str();
+    default:
+        throw std::runtime_error("definition cache has an invalid axis reference");
+    }
+}
+
+void writeOptionalU32(Writer & w, const std::optional<uint32_t> & value)
+{
+    w.u8(value.has_value());
+    w.u32(value.value_or(0));
+}
+
+std::optional<uint32_t> readOptionalU32(Reader & r)
+{
+    bool present = r.u8() != 0;
+    uint32_t value = r.u32();
+    if (!present)
+        return std::nullopt;
+    return value;
+}
+
+void writeModel(Writer & w, const Model & model, const std::unordered_map<std::string, uint32_t> & tables)
+{
+    w.str(model.id);
+    w.str(model.name);
+
+    w.u32(static_cast<uint32_t>(model.tables.size()));
+    for (const auto & [id, table] : model.tables)
+    {
+        w.u32(tables.at(id));
+        w.u8(table.offset.has_value());
+        w.i32(table.offset.value_or(0));
+    }
+
+    w.u32(static_cast<uint32_t>(model.axisOffsets.size()));
+    for (const auto & [id, offset] : model.axisOffsets)
+    {
+        w.str(id);
+        w.u64(offset);
+    }
+
+    w.u32(static_cast<uint32_t>(model.identifiers.size()));
+    for (const Identifier & identifier : model.identifiers)
+    {
+        w.u32(identifier.offset());
+        w.u32(static_cast<uint32_t>(identifier.size()));
+        w.bytes(identifier.data(), identifier.size());
+    }
+
+    const auto & checksums = model.checksums.definitions();
+    if (checksums.size() != model.checksums.size())
+        throw std::runtime_error("model '" + model.id + "' has checksums without definitions");
+    w.u32(static_cast<uint32_t>(checksums.size()));
+    for (const ChecksumDefinition & checksum : checksums)
+    {
+        w.str(checksum.mode);
+        w.i32(checksum.options.offset);
+        w.i32(checksum.options.size);
+        w.u32(checksum.options.target);
+        w.u8(static_cast<uint8_t>(checksum.options.endianness));
+        w.u8(static_cast<uint8_t>(checksum.options.final));
+        writeOptionalU32(w, checksum.options.init);
+        writeOptionalU32(w, checksum.options.xorOut);
+        w.u32(static_cast<uint32_t>(checksum.modifiable.size()));
+        for (const auto & [offset, size] : checksum.modifiable)
+        {
+            w.i32(offset);
+            w.i32(size);
+        }
+    }
+}
+
+ModelPtr readModel(Reader & r, const PlatformPtr & platform, const std::vector<const TableDefinition *> & tables)
+{
+    auto model = std::make_shared<Model>(platform);
+    model->id = r.str();
+    model->name = r.str();
+
+    for (uint32_t i = 0, count = r.count(9); i < count; ++i)
+    {
+        TableDefinition table(*tables.at(r.u32()));
+        bool hasOffset = r.u8() != 0;
+        int32_t offset = r.i32();
+        if (hasOffset)
+            table.offset = offset;
+        std::string id = table.id;
+        model->tables.emplace(std::move(id), std::move(table));
+    }
+
+    for (uint32_t i = 0, count = r.count(12); i < count; ++i)
+    {
+        std::string id = r.str();
+        model->axisOffsets.emplace(std::move(id), static_cast<std::size_t>(r.u64()));
+    }
+
+    for (uint32_t i = 0, count = r.count(8); i < count; ++i)
+    {
+        uint32_t offset = r.u32();
+        uint32_t size = r.u32();
+        const uint8_t * data = r.bytes(size);
+        model->identifiers.emplace_back(offset, data, data + size);
+    }
+
+    for (uint32_t i = 0, count = r.count(30); i < count; ++i)
+    {
+        ChecksumDefinition checksum;
+        checksum.mode = r.str();
+        checksum.options.offset = r.i32();
+        checksum.options.size = r.i32();
+        checksum.options.target = r.u32();
+        checksum.options.endianness = static_cast<Endianness>(r.u8());
+        checksum.options.final = static_cast<ChecksumFinal>(r.u8());
+        checksum.options.init = readOptionalU32(r);
+        checksum.options.xorOut = readOptionalU32(r);
+        for (uint32_t m = 0, modCount = r.count(8); m < modCount; ++m)
+        {
+            int32_t offset = r.i32();
+            int32_t size = r.i32();
+            checksum.modifiable.emplace_back(offset, size);
+        }
+        model->checksums.add(checksum);
+    }
+
+    return model;
+}
+
+void writePlatform(Writer & w, const Platform & platform)
+{
+    w.str(platform.name);
+    w.str(platform.id);
+    w.str(platform.downloadMode);
+    w.str(platform.flashMode);
+    w.u32(platform.baudrate);
+    w.str(platform.logMode);
+    w.str(platform.downloadAuthOptions.key);
+    w.u8(platform.downloadAuthOptions.session);
+    w.str(platform.flashAuthOptions.key);
+    w.u8(platform.flashAuthOptions.session);
+    w.u32(platform.serverId);
+    w.u64(platform.flashOffset);
+    w.u64(platform.flashSize);
+    w.u8(static_cast<uint8_t>(platform.endianness));
+    w.i32(platform.lastAxisId);
+    w.u32(platform.romsize);
+
+    // Axes, indexed by their position
+    std::unordered_map<std::string, uint32_t> axisIndices;
+    w.u32(static_cast<uint32_t>(platform.axes.size()));
+    for (const auto & [id, axis] : platform.axes)
+    {
+        axisIndices.emplace(id, static_cast<uint32_t>(axisIndices.size()));
+        w.str(id);
+        w.str(axis.id);
+        w.str(axis.name);
+        w.u8(static_cast<uint8_t>(axis.dataType));
+        if (const auto * linear = std::get_if<LinearAxisDefinition>(&axis.def))
+        {
+            w.u8(0);
+            w.f64(linear->start);
+            w.f64(linear->increment);
+            w.i32(linear->size);
+        }
+        else
+        {
+            w.u8(1);
+            w.i32(std::get<MemoryAxisDefinition>(axis.def).size);
+        }
+    }
+
+    // Tables, indexed by their position
+    std::unordered_map<std::string, uint32_t> tableIndices;
+    w.u32(static_cast<uint32_t>(platform.tables.size()));
+    for (const auto & [id, table] : platform.tables)
+    {
+        tableIndices.emplace(id, static_cast<uint32_t>(tableIndices.size()));
+        w.str(id);
+        w.str(table.id);
+        w.str(table.name);
+        w.str(table.description);
+        w.str(table.category);
+        w.str(table.unit);
+        w.u8(static_cast<uint8_t>(table.dataType));
+        w.u8(static_cast<uint8_t>(table.storedDataType));
+        w.i32(table.width);
+        w.i32(table.height);
+        w.f64(table.maximum);
+        w.f64(table.minimum);
+        w.f64(table.scale);
+        writeAxisRef(w, table.axisX, axisIndices);
+        writeAxisRef(w, table.axisY, axisIndices);
+        w.u8(table.offset.has_value());
+        w.i32(table.offset.value_or(0));
+    }
+
+    w.u32(static_cast<uint32_t>(platform.pids.size()));
+    for (const Pid & pid : platform.pids)
+    {
+        w.u16(pid.code);
+        w.str(pid.name);
+        w.str(pid.description);
+        w.str(pid.formula);
+        w.str(pid.unit);
+    }
+
+    w.u32(static_cast<uint32_t>(platform.vins.patterns().size()));
+    for (const std::string & pattern : platform.vins.patterns())
+        w.str(pattern);
+
+    w.u32(static_cast<uint32_t>(platform.models.size()));
+    for (const ModelPtr & model : platform.models)
+        writeModel(w, *model, tableIndices);
+}
+
+PlatformPtr readPlatform(Reader & r)
+{
+    auto platform = std::make_shared<Platform>();
+    platform->name = r.str();
+    platform->id = r.str();
+    platform->downloadMode = r.str();
+    platform->flashMode = r.str();
+    platform->baudrate = r.u32();
+    platform->logMode = r.str();
+    platform->downloadAuthOptions.key = r.str();
+    platform->downloadAuthOptions.session = r.u8();
+    platform->flashAuthOptions.key = r.str();
+    platform->flashAuthOptions.session = r.u8();
+    platform->serverId = r.u32();
+    platform->flashOffset = static_cast<std::size_t>(r.u64());
+    platform->flashSize = static_cast<std::size_t>(r.u64());
+    platform->endianness = static_cast<Endianness>(r.u8());
+    platform->lastAxisId = r.i32();
+    platform->romsize = r.u32();
+
+    std::vector<std::string> axisIds;
+    for (uint32_t i = 0, count = r.count(14); i < count; ++i)
+    {
+        std::string id = r.str();
+        AxisDefinition axis;
+        axis.id = r.str();
+        axis.name = r.str();
+        axis.dataType = static_cast<DataType>(r.u8());
+        if (r.u8() == 0)
+        {
+            LinearAxisDefinition linear;
+            linear.start = r.f64();
+            linear.increment = r.f64();
+            linear.size = r.i32();
+            axis.def = linear;
+        }
+        else
+            axis.def = MemoryAxisDefinition{r.i32()};
+
+        axisIds.emplace_back(id);
+        platform->axes.emplace(std::move(id), std::move(axis));
+    }
+
+    std::vector<const TableDefinition *> tables;
+    for (uint32_t i = 0, count = r.count(76); i < count; ++i)
+    {
+        std::string id = r.str();
+        TableDefinition table;
+        table.id = r.str();
+        table.name = r.str();
+        table.description = r.str();
+        table.category = r.str();
+        table.unit = r.str();
+        table.dataType = static_cast<DataType>(r.u8());
+        table.storedDataType = static_cast<DataType>(r.u8());
+        table.width = r.i32();
+        table.height = r.i32();
+        table.maximum = r.f64();
+        table.minimum = r.f64();
+        table.scale = r.f64();
+        table.axisX = readAxisRef(r, axisIds);
+        table.axisY = readAxisRef(r, axisIds);
+        bool hasOffset = r.u8() != 0;
+        int32_t offset = r.i32();
+        if (hasOffset)
+            table.offset = offset;
+
+        // Node-based map; pointers stay valid as more tables are inserted
+        auto [it, inserted] = platform->tables.emplace(std::move(id), std::move(table));
+        tables.emplace_back(&it->second);
+    }
+
+    for (uint32_t i = 0, count = r.count(18); i < count; ++i)
+    {
+        Pid pid;
+        pid.code = r.u16();
+        pid.name = r.str();
+        pid.description = r.str();
+        pid.formula = r.str();
+        pid.unit = r.str();
+        platform->pids.emplace_back(std::move(pid));
+    }
+
+    for (uint32_t i = 0, count = r.count(4); i < count; ++i)
+        platform->vins.add(r.str());
+
+    for (uint32_t i = 0, count = r.count(24); i < count; ++i)
+        platform->models.emplace_back(readModel(r, platform, tables));
+    platform->indexModels();
+
+    return platform;
+}
+} // namespace
+
+Digest DefinitionCache::hashSources(const fs::path & path)
+{
+    std::vector<fs::path> files;
+    for (const auto & dir : fs::directory_iterator(path))
+    {
+        if (!dir.is_directory())
+            continue;
+        for (const auto & entry : fs::directory_iterator(dir.path()))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".json")
+                files.emplace_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    Sha256 hasher;
+    std::vector<char> buffer(1 << 16);
+    for (const fs::path & file : files)
+    {
+        // Include the name so moving a model between platforms changes the
+        // hash
+        std::string name = fs::relative(file, path).generic_string();
+        hasher.update(reinterpret_cast<const uint8_t *>(name.c_str()), name.size() + 1);
+
+        std::ifstream stream(file, std::ios::binary);
+        if (!stream.is_open())
+            throw std::runtime_error("failed to open definition '" + file.string() + "'");
+        while (stream)
+        {
+            stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            hasher.update(reinterpret_cast<const uint8_t *>(buffer.data()), static_cast<std::size_t>(stream.gcount()));
+        }
+        // Separates the contents of adjacent files
+        uint8_t end = 0;
+        hasher.update(&end, 1);
+    }
+    return hasher.finish();
+}
+
+void DefinitionCache::write(const fs::path & file, const Digest & sources, const std::vector<PlatformPtr> & platforms)
+{
+    Writer w;
+    w.u32(static_cast<uint32_t>(platforms.size()));
+    for (const PlatformPtr & platform : platforms)
+        writePlatform(w, *platform);
+
+    // Header and string table
+    Writer header;
+    header.bytes(reinterpret_cast<const uint8_t *>(magic), sizeof(magic));
+    header.u32(version);
+    header.bytes(sources.data(), sources.size());
+
+    const auto & strings = w.strings();
+    header.u32(static_cast<uint32_t>(strings.size()));
+    uint32_t offset = 0;
+    for (const std::string & string : strings)
+    {
+        header.u32(offset);
+        offset += static_cast<uint32_t>(string.size());
+    }
+    header.u32(offset);
+    for (const std::string & string : strings)
+        header.bytes(reinterpret_cast<const uint8_t *>(string.data()), string.size());
+
+    fs::path temp = file;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!out.is_open())
+            throw std::runtime_error("failed to open definition cache '" + temp.string() + "' for writing");
+        out.write(reinterpret_cast<const char *>(header.body().data()),
+                  static_cast<std::streamsize>(header.body().size()));
+        out.write(reinterpret_cast<const char *>(w.body().data()), static_cast<std::streamsize>(w.body().size()));
+        if (!out)
+            throw std::runtime_error("failed to write definition cache '" + temp.string() + "'");
+    }
+    fs::rename(temp, file);
+}
+
+bool DefinitionCache::read(const fs::path & file, const Digest & sources, std::vector<PlatformPtr> & platforms)
+{
+    std::error_code ec;
+    if (!fs::is_regular_file(file, ec))
+        return false;
+
+    try
+    {
+        os::MappedFile map(file);
+        Reader r(map.data(), map.size());
+
+        if (std::memcmp(r.bytes(sizeof(magic)), magic, sizeof(magic)) != 0 || r.u32() != version)
+            return false;
+        if (std::memcmp(r.bytes(sources.size()), sources.data(), sources.size()) != 0)
+            return false;
+        r.readStrings();
+
+        std::vector<PlatformPtr> loaded;
+        for (uint32_t i = 0, count = r.count(1); i < count; ++i)
+            loaded.emplace_back(readPlatform(r));
+        if (!r.atEnd())
+            return false;
+
+        platforms.insert(platforms.end(), loaded.begin(), loaded.end());
+        return true;
+    }
+    catch (const std::exception &)
+    {
+        // A corrupt cache is rebuilt from the sources
+        return false;
+    }
+}
+
+} // namespace lt
@@ -0,0 +1,41 @@
+#ifndef LT_DEFINITIONCACHE_H
+#define LT_DEFINITIONCACHE_H
+
+#include <filesystem>
+#include <vector>
+
+#include "../support/hash.h"
+#include "platform.h"
+
+namespace lt
+{
+
+/* Compiled binary form of loaded platform definitions. Strings are interned
+ * into a single table, records are flat arrays, and table references from
+ * models and tables to axes are integer indices. The cache is keyed by
+ * the hash of the JSON sources it was built from. */
+class DefinitionCache
+{
+public:
+    // Incremented whenever the layout changes
+    static constexpr uint32_t version = 1;
+
+    /* Hashes every definition source under `path` (the directory passed
+     * to Platforms::loadDirectory) in a stable order. */
+    static Digest hashSources(const std::filesystem::path & path);
+
+    /* Writes `platforms` to `file`. The file is written to a temporary
+     * path and renamed so readers never see a partial cache. */
+    static void write(const std::filesystem::path & file, const Digest & sources,
+                      const std::vector<PlatformPtr> & platforms);
+
+    /* Reads platforms from `file`. Returns false if the file does not exist,
+     * has a different version, was built from other sources or is
+     * corrupt. */
+    static bool read(const std::filesystem::path & file, const Digest & sources,
+                     std::vector<PlatformPtr> & platforms);
+};
+
+} // namespace lt
+
+#endif // LT_DEFINITIONCACHE_H
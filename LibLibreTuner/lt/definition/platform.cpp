@@ -1,43 +1,56 @@
 #include "platform.h"
+#include "checksumregistry.h"
+#include "definitioncache.h"
+#include "../support/parallel.h"
 #include "../support/util.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <nlohmann/json.hpp>
 
 namespace fs = std::filesystem;
 using json = nlohmann::json;
 
-namespace nlohmann
+namespace lt
 {
-template<>
-struct adl_serializer<lt::ChecksumPtr>
+NLOHMANN_JSON_SERIALIZE_ENUM(Endianness, {
+    {Endianness::Big, "big"},
+    {Endianness::Little, "little"},
+})
+
+NLOHMANN_JSON_SERIALIZE_ENUM(ChecksumFinal, {
+    {ChecksumFinal::None, "none"},
+    {ChecksumFinal::Invert, "invert"},
+    {ChecksumFinal::Negate, "negate"},
+})
+
+void from_json(const json & j, ChecksumDefinition & checksum)
 {
-    static lt::ChecksumPtr from_json(const json & j)
+    j.at("mode").get_to(checksum.mode);
+
+    ChecksumOptions & options = checksum.options;
+    options.offset = j.at("offset").get<int>();
+    options.size = j.at("size").get<int>();
+    options.target = j.at("target").get<uint32_t>();
+    if (auto it = j.find("endianness"); it != j.end())
+        it->get_to(options.endianness);
+    if (auto it = j.find("final"); it != j.end())
+        it->get_to(options.final);
+    if (auto it = j.find("init"); it != j.end())
+        options.init = it->get<uint32_t>();
+    if (auto it = j.find("xorout"); it != j.end())
+        options.xorOut = it->get<uint32_t>();
+
+    if (auto it = j.find("modify"); it != j.end())
     {
-        const auto & mode = j.at("mode").get<std::string>();
-        const auto offset = j.at("offset").get<std::size_t>();
-        const auto size = j.at("size").get<std::size_t>();
-        const auto target = j.at("target").get<std::size_t>();
-
-        lt::ChecksumPtr sum;
-        if (mode == "basic")
-            sum = lt::ChecksumPtr(new lt::ChecksumBasic(offset, size, target));
-        else
-            throw std::runtime_error("invalid mode for checksum");
-
-        if (auto it = j.find("modify"); it != j.end())
+        for (auto & section : *it)
         {
-            for (auto & section : *it)
-            {
-                sum->addModifiable(section.at("offset").get<std::size_t>(),
-                                   section.at("size").get<std::size_t>());
-            }
+            checksum.modifiable.emplace_back(section.at("offset").get<int>(),
+                                             section.at("size").get<int>());
         }
-
-        return sum;
     }
-};
 }
+} // namespace lt
 
 namespace lt
 {
@@ -135,11 +148,6 @@ void from_json(const json & j, lt::AxisDefinition & axis)
         throw std::runtime_error("invalid axis type '" + type + "'");
 }
 
-NLOHMANN_JSON_SERIALIZE_ENUM(Endianness, {
-    {Endianness::Big, "big"},
-    {Endianness::Little, "little"},
-})
-
 void from_json(const json & j, lt::Platform & platform)
 {
     j.at("id").get_to(platform.id);
@@ -197,7 +205,7 @@ void from_json(const json & j, lt::Platform & platform)
     // VIN patterns
     for (const auto & vin : j.at("vins"))
     {
-        platform.vins.emplace_back(vin.get<std::string>());
+        platform.vins.add(vin.get<std::string>());
     }
 
     if (auto axes = j.find("axes"); axes != j.end())
@@ -261,12 +269,19 @@ const AxisDefinition * Platform::getAxis(const std::string & id) const noexcept
 
 ModelPtr Platform::identify(const uint8_t * data, size_t size) const noexcept
 {
+    return signatures.identify(data, size);
+}
+
+void Platform::indexModels()
+{
+    signatures.clear();
     for (const ModelPtr & model : models)
-    {
-        if (model->isModel(data, size))
-            return model;
-    }
-    return ModelPtr();
+        signatures.add(model);
+}
+
+bool Platform::matchVin(const std::string & vin) const noexcept
+{
+    return vins.match(vin);
 }
 
 const Pid * Platform::getPid(uint32_t code) const noexcept
@@ -344,7 +359,7 @@ void decodeModel(const json & j,
     {
         for (const auto & node : *checksums)
         {
-            model.checksums.add(node.get<ChecksumPtr>());
+            model.checksums.add(node.get<ChecksumDefinition>());
         }
     }
 }
@@ -371,6 +386,7 @@ PlatformPtr Platform::loadDirectory(const std::filesystem::path & base_path)
         decodeModel(j, *model);
         platform->models.emplace_back(std::move(model));
     }
+    platform->indexModels();
     return platform;
 }
 
@@ -393,11 +409,75 @@ void Platforms::loadDirectory(const std::filesystem::path & path)
         if (entry.is_directory())
         {
             // Convert to shared_ptr and store
-            platforms_.emplace_back(Platform::loadDirectory(entry.path()));
+            add(Platform::loadDirectory(entry.path()));
         }
     }
 }
 
+void Platforms::loadDirectory(const fs::path & path, const fs::path & cachePath)
+{
+    const Digest sources = DefinitionCache::hashSources(path);
+
+    std::vector<PlatformPtr> cached;
+    if (DefinitionCache::read(cachePath, sources, cached))
+    {
+        for (PlatformPtr & platform : cached)
+            add(std::move(platform));
+        return;
+    }
+
+    const std::size_t first = platforms_.size();
+    loadDirectory(path);
+
+    try
+    {
+        DefinitionCache::write(cachePath, sources,
+                               std::vector<PlatformPtr>(platforms_.begin() + first, platforms_.end()));
+    }
+    catch (const std::exception &)
+    {
+        // The cache is only an optimization
+    }
+}
+
+void Platforms::add(PlatformPtr platform)
+{
+    for (const ModelPtr & model : platform->models)
+        signatures_.add(model);
+    platforms_.emplace_back(std::move(platform));
+}
+
+ModelPtr Platforms::identify(const uint8_t * data, size_t size) const noexcept
+{
+    return signatures_.identify(data, size);
+}
+
+std::vector<IdentifyResult> Platforms::identifyFiles(const std::vector<fs::path> & paths, JobPool & pool) const
+{
+    std::vector<IdentifyResult> results(paths.size());
+
+    // Identifiers never extend past the extent, so the rest of the file
+    // does not need to be read
+    const std::size_t extent = signatures_.extent();
+
+    parallelFor(pool, 0, paths.size(), [&](std::size_t i) {
+        IdentifyResult & result = results[i];
+        result.path = paths[i];
+
+        std::ifstream file(paths[i], std::ios::binary | std::ios::in);
+        if (!file.is_open())
+        {
+            result.error = "failed to open file";
+            return;
+        }
+        std::vector<uint8_t> buffer(extent);
+        file.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(extent));
+        result.model = identify(buffer.data(), static_cast<std::size_t>(file.gcount()));
+    });
+
+    return results;
+}
+
 PlatformPtr Platforms::first() const noexcept
 {
     if (platforms_.empty())
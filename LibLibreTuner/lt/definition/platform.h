@@ -2,15 +2,17 @@
 #define LT_PLATFORM_H
 
 #include <filesystem>
-#include <regex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "../auth/auth.h"
 #include "../datalog/pid.h"
+#include "../support/job.h"
 #include "../support/types.h"
 #include "model.h"
+#include "signatureindex.h"
+#include "vinmatcher.h"
 #include "table.h"
 
 namespace lt
@@ -49,8 +51,16 @@ struct Platform
     std::vector<Pid> pids;
     // axes MUST NOT change after initialization
     std::unordered_map<std::string, AxisDefinition> axes;
+    // models MUST NOT change after initialization, or indexModels() must
+    // be called again
     std::vector<ModelPtr> models;
-    std::vector<std::regex> vins;
+    VinMatcher vins;
+
+    // Identifier index of `models`
+    SignatureIndex signatures;
+
+    // Rebuilds the signature index from `models`
+    void indexModels();
 
     /* Returns true if the supplied VIN matches any pattern in vins */
     bool matchVin(const std::string & vin) const noexcept;
@@ -85,6 +95,16 @@ struct Platform
     static PlatformPtr loadDirectory(const std::filesystem::path & path);
 };
 
+// Result of identifying a ROM file
+struct IdentifyResult
+{
+    std::filesystem::path path;
+    // nullptr if no model matches
+    ModelPtr model;
+    // Set if the file could not be read
+    std::string error;
+};
+
 // Loads and stores platforms
 class Platforms
 {
@@ -99,6 +119,11 @@ public:
      */
     void loadDirectory(const std::filesystem::path & path);
 
+    /* Loads definitions from `path` using the compiled cache at
+     * `cachePath`. The cache is rebuilt when any definition changes;
+     * failing to write it is not an error. */
+    void loadDirectory(const std::filesystem::path & path, const std::filesystem::path & cachePath);
+
     /* Searches for a platform with id `id`. Returns
      * a null pointer if the search fails. */
     PlatformPtr find(const std::string & id) const noexcept;
@@ -109,6 +134,16 @@ public:
     ModelPtr find(const std::string & platformId,
                   const std::string & modelId) const noexcept;
 
+    /* Attempts to determine the model of the data from the models of all
+     * platforms. Returns nullptr if no models match. */
+    ModelPtr identify(const uint8_t * data, size_t size) const noexcept;
+
+    /* Identifies ROM files in parallel on `pool`. Only the leading bytes
+     * needed for identification are read. Results are in the order of
+     * `paths`. */
+    std::vector<IdentifyResult> identifyFiles(const std::vector<std::filesystem::path> & paths,
+                                              JobPool & pool = JobPool::global()) const;
+
     inline std::size_t size() const noexcept { return platforms_.size(); }
 
     /* Returns the first platform in the database. Returns PlatformPtr() if
@@ -125,6 +160,10 @@ public:
 
 private:
     std::vector<PlatformPtr> platforms_;
+    // Identifier index of the models of all platforms
+    SignatureIndex signatures_;
+
+    void add(PlatformPtr platform);
 };
 
 } // namespace lt
@@ -0,0 +1,93 @@
+#include "regionindex.h"
+
+#include <algorithm>
+
+#include "model.h"
+#include "platform.h"
+
+namespace lt
+{
+
+RegionIndex::RegionIndex(const Model & model)
+{
+    for (const auto & [id, table] : model.tables)
+    {
+        if (!table.offset || *table.offset < 0)
+            continue;
+        auto begin = static_cast<std::size_t>(*table.offset);
+        regions_.push_back(Region{begin, begin + static_cast<std::size_t>(table.byteSize()), RegionKind::Table, id,
+                                  table.name});
+    }
+
+    if (PlatformPtr platform = model.platform())
+    {
+        for (const auto & [id, offset] : model.axisOffsets)
+        {
+            auto it = platform->axes.find(id);
+            if (it == platform->axes.end())
+                continue;
+
+            // Linear axes are computed, not stored
+            const auto * memory = std::get_if<MemoryAxisDefinition>(&it->second.def);
+            if (memory == nullptr)
+                continue;
+            std::size_t size = dataTypeSize(it->second.dataType) * static_cast<std::size_t>(memory->size);
+            regions_.push_back(Region{offset, offset + size, RegionKind::Axis, id, it->second.name});
+        }
+    }
+
+    build();
+}
+
+RegionIndex::RegionIndex(std::vector<Region> regions) : regions_(std::move(regions)) { build(); }
+
+void RegionIndex::build()
+{
+    // Empty regions can never be found
+    regions_.erase(std::remove_if(regions_.begin(), regions_.end(),
+                                  [](const Region & region) { return region.end <= region.begin; }),
+                   regions_.end());
+    std::sort(regions_.begin(), regions_.end(), [](const Region & a, const Region & b) {
+        return a.begin != b.begin ? a.begin < b.begin : a.end < b.end;
+    });
+
+    maxEnd_.resize(regions_.size());
+    std::size_t maxEnd = 0;
+    for (std::size_t i = 0; i < regions_.size(); ++i)
+    {
+        maxEnd = std::max(maxEnd, regions_[i].end);
+        maxEnd_[i] = maxEnd;
+    }
+}
+
+const Region * RegionIndex::find(std::size_t offset) const noexcept
+{
+    // Regions starting after `offset` cannot contain it
+    auto last = std::upper_bound(regions_.begin(), regions_.end(), offset,
+                                 [](std::size_t offset, const Region & region) { return offset < region.begin; });
+    for (auto i = static_cast<std::size_t>(last - regions_.begin()); i > 0 && maxEnd_[i - 1] > offset; --i)
+    {
+        if (regions_[i - 1].end > offset)
+            return &regions_[i - 1];
+    }
+    return nullptr;
+}
+
+std::vector<const Region *> RegionIndex::overlapping(std::size_t begin, std::size_t end) const
+{
+    std::vector<const Region *> result;
+    if (end <= begin)
+        return result;
+
+    auto last = std::lower_bound(regions_.begin(), regions_.end(), end,
+                                 [](const Region & region, std::size_t end) { return region.begin < end; });
+    for (auto i = static_cast<std::size_t>(last - regions_.begin()); i > 0 && maxEnd_[i - 1] > begin; --i)
+    {
+        if (regions_[i - 1].end > begin)
+            result.push_back(&regions_[i - 1]);
+    }
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+} // namespace lt
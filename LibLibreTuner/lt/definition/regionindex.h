@@ -0,0 +1,65 @@
+#ifndef LT_REGIONINDEX_H
+#define LT_REGIONINDEX_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lt
+{
+
+struct Model;
+
+enum class RegionKind
+{
+    Table,
+    Axis,
+};
+
+// Bytes [begin, end) of a table or axis in ROM data
+struct Region
+{
+    std::size_t begin;
+    std::size_t end;
+    RegionKind kind;
+    std::string id;
+    std::string name;
+};
+
+/* Interval index of the table and axis regions of a model. Regions are
+ * sorted by start and keep a running maximum of their ends. A query is a
+ * binary search followed by a backward walk that stops once no earlier
+ * region can reach the queried offset, which is immediate unless regions
+ * overlap. */
+class RegionIndex
+{
+public:
+    RegionIndex() = default;
+
+    // Indexes every table with an offset and every memory axis of the model
+    explicit RegionIndex(const Model & model);
+
+    explicit RegionIndex(std::vector<Region> regions);
+
+    /* Returns the region containing `offset`, or nullptr. If regions
+     * overlap, the one starting last is returned. */
+    const Region * find(std::size_t offset) const noexcept;
+
+    // Returns the regions overlapping [begin, end), ordered by start
+    std::vector<const Region *> overlapping(std::size_t begin, std::size_t end) const;
+
+    // Regions ordered by start
+    inline const std::vector<Region> & regions() const noexcept { return regions_; }
+    inline bool empty() const noexcept { return regions_.empty(); }
+
+private:
+    std::vector<Region> regions_;
+    // maxEnd_[i] is the largest end of regions_[0..i]
+    std::vector<std::size_t> maxEnd_;
+
+    void build();
+};
+
+} // namespace lt
+
+#endif // LT_REGIONINDEX_H
@@ -0,0 +1,80 @@
+#include "signatureindex.h"
+
+#include <algorithm>
+
+namespace lt
+{
+
+uint64_t SignatureIndex::makeKey(const uint8_t * data, std::size_t length) noexcept
+{
+    uint64_t key = 0;
+    for (std::size_t i = 0; i < length; ++i)
+        key = (key << 8) | data[i];
+    return key;
+}
+
+void SignatureIndex::add(const ModelPtr & model)
+{
+    if (!model || model->identifiers.empty())
+        return;
+
+    // Key on the longest identifier; it is the most selective
+    const Identifier & identifier =
+        *std::max_element(model->identifiers.begin(), model->identifiers.end(),
+                          [](const Identifier & a, const Identifier & b) { return a.size() < b.size(); });
+
+    for (const Identifier & id : model->identifiers)
+        extent_ = std::max<std::size_t>(extent_, id.offset() + id.size());
+
+    std::size_t length = std::min(identifier.size(), keyLength);
+    auto it = std::find_if(probes_.begin(), probes_.end(), [&](const Probe & probe) {
+        return probe.offset == identifier.offset() && probe.length == length;
+    });
+    if (it == probes_.end())
+        it = probes_.insert(probes_.end(), Probe{identifier.offset(), length, {}});
+
+    it->models[makeKey(identifier.data(), length)].emplace_back(model);
+}
+
+void SignatureIndex::clear() noexcept
+{
+    probes_.clear();
+    extent_ = 0;
+}
+
+ModelPtr SignatureIndex::identify(const uint8_t * data, std::size_t size) const noexcept
+{
+    for (const Probe & probe : probes_)
+    {
+        if (probe.offset + probe.length > size)
+            continue;
+
+        auto it = probe.models.find(makeKey(data + probe.offset, probe.length));
+        if (it == probe.models.end())
+            continue;
+
+        for (const ModelPtr & model : it->second)
+        {
+            if (model->isModel(data, size))
+                return model;
+        }
+    }
+    return ModelPtr();
+}
+
+std::vector<ModelPtr> SignatureIndex::candidates(const uint8_t * data, std::size_t size) const
+{
+    std::vector<ModelPtr> result;
+    for (const Probe & probe : probes_)
+    {
+        if (probe.offset + probe.length > size)
+            continue;
+
+        auto it = probe.models.find(makeKey(data + probe.offset, probe.length));
+        if (it != probe.models.end())
+            result.insert(result.end(), it->second.begin(), it->second.end());
+    }
+    return result;
+}
+
+} // namespace lt
@@ -0,0 +1,59 @@
+#ifndef LT_SIGNATUREINDEX_H
+#define LT_SIGNATUREINDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "model.h"
+
+namespace lt
+{
+
+/* Maps the leading bytes of model identifiers to candidate models. Each
+ * distinct (offset, length) of indexed identifiers is a probe; identifying
+ * data costs one hash lookup per probe, then a full isModel() check for
+ * each candidate. */
+class SignatureIndex
+{
+public:
+    // Number of identifier bytes used as the key
+    static constexpr std::size_t keyLength = 8;
+
+    /* Adds a model to the index. Models without identifiers are
+     * unidentifiable and ignored. */
+    void add(const ModelPtr & model);
+
+    void clear() noexcept;
+
+    /* Returns the first indexed model that matches the data or nullptr
+     * if none match. */
+    ModelPtr identify(const uint8_t * data, std::size_t size) const noexcept;
+
+    // Returns all indexed models whose key matches the data. Candidates
+    // must still be verified with Model::isModel()
+    std::vector<ModelPtr> candidates(const uint8_t * data, std::size_t size) const;
+
+    /* Returns the number of leading bytes of a ROM needed to identify any
+     * indexed model. */
+    inline std::size_t extent() const noexcept { return extent_; }
+
+    inline bool empty() const noexcept { return probes_.empty(); }
+
+private:
+    struct Probe
+    {
+        std::size_t offset;
+        std::size_t length;
+        std::unordered_map<uint64_t, std::vector<ModelPtr>> models;
+    };
+
+    std::vector<Probe> probes_;
+    std::size_t extent_{0};
+
+    static uint64_t makeKey(const uint8_t * data, std::size_t length) noexcept;
+};
+
+} // namespace lt
+
+#endif // LT_SIGNATUREINDEX_H
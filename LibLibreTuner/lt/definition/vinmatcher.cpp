@@ -0,0 +1,46 @@
+#include "vinmatcher.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace lt
+{
+
+void VinMatcher::add(const std::string & pattern)
+{
+    bool simple = std::all_of(pattern.begin(), pattern.end(), [](char c) {
+        return c == '.' || std::isalnum(static_cast<unsigned char>(c));
+    });
+
+    if (simple)
+        masks_.push_back(Mask{pattern});
+    else
+        regexes_.emplace_back(pattern);
+    patterns_.emplace_back(pattern);
+}
+
+bool VinMatcher::match(const std::string & vin) const noexcept
+{
+    for (const Mask & mask : masks_)
+    {
+        if (mask.chars.size() != vin.size())
+            continue;
+
+        bool matches = true;
+        for (std::size_t i = 0; i < vin.size() && matches; ++i)
+        {
+            // As in ECMAScript regexes, '.' does not match line terminators
+            if (mask.chars[i] == '.')
+                matches = vin[i] != '\n' && vin[i] != '\r';
+            else
+                matches = mask.chars[i] == vin[i];
+        }
+        if (matches)
+            return true;
+    }
+
+    return std::any_of(regexes_.begin(), regexes_.end(),
+                       [&vin](const std::regex & regex) { return std::regex_match(vin, regex); });
+}
+
+} // namespace lt
@@ -0,0 +1,43 @@
+#ifndef LT_VINMATCHER_H
+#define LT_VINMATCHER_H
+
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace lt
+{
+
+/* Matches VINs against platform patterns. Patterns are regular expressions
+ * that must match the whole VIN. Patterns made only of literal characters
+ * and '.' wildcards, which covers the definitions in use, are compiled to
+ * a character mask and never touch std::regex. */
+class VinMatcher
+{
+public:
+    // Adds a pattern. Throws std::regex_error if the pattern is invalid.
+    void add(const std::string & pattern);
+
+    // Returns true if `vin` matches any pattern
+    bool match(const std::string & vin) const noexcept;
+
+    // Returns the source of all patterns, in the order they were added
+    inline const std::vector<std::string> & patterns() const noexcept { return patterns_; }
+
+    inline bool empty() const noexcept { return patterns_.empty(); }
+
+private:
+    // Fixed length pattern; '.' matches any character
+    struct Mask
+    {
+        std::string chars;
+    };
+
+    std::vector<std::string> patterns_;
+    std::vector<Mask> masks_;
+    std::vector<std::regex> regexes_;
+};
+
+} // namespace lt
+
+#endif // LT_VINMATCHER_H
@@ -0,0 +1,203 @@
+#include "vehiclescan.h"
+
+#include "async/whenall.h"
+#include "network/can/asynccan.h"
+#include "network/isotp/asyncisotp.h"
+#include "network/uds/asyncuds.h"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace lt
+{
+
+namespace
+{
+// OBD-II services
+constexpr uint8_t OBD_REQ_CODES = 0x03;
+constexpr uint8_t OBD_REQ_PENDING_CODES = 0x07;
+constexpr uint8_t OBD_REQ_INFO = 0x09;
+
+DiagnosticCodes decodeCodes(const network::UdsPacket & response)
+{
+    // The first byte is the number of codes on CAN
+    DiagnosticCodes result;
+    for (std::size_t i = 1; i + 1 < response.data.size(); i += 2)
+        result.emplace_back(DiagnosticCode{static_cast<uint16_t>((response.data[i] << 8) | response.data[i + 1])});
+    return result;
+}
+
+std::string decodeString(const network::UdsPacket & response)
+{
+    // Skips the PID and the number of data items
+    if (response.data.size() < 2)
+        return std::string();
+    std::string result(response.data.begin() + 2, response.data.end());
+    result.erase(std::remove(result.begin(), result.end(), '\0'), result.end());
+    return result;
+}
+
+async::Task<std::vector<uint32_t>> discover(async::EventLoop & loop, network::CanDemux & bus,
+                                            const VehicleScanOptions & options, async::CancellationToken token)
+{
+    if (options.discoveryRequest.empty() || options.discoveryRequest.size() > 7)
+        throw std::runtime_error("the discovery request must fit in a single frame");
+
+    std::vector<uint32_t> ids;
+    for (uint32_t id = options.firstResponseId; id <= options.lastResponseId; ++id)
+        ids.emplace_back(id);
+    network::AsyncCan can(loop, bus.open(ids));
+
+    network::CanMessage request;
+    request.setId(options.functionalId);
+    request[0] = static_cast<uint8_t>(options.discoveryRequest.size());
+    std::copy(options.discoveryRequest.begin(), options.discoveryRequest.end(), request.message() + 1);
+    request.setLength(static_cast<uint8_t>(options.discoveryRequest.size() + 1));
+    request.pad();
+    can.send(request);
+
+    // Every ECU answers within the window; collect them all at once instead
+    // of addressing each possible ID in turn
+    std::set<uint32_t> responders;
+    const auto deadline = async::Clock::now() + options.discoveryWindow;
+    while (auto frame = co_await can.recv(deadline, token))
+    {
+        // Any single or first frame marks a responder. Multi-frame responses
+        // are not continued.
+        uint8_t type = (*frame)[0] >> 4;
+        if (frame->length() != 0 && (type == 0 || type == 1))
+            responders.emplace(frame->id());
+    }
+    co_return std::vector<uint32_t>(responders.begin(), responders.end());
+}
+
+async::Task<void> probe(network::AsyncUds & uds, const VehicleScanOptions & options, EcuScanResult & result,
+                        async::CancellationToken token)
+{
+    // Runs one probe, recording failures other than cancellation
+    auto attempt = [&](std::string name, uint8_t sid, std::vector<uint8_t> data) -> async::Task<network::UdsPacket> {
+        try
+        {
+            network::UdsPacket response = co_await uds.requestRaw(sid, std::move(data), token);
+            if (response.negative())
+            {
+                std::stringstream ss;
+                ss << name << ": negative response 0x" << std::hex << static_cast<int>(response.negativeCode());
+                result.errors.emplace_back(ss.str());
+            }
+            co_return response;
+        }
+        catch (const async::OperationCanceled &)
+        {
+            throw;
+        }
+        catch (const std::exception & e)
+        {
+            result.errors.emplace_back(name + ": " + e.what());
+        }
+        co_return network::UdsPacket();
+    };
+
+    if (options.codes)
+    {
+        network::UdsPacket response = co_await attempt("codes", OBD_REQ_CODES, std::vector<uint8_t>());
+        if (response.code == OBD_REQ_CODES + 0x40)
+            result.codes = decodeCodes(response);
+
+        response = co_await attempt("pending codes", OBD_REQ_PENDING_CODES, std::vector<uint8_t>());
+        if (response.code == OBD_REQ_PENDING_CODES + 0x40)
+            result.pendingCodes = decodeCodes(response);
+    }
+
+    const std::pair<ScanPids, uint8_t> pids[] = {
+        {ScanPids::VIN, OBD_REQ_VIN},
+        {ScanPids::CalibrationID, OBD_REQ_CAL},
+        {ScanPids::ECUName, OBD_REQ_ECUNAME},
+    };
+    for (const auto & [flag, pid] : pids)
+    {
+        if ((options.pids & flag) == ScanPids::None)
+            continue;
+        std::vector<uint8_t> request(1, pid);
+        network::UdsPacket response =
+            co_await attempt("service 09 PID " + std::to_string(pid), OBD_REQ_INFO, std::move(request));
+        if (response.code != OBD_REQ_INFO + 0x40)
+            continue;
+
+        std::string value = decodeString(response);
+        if (flag == ScanPids::VIN)
+            result.info.vin = std::move(value);
+        else if (flag == ScanPids::CalibrationID)
+            result.info.calibration_id = std::move(value);
+        else
+            result.info.ecu_name = std::move(value);
+    }
+
+    for (uint8_t session : options.sessions)
+    {
+        std::vector<uint8_t> request(1, session);
+        network::UdsPacket response =
+            co_await attempt("session " + std::to_string(session), network::UDS_REQ_SESSION, std::move(request));
+        if (response.code == network::UDS_REQ_SESSION + 0x40)
+            result.sessions.emplace_back(session);
+    }
+
+    // Leave any session entered above. A timed out request may still have
+    // switched sessions, so this does not depend on the responses.
+    bool entered = std::any_of(options.sessions.begin(), options.sessions.end(),
+                               [](uint8_t session) { return session != 0x01; });
+    if (entered)
+        co_await attempt("default session", network::UDS_REQ_SESSION, std::vector<uint8_t>(1, 0x01));
+}
+
+// Owns the transport for one ECU
+struct EcuSession
+{
+    EcuSession(async::EventLoop & loop, network::CanDemux & bus, const network::IsoTpOptions & options)
+        : can(loop, bus.open(options.destId)), isotp(can, options), uds(isotp)
+    {
+    }
+
+    network::AsyncCan can;
+    network::AsyncIsoTp isotp;
+    network::AsyncUds uds;
+};
+} // namespace
+
+async::Task<std::vector<EcuScanResult>> scanVehicle(async::EventLoop & loop, network::CanDemux & bus,
+                                                    VehicleScanOptions options, async::CancellationToken token)
+{
+    std::vector<uint32_t> responders = co_await discover(loop, bus, options, token);
+
+    std::vector<EcuScanResult> results(responders.size());
+    std::vector<std::unique_ptr<EcuSession>> sessions;
+    std::vector<async::Task<void>> probes;
+    for (std::size_t i = 0; i < responders.size(); ++i)
+    {
+        EcuScanResult & result = results[i];
+        result.responseId = responders[i];
+        result.requestId = responders[i] - 8;
+
+        network::IsoTpOptions isotpOptions;
+        isotpOptions.sourceId = result.requestId;
+        isotpOptions.destId = result.responseId;
+        isotpOptions.timeout = options.timeout;
+        sessions.emplace_back(std::make_unique<EcuSession>(loop, bus, isotpOptions));
+        probes.emplace_back(probe(sessions.back()->uds, options, result, token));
+    }
+
+    co_await async::whenAll(loop, std::move(probes));
+    co_return results;
+}
+
+std::vector<EcuScanResult> scanVehicleBlocking(network::CanDemux & bus, const VehicleScanOptions & options,
+                                               async::CancellationToken token)
+{
+    async::EventLoop loop;
+    return loop.runUntilComplete(scanVehicle(loop, bus, options, std::move(token)));
+}
+
+} // namespace lt
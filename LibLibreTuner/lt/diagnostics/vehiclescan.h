@@ -0,0 +1,72 @@
+#ifndef LT_VEHICLESCAN_H
+#define LT_VEHICLESCAN_H
+
+#include "async/eventloop.h"
+#include "codes.h"
+#include "network/can/candemux.h"
+#include "vehicle_info.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lt
+{
+
+struct VehicleScanOptions
+{
+    // Functional (broadcast) request ID
+    uint32_t functionalId{0x7DF};
+    // Response IDs listened to during discovery. Physical request IDs are
+    // the response ID minus 8 (ISO 15765-4, 11 bit).
+    uint32_t firstResponseId{0x7E8};
+    uint32_t lastResponseId{0x7EF};
+    // Sent to every ECU at once. Defaults to OBD-II service 01 PID 00
+    // (supported PIDs), which every emissions-relevant ECU answers.
+    std::vector<uint8_t> discoveryRequest{0x01, 0x00};
+    // How long to collect responses to the functional request
+    std::chrono::milliseconds discoveryWindow{150};
+
+    // Per-frame timeout for the physical probes. Negative responses return
+    // immediately; only silent ECUs wait this long.
+    std::chrono::milliseconds timeout{250};
+
+    bool codes{true};
+    ScanPids pids{ScanPids::All};
+    // Diagnostic sessions to probe with DiagnosticSessionControl. The
+    // programming session (0x02) is not probed unless added here, as some
+    // ECUs stop normal operation when entering it.
+    std::vector<uint8_t> sessions{0x01, 0x03};
+};
+
+struct EcuScanResult
+{
+    uint32_t requestId{0};
+    uint32_t responseId{0};
+
+    DiagnosticCodes codes;
+    DiagnosticCodes pendingCodes;
+    vehicle_info info;
+    // Sessions that were accepted
+    std::vector<uint8_t> sessions;
+    // Probes that failed, with the reason
+    std::vector<std::string> errors;
+};
+
+/* Scans every ECU on the bus. A functional request finds the responding
+ * ECUs within one window, then each ECU is probed for codes, vehicle
+ * information and sessions. ECUs are probed concurrently through `bus`.
+ * Each ECU is returned to the default session after probing sessions. */
+async::Task<std::vector<EcuScanResult>> scanVehicle(async::EventLoop & loop, network::CanDemux & bus,
+                                                    VehicleScanOptions options = VehicleScanOptions(),
+                                                    async::CancellationToken token = {});
+
+// Blocking version of scanVehicle() with its own event loop
+std::vector<EcuScanResult> scanVehicleBlocking(network::CanDemux & bus,
+                                               const VehicleScanOptions & options = VehicleScanOptions(),
+                                               async::CancellationToken token = {});
+
+} // namespace lt
+
+#endif // LT_VEHICLESCAN_H
@@ -48,8 +48,7 @@ FlashMap FlashMap::fromTune(Tune & tune)
 
     std::size_t offset = platform->flashOffset;
 
-    std::vector<uint8_t> new_rom(rom->data(),
-                              rom->data() + rom->size());
+    std::vector<uint8_t> new_rom(tune.cbegin(), tune.cend());
 
     // Try each table
     /*for (const auto & [id, definition] : model->tables)
@@ -67,8 +66,9 @@ FlashMap FlashMap::fromTune(Tune & tune)
                   data.begin() + definition.offset.value() - offset);
     }*/
 
-    // Correct and verify checksums
-    model->checksums.correct(new_rom.data(), new_rom.size());
+    // Correct and verify checksums. The running sums of the tune avoid
+    // rescanning the data for additive checksums.
+    tune.checksums().correct(new_rom.data(), static_cast<int>(new_rom.size()));
 
     std::vector<uint8_t> flash_region(new_rom.data() + offset,
                               new_rom.data() + new_rom.size() - offset);
@@ -4,6 +4,7 @@
 #include "../download/rmadownloader.h"
 #include "../flash/mazdat1.h"
 #include "../network/can/canlog.h"
+#include "../network/can/cantrace.h"
 #include "../network/isotp/isotpcan.h"
 #include "../network/uds/isotpuds.h"
 
@@ -18,6 +19,11 @@ network::CanPtr PlatformLink::can()
         throw std::runtime_error(
             "CAN is unsupported with the selected datalink");
     }
+    if (canTrace_)
+    {
+        can = std::make_unique<network::CanTraceProxy>(std::move(can),
+                                                       canTrace_);
+    }
     if (canLog_)
     {
         return std::make_unique<network::CanLogProxy>(std::move(can), canLog_);
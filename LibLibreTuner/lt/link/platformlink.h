@@ -15,6 +15,8 @@ namespace network
 {
 class CanLog;
 using CanLogPtr = std::shared_ptr<CanLog>;
+class CanTraceWriter;
+using CanTraceWriterPtr = std::shared_ptr<CanTraceWriter>;
 } // namespace network
 
 class PlatformLink
@@ -46,10 +48,17 @@ public:
         canLog_ = std::move(log);
     }
 
+    // Records all frames of interfaces created afterwards to `trace`
+    inline void setCanTrace(network::CanTraceWriterPtr trace) noexcept
+    {
+        canTrace_ = std::move(trace);
+    }
+
 private:
     DataLink & datalink_;
     const Platform & platform_;
     network::CanLogPtr canLog_;
+    network::CanTraceWriterPtr canTrace_;
 };
 
 } // namespace lt
@@ -0,0 +1,60 @@
+#include "asynccan.h"
+
+#include <cassert>
+#include <chrono>
+
+namespace lt::network
+{
+
+// How often the pump thread checks if it should exit
+constexpr std::chrono::milliseconds pumpInterval{50};
+
+AsyncCan::AsyncCan(async::EventLoop & loop, CanPtr && can)
+    : loop_(loop), can_(std::move(can)), frames_(std::make_shared<async::AsyncQueue<CanMessage>>(loop))
+{
+    assert(can_);
+    pump_ = std::thread(&AsyncCan::pump, this);
+}
+
+AsyncCan::~AsyncCan()
+{
+    running_ = false;
+    pump_.join();
+}
+
+void AsyncCan::clear() noexcept
+{
+    frames_->clear();
+    can_->clearBuffer();
+}
+
+void AsyncCan::pump()
+{
+    // Frames posted after destruction are dropped with the queue
+    std::weak_ptr<async::AsyncQueue<CanMessage>> frames = frames_;
+
+    CanMessage message;
+    while (running_)
+    {
+        try
+        {
+            if (!can_->recv(message, pumpInterval))
+                continue;
+        }
+        catch (...)
+        {
+            loop_.post([frames, exception = std::current_exception()]() {
+                if (auto queue = frames.lock())
+                    queue->fail(exception);
+            });
+            return;
+        }
+
+        loop_.post([frames, message]() {
+            if (auto queue = frames.lock())
+                queue->push(message);
+        });
+    }
+}
+
+} // namespace lt::network
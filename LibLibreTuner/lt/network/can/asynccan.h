@@ -0,0 +1,57 @@
+#ifndef LT_ASYNCCAN_H
+#define LT_ASYNCCAN_H
+
+#include "async/queue.h"
+#include "can.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace lt::network
+{
+
+/* Adapts a blocking CAN interface to an event loop. A pump thread reads
+ * frames from the interface and hands them to the loop, so coroutines can
+ * wait for frames without blocking the loop thread. */
+class AsyncCan
+{
+public:
+    // Takes ownership of a CAN interface
+    AsyncCan(async::EventLoop & loop, CanPtr && can);
+    ~AsyncCan();
+
+    AsyncCan(const AsyncCan &) = delete;
+    AsyncCan & operator=(const AsyncCan &) = delete;
+
+    inline async::EventLoop & loop() noexcept { return loop_; }
+    inline Can & can() noexcept { return *can_; }
+
+    // Sends a frame. CAN sends do not block long enough to need awaiting.
+    inline void send(const CanMessage & message) { can_->send(message); }
+
+    /* Awaitable returning the next received frame, or std::nullopt if none
+     * arrives before `deadline`. Rethrows receive errors from the
+     * interface. */
+    inline auto recv(async::Clock::time_point deadline, async::CancellationToken token = {})
+    {
+        return frames_->pop(deadline, std::move(token));
+    }
+
+    // Discards received frames that have not been read
+    void clear() noexcept;
+
+private:
+    async::EventLoop & loop_;
+    CanPtr can_;
+    std::shared_ptr<async::AsyncQueue<CanMessage>> frames_;
+
+    std::atomic<bool> running_{true};
+    std::thread pump_;
+
+    void pump();
+};
+
+} // namespace lt::network
+
+#endif // LT_ASYNCCAN_H
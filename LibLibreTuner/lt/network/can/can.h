@@ -109,6 +109,8 @@ public:
 
     void clear() { buffer_ = std::queue<CanMessage>(); }
 
+    bool empty() const noexcept { return buffer_.empty(); }
+
 private:
     std::queue<CanMessage> buffer_;
     std::size_t limit_{20};
@@ -0,0 +1,157 @@
+#include "candemux.h"
+
+#include "network/isotp/isotpcan.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+namespace lt::network
+{
+
+// How often the receiver thread checks if it should exit
+constexpr std::chrono::milliseconds receiveInterval{50};
+
+// Channel of a CanDemux. Receives only the frames routed to it.
+class DemuxCan : public Can
+{
+public:
+    DemuxCan(std::shared_ptr<detail::DemuxState> state, std::shared_ptr<detail::DemuxChannel> channel,
+             std::vector<uint32_t> ids)
+        : state_(std::move(state)), channel_(std::move(channel)), ids_(std::move(ids))
+    {
+    }
+
+    ~DemuxCan() override
+    {
+        std::lock_guard lock(state_->routesMutex);
+        for (uint32_t id : ids_)
+            state_->routes.erase(id);
+    }
+
+    void send(const CanMessage & message) override
+    {
+        std::lock_guard lock(state_->sendMutex);
+        state_->can->send(message);
+    }
+
+    bool recv(CanMessage & message, std::chrono::milliseconds timeout) override
+    {
+        std::unique_lock lock(channel_->mutex);
+        channel_->received.wait_for(lock, timeout, [&]() { return !channel_->buffer.empty() || failed(); });
+        if (channel_->buffer.pop(message))
+            return true;
+
+        std::lock_guard routesLock(state_->routesMutex);
+        if (state_->error)
+            std::rethrow_exception(state_->error);
+        return false;
+    }
+
+    void clearBuffer() noexcept override
+    {
+        std::lock_guard lock(channel_->mutex);
+        channel_->buffer.clear();
+    }
+
+private:
+    std::shared_ptr<detail::DemuxState> state_;
+    std::shared_ptr<detail::DemuxChannel> channel_;
+    std::vector<uint32_t> ids_;
+
+    bool failed()
+    {
+        std::lock_guard lock(state_->routesMutex);
+        return static_cast<bool>(state_->error);
+    }
+};
+
+CanDemux::CanDemux(CanPtr && can) : state_(std::make_shared<detail::DemuxState>())
+{
+    assert(can);
+    state_->can = std::move(can);
+    receiver_ = std::thread(&CanDemux::receive, this);
+}
+
+CanDemux::~CanDemux()
+{
+    state_->running = false;
+    receiver_.join();
+}
+
+CanPtr CanDemux::open(const std::vector<uint32_t> & ids)
+{
+    auto channel = std::make_shared<detail::DemuxChannel>();
+
+    std::lock_guard lock(state_->routesMutex);
+    for (uint32_t id : ids)
+    {
+        auto it = state_->routes.find(id);
+        if (it != state_->routes.end() && !it->second.expired())
+            throw std::runtime_error("CAN ID " + std::to_string(id) + " is already in use by another session");
+    }
+    for (uint32_t id : ids)
+        state_->routes[id] = channel;
+
+    return std::make_unique<DemuxCan>(state_, std::move(channel), ids);
+}
+
+IsoTpPtr CanDemux::isotp(const IsoTpOptions & options)
+{
+    return std::make_unique<IsoTpCan>(open(options.destId), options);
+}
+
+void CanDemux::receive()
+{
+    CanMessage message;
+    while (state_->running)
+    {
+        try
+        {
+            if (!state_->can->recv(message, receiveInterval))
+                continue;
+        }
+        catch (...)
+        {
+            // Wake every channel so they see the error
+            std::vector<std::shared_ptr<detail::DemuxChannel>> channels;
+            {
+                std::lock_guard lock(state_->routesMutex);
+                state_->error = std::current_exception();
+                for (auto & [id, route] : state_->routes)
+                {
+                    if (auto channel = route.lock())
+                        channels.emplace_back(std::move(channel));
+                }
+            }
+            for (auto & channel : channels)
+            {
+                // Lock so the notification cannot fall between a waiter's
+                // check and its wait
+                std::lock_guard lock(channel->mutex);
+                channel->received.notify_all();
+            }
+            return;
+        }
+
+        std::shared_ptr<detail::DemuxChannel> channel;
+        {
+            std::lock_guard lock(state_->routesMutex);
+            if (auto it = state_->routes.find(message.id()); it != state_->routes.end())
+                channel = it->second.lock();
+        }
+        if (!channel)
+        {
+            ++state_->unrouted;
+            continue;
+        }
+
+        {
+            std::lock_guard lock(channel->mutex);
+            channel->buffer.add(message);
+        }
+        channel->received.notify_one();
+    }
+}
+
+} // namespace lt::network
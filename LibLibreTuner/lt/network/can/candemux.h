@@ -0,0 +1,81 @@
+#ifndef LT_CANDEMUX_H
+#define LT_CANDEMUX_H
+
+#include "can.h"
+#include "network/isotp/isotp.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace lt::network
+{
+
+namespace detail
+{
+struct DemuxChannel
+{
+    std::mutex mutex;
+    std::condition_variable received;
+    CanMessageBuffer buffer;
+};
+
+struct DemuxState
+{
+    CanPtr can;
+    // Serializes sends from channels on different threads
+    std::mutex sendMutex;
+
+    std::mutex routesMutex;
+    std::unordered_map<uint32_t, std::weak_ptr<DemuxChannel>> routes;
+    // Set if the receiver thread failed
+    std::exception_ptr error;
+
+    std::atomic<bool> running{true};
+    std::atomic<std::size_t> unrouted{0};
+};
+} // namespace detail
+
+/* Shares one CAN interface between several sessions. A receiver thread
+ * reads every frame from the interface and routes it by arbitration ID to
+ * the channel that opened that ID, so e.g. an IsoTpCan talking to the ECU
+ * and one talking to the TCM can run concurrently with independent flow
+ * control. Frames with no channel are dropped. */
+class CanDemux
+{
+public:
+    // Takes ownership of a CAN interface
+    explicit CanDemux(CanPtr && can);
+    ~CanDemux();
+
+    CanDemux(const CanDemux &) = delete;
+    CanDemux & operator=(const CanDemux &) = delete;
+
+    /* Opens a channel receiving frames with the given IDs. Every channel
+     * can send with any ID. Throws if an ID is routed to another open
+     * channel. The channel may outlive the demultiplexer, but stops
+     * receiving once it is destroyed. */
+    CanPtr open(const std::vector<uint32_t> & ids);
+    inline CanPtr open(uint32_t id) { return open(std::vector<uint32_t>{id}); }
+
+    // Opens an ISO-TP session receiving from `options.destId`
+    IsoTpPtr isotp(const IsoTpOptions & options);
+
+    // Number of frames received that no channel was open for
+    inline std::size_t unrouted() const noexcept { return state_->unrouted; }
+
+private:
+    std::shared_ptr<detail::DemuxState> state_;
+    std::thread receiver_;
+
+    void receive();
+};
+
+} // namespace lt::network
+
+#endif // LT_CANDEMUX_H
@@ -0,0 +1,267 @@
+#include "candump.h"
+
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <ctime>
+#include <string_view>
+#include <vector>
+
+namespace lt::network
+{
+
+namespace
+{
+constexpr char hexDigits[] = "0123456789ABCDEF";
+
+void appendHex(std::string & out, uint64_t value, int digits)
+{
+    for (int i = digits - 1; i >= 0; --i)
+        out += hexDigits[(value >> (i * 4)) & 0xF];
+}
+
+// Parses a whole token as an unsigned integer
+template <typename T> bool parseInt(std::string_view text, T & value, int base = 16)
+{
+    if (text.empty())
+        return false;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+    return ec == std::errc() && end == text.data() + text.size();
+}
+
+// Parses "seconds.fraction" into nanoseconds
+bool parseTimestamp(std::string_view text, uint64_t & ns)
+{
+    std::size_t dot = text.find('.');
+    uint64_t seconds;
+    if (!parseInt(text.substr(0, dot), seconds, 10))
+        return false;
+    ns = seconds * 1000000000ULL;
+    if (dot == std::string_view::npos)
+        return true;
+
+    std::string_view fraction = text.substr(dot + 1, 9);
+    uint64_t value;
+    if (!parseInt(fraction, value, 10))
+        return false;
+    for (std::size_t i = fraction.size(); i < 9; ++i)
+        value *= 10;
+    ns += value;
+    return true;
+}
+
+std::vector<std::string_view> split(std::string_view line)
+{
+    std::vector<std::string_view> tokens;
+    std::size_t pos = 0;
+    while (pos < line.size())
+    {
+        while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos])))
+            ++pos;
+        std::size_t end = pos;
+        while (end < line.size() && !std::isspace(static_cast<unsigned char>(line[end])))
+            ++end;
+        if (end > pos)
+            tokens.emplace_back(line.substr(pos, end - pos));
+        pos = end;
+    }
+    return tokens;
+}
+
+void appendTimestamp(std::string & out, uint64_t ns)
+{
+    // Seconds with microsecond resolution, like candump
+    char buffer[32];
+    int n = std::snprintf(buffer, sizeof(buffer), "%llu.%06llu", static_cast<unsigned long long>(ns / 1000000000ULL),
+                          static_cast<unsigned long long>((ns % 1000000000ULL) / 1000));
+    out.append(buffer, static_cast<std::size_t>(n));
+}
+} // namespace
+
+void exportCandump(const CanTraceReader & trace, std::ostream & out, const std::string & interface)
+{
+    std::string line;
+    for (std::size_t i = 0; i < trace.size(); ++i)
+    {
+        CanTraceRecord record = trace[i];
+        const CanMessage & message = record.message;
+
+        line.clear();
+        line += '(';
+        appendTimestamp(line, record.timestamp);
+        line += ") ";
+        line += interface;
+        line += ' ';
+        appendHex(line, message.id(), message.id() > 0x7FF ? 8 : 3);
+        line += '#';
+        for (uint8_t b = 0; b < message.length(); ++b)
+            appendHex(line, message[b], 2);
+        line += '\n';
+        out << line;
+    }
+}
+
+CanImportResult importCandump(std::istream & in, CanTraceFile & out)
+{
+    CanImportResult result;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::vector<std::string_view> tokens = split(line);
+        if (tokens.empty())
+            continue;
+
+        // (timestamp) interface frame
+        CanTraceRecord record;
+        if (tokens.size() < 3 || tokens[0].size() < 3 || tokens[0].front() != '(' || tokens[0].back() != ')' ||
+            !parseTimestamp(tokens[0].substr(1, tokens[0].size() - 2), record.timestamp))
+        {
+            ++result.skipped;
+            continue;
+        }
+
+        std::string_view frame = tokens[2];
+        std::size_t hash = frame.find('#');
+        std::string_view data = hash == std::string_view::npos ? std::string_view() : frame.substr(hash + 1);
+        uint32_t id;
+        // '#R' is a remote frame, '##' a CAN FD frame
+        if (hash == std::string_view::npos || !parseInt(frame.substr(0, hash), id) || id > max_can_id ||
+            (!data.empty() && (data[0] == 'R' || data[0] == '#')) || data.size() % 2 != 0 || data.size() > 16)
+        {
+            ++result.skipped;
+            continue;
+        }
+
+        std::array<uint8_t, 8> bytes{};
+        bool valid = true;
+        for (std::size_t i = 0; i < data.size() / 2; ++i)
+            valid &= parseInt(data.substr(i * 2, 2), bytes[i]);
+        if (!valid)
+        {
+            ++result.skipped;
+            continue;
+        }
+
+        record.message.setMessage(id, bytes.data(), static_cast<uint8_t>(data.size() / 2));
+        out.write(record);
+        ++result.imported;
+    }
+    return result;
+}
+
+void exportAsc(const CanTraceReader & trace, std::ostream & out)
+{
+    const uint64_t base = trace.empty() ? 0 : trace[0].timestamp;
+
+    // Header with the measurement start
+    std::time_t seconds = static_cast<std::time_t>(base / 1000000000ULL);
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &seconds);
+#else
+    localtime_r(&seconds, &tm);
+#endif
+    char date[64];
+    std::strftime(date, sizeof(date), "%a %b %d %I:%M:%S.000 %p %Y", &tm);
+
+    out << "date " << date << "\n";
+    out << "base hex  timestamps absolute\n";
+    out << "internal events logged\n";
+    out << "Begin Triggerblock " << date << "\n";
+
+    std::string line;
+    for (std::size_t i = 0; i < trace.size(); ++i)
+    {
+        CanTraceRecord record = trace[i];
+        const CanMessage & message = record.message;
+
+        char prefix[64];
+        uint64_t offset = record.timestamp > base ? record.timestamp - base : 0;
+        std::snprintf(prefix, sizeof(prefix), "%11.6f 1  ", static_cast<double>(offset) / 1e9);
+
+        line = prefix;
+        std::string id;
+        appendHex(id, message.id(), message.id() > 0x7FF ? 8 : 3);
+        // Trim leading zeros of standard IDs like CANalyzer
+        if (message.id() <= 0x7FF)
+            id.erase(0, std::min(id.find_first_not_of('0'), id.size() - 1));
+        else
+            id += 'x';
+        id.resize(std::max<std::size_t>(id.size(), 15), ' ');
+        line += id;
+        line += record.direction == CanMessageDirection::Outbound ? " Tx   d " : " Rx   d ";
+        line += static_cast<char>('0' + message.length());
+        for (uint8_t b = 0; b < message.length(); ++b)
+        {
+            line += ' ';
+            appendHex(line, message[b], 2);
+        }
+        line += '\n';
+        out << line;
+    }
+    out << "End TriggerBlock\n";
+}
+
+CanImportResult importAsc(std::istream & in, CanTraceFile & out, uint64_t base)
+{
+    CanImportResult result;
+    int numberBase = 16;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::vector<std::string_view> tokens = split(line);
+        if (tokens.empty())
+            continue;
+
+        if (tokens[0] == "base" && tokens.size() >= 2)
+        {
+            numberBase = tokens[1] == "dec" ? 10 : 16;
+            continue;
+        }
+
+        // timestamp channel id direction d dlc data...
+        uint64_t timestamp;
+        if (!parseTimestamp(tokens[0], timestamp))
+        {
+            // Header and footer lines
+            continue;
+        }
+
+        uint8_t channel;
+        std::string_view idText = tokens.size() > 2 ? tokens[2] : std::string_view();
+        if (!idText.empty() && (idText.back() == 'x' || idText.back() == 'X'))
+            idText.remove_suffix(1);
+
+        uint32_t id;
+        uint8_t length;
+        if (tokens.size() < 6 || !parseInt(tokens[1], channel, 10) || !parseInt(idText, id, numberBase) ||
+            id > max_can_id || (tokens[3] != "Rx" && tokens[3] != "Tx") || tokens[4] != "d" ||
+            !parseInt(tokens[5], length, 16) || length > 8 || tokens.size() < 6u + length)
+        {
+            // Error frames, remote frames and events
+            ++result.skipped;
+            continue;
+        }
+
+        std::array<uint8_t, 8> bytes{};
+        bool valid = true;
+        for (uint8_t i = 0; i < length; ++i)
+            valid &= parseInt(tokens[6 + i], bytes[i], numberBase);
+        if (!valid)
+        {
+            ++result.skipped;
+            continue;
+        }
+
+        CanTraceRecord record;
+        record.timestamp = base + timestamp;
+        record.direction = tokens[3] == "Tx" ? CanMessageDirection::Outbound : CanMessageDirection::Inbound;
+        record.message.setMessage(id, bytes.data(), length);
+        out.write(record);
+        ++result.imported;
+    }
+    return result;
+}
+
+} // namespace lt::network
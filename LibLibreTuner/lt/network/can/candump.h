@@ -0,0 +1,46 @@
+#ifndef LT_CANDUMP_H
+#define LT_CANDUMP_H
+
+#include "cantrace.h"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace lt::network
+{
+
+/* Text trace formats for exchanging captures with other tools:
+ *
+ * candump log (candump -l, canplayer):
+ *   (1436509052.249713) can0 7E8#0211223344
+ *
+ * Vector ASC (CANalyzer, CANoe):
+ *      0.002000 1  7E8             Rx   d 8 02 11 22 33 44 55 66 77
+ *
+ * Extended IDs are written with 8 digits in candump logs and with a
+ * trailing 'x' in ASC. Remote, error and CAN FD frames are skipped on
+ * import. */
+
+struct CanImportResult
+{
+    std::size_t imported{0};
+    // Lines that were not frames or used unsupported frame types
+    std::size_t skipped{0};
+};
+
+void exportCandump(const CanTraceReader & trace, std::ostream & out, const std::string & interface = "can0");
+
+// candump logs have no direction; frames are imported as inbound
+CanImportResult importCandump(std::istream & in, CanTraceFile & out);
+
+void exportAsc(const CanTraceReader & trace, std::ostream & out);
+
+/* ASC timestamps are relative to the start of the measurement. They are
+ * imported relative to `base` (ns since the Unix epoch). */
+CanImportResult importAsc(std::istream & in, CanTraceFile & out, uint64_t base = 0);
+
+} // namespace lt::network
+
+#endif // LT_CANDUMP_H
@@ -0,0 +1,305 @@
+#include "cantrace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace lt::network
+{
+
+namespace
+{
+constexpr char magic[4] = {'L', 'T', 'C', 'T'};
+// Frames drained per write
+constexpr std::size_t batchSize = 4096;
+// How long the writer sleeps when the queue is empty. Producers never
+// signal the writer so recording stays free of system calls.
+constexpr std::chrono::milliseconds idleInterval{5};
+
+void putLe(uint8_t * out, uint64_t value, int size)
+{
+    for (int i = 0; i < size; ++i)
+        out[i] = static_cast<uint8_t>(value >> (i * 8));
+}
+
+uint64_t getLe(const uint8_t * in, int size)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < size; ++i)
+        value |= static_cast<uint64_t>(in[i]) << (i * 8);
+    return value;
+}
+
+void encode(const CanTraceRecord & record, uint8_t * out)
+{
+    putLe(out, record.timestamp, 8);
+    putLe(out + 8, record.message.id(), 4);
+    out[12] = record.message.length();
+    out[13] = (record.direction == CanMessageDirection::Outbound ? cantrace::flagOutbound : 0) |
+              (record.message.id() > 0x7FF ? cantrace::flagExtended : 0);
+    out[14] = 0;
+    out[15] = 0;
+    std::memcpy(out + 16, record.message.message(), 8);
+}
+
+fs::path rotatedPath(const fs::path & path, std::size_t index)
+{
+    std::string number = std::to_string(index);
+    number.insert(0, number.size() < 4 ? 4 - number.size() : 0, '0');
+
+    fs::path result = path.parent_path() / path.stem();
+    result += "-" + number;
+    result += path.extension();
+    return result;
+}
+} // namespace
+
+uint64_t canTraceNow() noexcept
+{
+    // The system clock may jump; anchor the steady clock to it once
+    static const auto systemBase = std::chrono::system_clock::now();
+    static const auto steadyBase = std::chrono::steady_clock::now();
+
+    auto elapsed = std::chrono::steady_clock::now() - steadyBase;
+    auto now = systemBase.time_since_epoch() + elapsed;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+CanTraceFile::CanTraceFile(const fs::path & path)
+    : path_(path), file_(path, std::ios::binary | std::ios::out | std::ios::trunc)
+{
+    if (!file_.is_open())
+        throw std::runtime_error("failed to open trace file '" + path.string() + "' for writing");
+
+    uint8_t header[cantrace::headerSize]{};
+    std::memcpy(header, magic, sizeof(magic));
+    putLe(header + 4, cantrace::version, 2);
+    putLe(header + 6, cantrace::recordSize, 2);
+    file_.write(reinterpret_cast<const char *>(header), sizeof(header));
+    size_ = sizeof(header);
+}
+
+void CanTraceFile::write(const CanTraceRecord & record) { write(&record, 1); }
+
+void CanTraceFile::write(const CanTraceRecord * records, std::size_t count)
+{
+    buffer_.resize(count * cantrace::recordSize);
+    for (std::size_t i = 0; i < count; ++i)
+        encode(records[i], buffer_.data() + i * cantrace::recordSize);
+
+    file_.write(reinterpret_cast<const char *>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+    if (!file_)
+        throw std::runtime_error("failed to write trace file '" + path_.string() + "'");
+    size_ += buffer_.size();
+}
+
+void CanTraceFile::flush() { file_.flush(); }
+
+CanTraceWriter::CanTraceWriter(CanTraceOptions options) : options_(std::move(options)), queue_(options_.queueCapacity)
+{
+    // Open the first file here so errors reach the caller
+    rotate();
+    thread_ = std::thread(&CanTraceWriter::run, this);
+}
+
+CanTraceWriter::~CanTraceWriter()
+{
+    running_ = false;
+    thread_.join();
+}
+
+void CanTraceWriter::record(const CanTraceRecord & record) noexcept
+{
+    if (!queue_.push(record))
+        ++dropped_;
+}
+
+std::vector<fs::path> CanTraceWriter::files() const
+{
+    std::lock_guard lock(filesMutex_);
+    return files_;
+}
+
+void CanTraceWriter::rotate()
+{
+    fs::path path = options_.maxFileSize == 0 ? options_.path : rotatedPath(options_.path, ++fileIndex_);
+    file_ = std::make_unique<CanTraceFile>(path);
+
+    std::lock_guard lock(filesMutex_);
+    files_.emplace_back(std::move(path));
+    if (options_.maxFiles != 0 && files_.size() > options_.maxFiles)
+    {
+        std::error_code ec;
+        fs::remove(files_.front(), ec);
+        files_.erase(files_.begin());
+    }
+}
+
+void CanTraceWriter::write(const CanTraceRecord * records, std::size_t count)
+{
+    while (count != 0)
+    {
+        std::size_t n = count;
+        if (options_.maxFileSize != 0)
+        {
+            // Records that fit the current file; a new file takes at least one
+            std::size_t room = options_.maxFileSize > file_->size()
+                                   ? (options_.maxFileSize - file_->size()) / cantrace::recordSize
+                                   : 0;
+            if (room == 0)
+            {
+                file_->flush();
+                rotate();
+                room = std::max<std::size_t>((options_.maxFileSize - file_->size()) / cantrace::recordSize, 1);
+            }
+            n = std::min(n, room);
+        }
+
+        file_->write(records, n);
+        written_ += n;
+        records += n;
+        count -= n;
+    }
+}
+
+void CanTraceWriter::run()
+{
+    std::vector<CanTraceRecord> batch(batchSize);
+    while (true)
+    {
+        // Read the flag first so frames recorded before stopping are drained
+        bool stopping = !running_;
+
+        std::size_t count = 0;
+        while (count < batch.size() && queue_.pop(batch[count]))
+            ++count;
+
+        if (count != 0)
+        {
+            try
+            {
+                write(batch.data(), count);
+            }
+            catch (const std::exception &)
+            {
+                // The disk is full or gone; keep draining so producers
+                // never stall, and count the frames as dropped
+                dropped_ += count;
+            }
+            if (count == batch.size())
+                continue;
+        }
+
+        if (stopping)
+            break;
+        file_->flush();
+        std::this_thread::sleep_for(idleInterval);
+    }
+    file_->flush();
+}
+
+CanTraceReader::CanTraceReader(const fs::path & path) : file_(path)
+{
+    if (file_.size() < cantrace::headerSize || std::memcmp(file_.data(), magic, sizeof(magic)) != 0)
+        throw std::runtime_error("'" + path.string() + "' is not a CAN trace");
+    if (getLe(file_.data() + 4, 2) != cantrace::version || getLe(file_.data() + 6, 2) != cantrace::recordSize)
+        throw std::runtime_error("'" + path.string() + "' is an unsupported CAN trace version");
+
+    // A partial last record is left by an interrupted capture
+    size_ = (file_.size() - cantrace::headerSize) / cantrace::recordSize;
+}
+
+CanTraceRecord CanTraceReader::operator[](std::size_t index) const noexcept
+{
+    CanTraceRecord record;
+    record.timestamp = timestamp(index);
+    record.direction = direction(index);
+    record.message.setId(id(index));
+    record.message.setMessage(data(index), length(index));
+    return record;
+}
+
+uint64_t CanTraceReader::timestamp(std::size_t index) const noexcept
+{
+    return getLe(recordData(index), 8);
+}
+
+uint32_t CanTraceReader::id(std::size_t index) const noexcept
+{
+    return static_cast<uint32_t>(getLe(recordData(index) + 8, 4)) & max_can_id;
+}
+
+CanMessageDirection CanTraceReader::direction(std::size_t index) const noexcept
+{
+    return (recordData(index)[13] & cantrace::flagOutbound) != 0 ? CanMessageDirection::Outbound
+                                                                 : CanMessageDirection::Inbound;
+}
+
+uint8_t CanTraceReader::length(std::size_t index) const noexcept
+{
+    return std::min<uint8_t>(recordData(index)[12], 8);
+}
+
+std::size_t CanTraceReader::lowerBound(uint64_t timestamp) const noexcept
+{
+    std::size_t first = 0;
+    std::size_t count = size_;
+    while (count > 0)
+    {
+        std::size_t step = count / 2;
+        if (getLe(recordData(first + step), 8) < timestamp)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+            count = step;
+    }
+    return first;
+}
+
+CanTracePlayer::CanTracePlayer(const fs::path & path, double speed) : reader_(path), speed_(speed)
+{
+    seek(0);
+}
+
+void CanTracePlayer::seek(uint64_t timestamp) noexcept
+{
+    next_ = reader_.lowerBound(timestamp);
+    traceStart_ = next_ < reader_.size() ? reader_[next_].timestamp : 0;
+    wallStart_ = std::chrono::steady_clock::now();
+}
+
+bool CanTracePlayer::recv(CanMessage & message, std::chrono::milliseconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (; next_ < reader_.size(); ++next_)
+    {
+        CanTraceRecord record = reader_[next_];
+        if (record.direction != CanMessageDirection::Inbound)
+            continue;
+
+        if (speed_ > 0)
+        {
+            uint64_t elapsed = record.timestamp > traceStart_ ? record.timestamp - traceStart_ : 0;
+            auto offset = std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(elapsed) / speed_));
+            auto due = wallStart_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+            if (due > deadline)
+            {
+                std::this_thread::sleep_until(deadline);
+                return false;
+            }
+            std::this_thread::sleep_until(due);
+        }
+
+        message = record.message;
+        ++next_;
+        return true;
+    }
+    return false;
+}
+
+} // namespace lt::network
@@ -0,0 +1,226 @@
+#ifndef LT_CANTRACE_H
+#define LT_CANTRACE_H
+
+#include "can.h"
+#include "canlog.h"
+#include "os/mappedfile.h"
+#include "support/boundedqueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lt::network
+{
+
+/* Binary CAN trace (.ltct). A 16 byte header followed by fixed-size
+ * little endian records, so a mapped trace can be indexed directly:
+ *
+ *   header: "LTCT", u16 version, u16 record size, u64 reserved
+ *   record: u64 timestamp (ns since the Unix epoch), u32 id, u8 length,
+ *           u8 flags, u16 reserved, u8 data[8]
+ */
+namespace cantrace
+{
+constexpr std::size_t headerSize = 16;
+constexpr std::size_t recordSize = 24;
+constexpr uint16_t version = 1;
+
+// Record flags
+constexpr uint8_t flagOutbound = 0x1;
+constexpr uint8_t flagExtended = 0x2;
+} // namespace cantrace
+
+struct CanTraceRecord
+{
+    // Nanoseconds since the Unix epoch
+    uint64_t timestamp{0};
+    CanMessageDirection direction{CanMessageDirection::Inbound};
+    CanMessage message;
+};
+
+// Returns the current time in trace timestamps. Monotonic within a process.
+uint64_t canTraceNow() noexcept;
+
+// Appends records to a trace file
+class CanTraceFile
+{
+public:
+    // Creates or truncates `path`. Throws if it cannot be opened.
+    explicit CanTraceFile(const std::filesystem::path & path);
+
+    void write(const CanTraceRecord & record);
+    void write(const CanTraceRecord * records, std::size_t count);
+    void flush();
+
+    // Bytes written, including the header
+    inline std::size_t size() const noexcept { return size_; }
+    inline const std::filesystem::path & path() const noexcept { return path_; }
+
+private:
+    std::filesystem::path path_;
+    std::ofstream file_;
+    std::size_t size_{0};
+    std::vector<uint8_t> buffer_;
+};
+
+struct CanTraceOptions
+{
+    std::filesystem::path path;
+    /* Starts a new file after this many bytes. Rotated files are numbered:
+     * capture.ltct becomes capture-0001.ltct, capture-0002.ltct, ... 0
+     * writes a single file. */
+    std::size_t maxFileSize{0};
+    // Deletes the oldest rotated files beyond this count. 0 keeps all.
+    std::size_t maxFiles{0};
+    // Frames buffered between the bus and the disk. 65536 frames hold
+    // three seconds of a saturated 1 Mbit/s bus.
+    std::size_t queueCapacity{1 << 16};
+};
+
+/* Writes frames to trace files on a background thread. record() never
+ * blocks or locks, so it can be called from receive threads at bus rate;
+ * frames are dropped (and counted) only if the writer falls a whole queue
+ * behind. */
+class CanTraceWriter
+{
+public:
+    explicit CanTraceWriter(CanTraceOptions options);
+    // Writes the remaining frames
+    ~CanTraceWriter();
+
+    CanTraceWriter(const CanTraceWriter &) = delete;
+    CanTraceWriter & operator=(const CanTraceWriter &) = delete;
+
+    // Thread-safe and lock-free
+    void record(const CanTraceRecord & record) noexcept;
+
+    inline void record(CanMessageDirection direction, const CanMessage & message) noexcept
+    {
+        record(CanTraceRecord{canTraceNow(), direction, message});
+    }
+
+    inline std::size_t written() const noexcept { return written_; }
+    inline std::size_t dropped() const noexcept { return dropped_; }
+
+    // Files written so far, oldest first. Includes the current file.
+    std::vector<std::filesystem::path> files() const;
+
+private:
+    CanTraceOptions options_;
+    BoundedQueue<CanTraceRecord> queue_;
+
+    std::atomic<bool> running_{true};
+    std::atomic<std::size_t> written_{0};
+    std::atomic<std::size_t> dropped_{0};
+
+    mutable std::mutex filesMutex_;
+    std::vector<std::filesystem::path> files_;
+    std::unique_ptr<CanTraceFile> file_;
+    std::size_t fileIndex_{0};
+
+    std::thread thread_;
+
+    void run();
+    void rotate();
+    void write(const CanTraceRecord * records, std::size_t count);
+};
+using CanTraceWriterPtr = std::shared_ptr<CanTraceWriter>;
+
+// Read-only view of a mapped trace file
+class CanTraceReader
+{
+public:
+    // Throws if the file is not a trace
+    explicit CanTraceReader(const std::filesystem::path & path);
+
+    inline std::size_t size() const noexcept { return size_; }
+    inline bool empty() const noexcept { return size_ == 0; }
+
+    CanTraceRecord operator[](std::size_t index) const noexcept;
+
+    // Single fields of a record, without decoding the whole record
+    uint64_t timestamp(std::size_t index) const noexcept;
+    uint32_t id(std::size_t index) const noexcept;
+    CanMessageDirection direction(std::size_t index) const noexcept;
+    uint8_t length(std::size_t index) const noexcept;
+    inline const uint8_t * data(std::size_t index) const noexcept { return recordData(index) + 16; }
+
+    // Index of the first record at or after `timestamp`. Records are in
+    // time order.
+    std::size_t lowerBound(uint64_t timestamp) const noexcept;
+
+private:
+    os::MappedFile file_;
+    std::size_t size_{0};
+
+    inline const uint8_t * recordData(std::size_t index) const noexcept
+    {
+        return file_.data() + cantrace::headerSize + index * cantrace::recordSize;
+    }
+};
+
+// Proxies a CAN interface and records all sent and received frames
+class CanTraceProxy : public Can
+{
+public:
+    CanTraceProxy(CanPtr && can, CanTraceWriterPtr writer) : can_(std::move(can)), writer_(std::move(writer)) {}
+
+    void send(const CanMessage & message) override
+    {
+        can_->send(message);
+        writer_->record(CanMessageDirection::Outbound, message);
+    }
+
+    bool recv(CanMessage & message, std::chrono::milliseconds timeout) override
+    {
+        bool res = can_->recv(message, timeout);
+        if (res)
+            writer_->record(CanMessageDirection::Inbound, message);
+        return res;
+    }
+
+    void clearBuffer() noexcept override { can_->clearBuffer(); }
+
+private:
+    CanPtr can_;
+    CanTraceWriterPtr writer_;
+};
+
+/* Replays the inbound frames of a trace as a CAN interface. Sent frames are
+ * discarded. With a speed of 0 frames are returned as fast as they are
+ * read; otherwise the original spacing is kept, scaled by 1 / speed. */
+class CanTracePlayer : public Can
+{
+public:
+    explicit CanTracePlayer(const std::filesystem::path & path, double speed = 1.0);
+
+    void send(const CanMessage & /*message*/) override {}
+
+    // Returns false at the end of the trace
+    bool recv(CanMessage & message, std::chrono::milliseconds timeout) override;
+
+    // Continues from the first record at or after `timestamp`
+    void seek(uint64_t timestamp) noexcept;
+
+    inline bool atEnd() const noexcept { return next_ >= reader_.size(); }
+
+private:
+    CanTraceReader reader_;
+    double speed_;
+    std::size_t next_{0};
+
+    // Trace time and wall time the playback started from
+    uint64_t traceStart_{0};
+    std::chrono::steady_clock::time_point wallStart_;
+};
+
+} // namespace lt::network
+
+#endif // LT_CANTRACE_H
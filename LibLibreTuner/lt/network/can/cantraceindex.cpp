@@ -0,0 +1,263 @@
+#include "cantraceindex.h"
+
+#include <algorithm>
+
+namespace lt::network
+{
+
+namespace
+{
+const std::vector<uint32_t> noPostings;
+
+// IDs that may carry ISO-TP diagnostics
+bool diagnosticId(uint32_t id)
+{
+    return (id >= 0x700 && id <= 0x7FF) || (id >> 16) == 0x18DA || (id >> 16) == 0x18DB;
+}
+
+// ID that responses to a physical request on `id` are sent from
+uint32_t responseId(uint32_t id)
+{
+    if (id <= 0x7FF)
+        return id + 8;
+    // 0x18DA[target][source] is answered by 0x18DA[source][target]
+    return (id & 0xFFFF0000) | ((id & 0xFF) << 8) | ((id >> 8) & 0xFF);
+}
+
+// Reassembles ISO-TP messages of one ID
+struct IsoTpAssembler
+{
+    bool active{false};
+    uint16_t remaining{0};
+    uint8_t sequence{0};
+    IsoTpTraceMessage message;
+};
+} // namespace
+
+CanTraceIndex::CanTraceIndex(const CanTraceReader & trace, uint64_t bucketWidth)
+    : trace_(trace), bucketWidth_(std::max<uint64_t>(bucketWidth, 1))
+{
+    build();
+    pairTransactions();
+}
+
+void CanTraceIndex::build()
+{
+    if (trace_.empty())
+        return;
+    start_ = trace_[0].timestamp;
+
+    std::unordered_map<uint32_t, IsoTpAssembler> assemblers;
+    for (std::size_t i = 0; i < trace_.size(); ++i)
+    {
+        const CanTraceRecord record = trace_[i];
+        const CanMessage & frame = record.message;
+        const auto index = static_cast<uint32_t>(i);
+
+        postings_[frame.id()].emplace_back(index);
+
+        uint64_t bucket = record.timestamp > start_ ? (record.timestamp - start_) / bucketWidth_ : 0;
+        if (buckets_.empty() || buckets_.back().number < bucket)
+            buckets_.push_back(Bucket{bucket, index});
+
+        if (frame.length() == 0 || !diagnosticId(frame.id()))
+            continue;
+
+        IsoTpAssembler & assembler = assemblers[frame.id()];
+        auto begin = [&](std::size_t offset, std::size_t size) {
+            assembler.message = IsoTpTraceMessage{frame.id(), record.direction, index, index, {}};
+            assembler.message.payload.assign(frame.message() + offset, frame.message() + offset + size);
+        };
+
+        switch (frame[0] >> 4)
+        {
+        case 0: {
+            // Single frame
+            uint8_t size = frame[0] & 0x0F;
+            assembler.active = false;
+            if (size == 0 || size >= frame.length())
+                break;
+            begin(1, size);
+            messages_.emplace_back(std::move(assembler.message));
+            break;
+        }
+        case 1: {
+            // First frame
+            uint16_t size = ((frame[0] & 0x0F) << 8) | frame[1];
+            assembler.active = size > 7 && frame.length() == 8;
+            if (!assembler.active)
+                break;
+            begin(2, 6);
+            assembler.remaining = size - 6;
+            assembler.sequence = 1;
+            break;
+        }
+        case 2: {
+            // Consecutive frame
+            if (!assembler.active)
+                break;
+            if ((frame[0] & 0x0F) != assembler.sequence)
+            {
+                // Lost a frame
+                assembler.active = false;
+                break;
+            }
+            assembler.sequence = (assembler.sequence + 1) & 0x0F;
+
+            auto size = std::min<uint16_t>(assembler.remaining, frame.length() - 1);
+            auto & payload = assembler.message.payload;
+            payload.insert(payload.end(), frame.message() + 1, frame.message() + 1 + size);
+            assembler.remaining -= size;
+            assembler.message.last = index;
+            if (assembler.remaining == 0)
+            {
+                assembler.active = false;
+                messages_.emplace_back(std::move(assembler.message));
+            }
+            break;
+        }
+        default:
+            // Flow control
+            break;
+        }
+    }
+}
+
+void CanTraceIndex::pairTransactions()
+{
+    // Open transaction for each ID a response is expected from
+    std::unordered_map<uint32_t, std::size_t> open;
+    for (std::size_t i = 0; i < messages_.size(); ++i)
+    {
+        const IsoTpTraceMessage & message = messages_[i];
+        if (message.payload.empty())
+            continue;
+        uint8_t sid = message.payload[0];
+
+        if ((sid & 0x40) == 0)
+        {
+            // Request. Functional requests are answered by several IDs and
+            // are not paired.
+            if (message.id == 0x7DF || (message.id >> 16) == 0x18DB)
+                continue;
+            open[responseId(message.id)] = transactions_.size();
+            transactions_.emplace_back(UdsTraceTransaction{static_cast<uint32_t>(i), std::nullopt, sid, std::nullopt, 0});
+            continue;
+        }
+
+        auto it = open.find(message.id);
+        if (it == open.end())
+            continue;
+        UdsTraceTransaction & transaction = transactions_[it->second];
+
+        if (sid == 0x7F)
+        {
+            if (message.payload.size() < 3 || message.payload[1] != transaction.sid)
+                continue;
+            if (message.payload[2] == 0x78)
+            {
+                ++transaction.pending;
+                continue;
+            }
+            transaction.negativeCode = message.payload[2];
+        }
+        else if (sid != transaction.sid + 0x40)
+            continue;
+
+        transaction.response = static_cast<uint32_t>(i);
+        open.erase(it);
+    }
+}
+
+std::vector<uint32_t> CanTraceIndex::ids() const
+{
+    std::vector<uint32_t> result;
+    result.reserve(postings_.size());
+    for (const auto & [id, records] : postings_)
+        result.emplace_back(id);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+const std::vector<uint32_t> & CanTraceIndex::postings(uint32_t id) const noexcept
+{
+    auto it = postings_.find(id);
+    return it == postings_.end() ? noPostings : it->second;
+}
+
+std::size_t CanTraceIndex::find(uint64_t timestamp) const noexcept
+{
+    if (timestamp <= start_ || buckets_.empty())
+        return 0;
+
+    // Narrow the search to one bucket
+    uint64_t bucket = (timestamp - start_) / bucketWidth_;
+    auto next = std::upper_bound(buckets_.begin(), buckets_.end(), bucket,
+                                 [](uint64_t number, const Bucket & b) { return number < b.number; });
+    std::size_t last = next == buckets_.end() ? trace_.size() : next->first;
+    // The first bucket is number 0, so `next` is never the first
+    const Bucket & containing = *std::prev(next);
+    if (containing.number != bucket)
+    {
+        // No records in the bucket; all earlier records are before it
+        return last;
+    }
+
+    std::size_t first = containing.first;
+    while (first < last && trace_.timestamp(first) < timestamp)
+        ++first;
+    return first;
+}
+
+std::vector<uint32_t> CanTraceIndex::filter(const CanTraceFilter & filter) const
+{
+    const std::size_t first = find(filter.from);
+    const std::size_t last =
+        filter.to == std::numeric_limits<uint64_t>::max() ? trace_.size() : find(filter.to == 0 ? 0 : filter.to + 1);
+
+    auto matches = [&](std::size_t index) {
+        if (filter.direction && trace_.direction(index) != *filter.direction)
+            return false;
+        if (filter.pattern.empty())
+            return true;
+
+        const uint8_t * data = trace_.data(index);
+        if (trace_.length(index) < filter.pattern.size())
+            return false;
+        for (std::size_t i = 0; i < filter.pattern.size(); ++i)
+        {
+            uint8_t mask = i < filter.mask.size() ? filter.mask[i] : 0xFF;
+            if ((data[i] & mask) != (filter.pattern[i] & mask))
+                return false;
+        }
+        return true;
+    };
+
+    std::vector<uint32_t> result;
+    if (filter.ids.empty())
+    {
+        for (std::size_t i = first; i < last; ++i)
+        {
+            if (matches(i))
+                result.emplace_back(static_cast<uint32_t>(i));
+        }
+        return result;
+    }
+
+    // Only visit the frames of the requested IDs
+    for (uint32_t id : filter.ids)
+    {
+        const std::vector<uint32_t> & records = postings(id);
+        auto it = std::lower_bound(records.begin(), records.end(), static_cast<uint32_t>(first));
+        for (; it != records.end() && *it < last; ++it)
+        {
+            if (matches(*it))
+                result.emplace_back(*it);
+        }
+    }
+    if (filter.ids.size() > 1)
+        std::sort(result.begin(), result.end());
+    return result;
+}
+
+} // namespace lt::network
@@ -0,0 +1,108 @@
+#ifndef LT_CANTRACEINDEX_H
+#define LT_CANTRACEINDEX_H
+
+#include "cantrace.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace lt::network
+{
+
+struct CanTraceFilter
+{
+    // Matches any ID if empty
+    std::vector<uint32_t> ids;
+    std::optional<CanMessageDirection> direction;
+    // Payload bytes that must match where `mask` is set. A missing mask
+    // byte counts as 0xFF. Frames shorter than the pattern never match.
+    std::vector<uint8_t> pattern;
+    std::vector<uint8_t> mask;
+    uint64_t from{0};
+    uint64_t to{std::numeric_limits<uint64_t>::max()};
+};
+
+// ISO-TP message reassembled from the frames of one ID
+struct IsoTpTraceMessage
+{
+    uint32_t id;
+    CanMessageDirection direction;
+    // Records of the first and last frame
+    uint32_t first;
+    uint32_t last;
+    std::vector<uint8_t> payload;
+};
+
+// A UDS request and its final response
+struct UdsTraceTransaction
+{
+    // Indices into CanTraceIndex::messages()
+    uint32_t request;
+    std::optional<uint32_t> response;
+    uint8_t sid;
+    // Set for negative final responses
+    std::optional<uint8_t> negativeCode;
+    // Response pending (0x78) responses before the final one
+    uint32_t pending{0};
+};
+
+/* Index over a trace for viewing hour-long captures. Built in one pass:
+ * per-ID posting lists for filtering by ID without scanning, time buckets
+ * for seeking, and the ISO-TP messages and UDS transactions found on
+ * physically addressed diagnostic IDs (ID +8, or 29 bit 0x18DA
+ * normal fixed addressing). */
+class CanTraceIndex
+{
+public:
+    static constexpr uint64_t defaultBucketWidth = 1000000000ULL;
+
+    explicit CanTraceIndex(const CanTraceReader & trace, uint64_t bucketWidth = defaultBucketWidth);
+
+    inline const CanTraceReader & trace() const noexcept { return trace_; }
+
+    // IDs seen in the trace, sorted
+    std::vector<uint32_t> ids() const;
+
+    // Records with `id`, in order. Empty if the ID was never seen.
+    const std::vector<uint32_t> & postings(uint32_t id) const noexcept;
+
+    // Index of the first record at or after `timestamp`
+    std::size_t find(uint64_t timestamp) const noexcept;
+
+    // Record indices matching `filter`, in order
+    std::vector<uint32_t> filter(const CanTraceFilter & filter) const;
+
+    inline const std::vector<IsoTpTraceMessage> & messages() const noexcept { return messages_; }
+    inline const std::vector<UdsTraceTransaction> & transactions() const noexcept { return transactions_; }
+
+private:
+    const CanTraceReader & trace_;
+    uint64_t bucketWidth_;
+    uint64_t start_{0};
+
+    struct Bucket
+    {
+        // Number of the bucket of `bucketWidth_` ns from start_
+        uint64_t number;
+        // First record in the bucket
+        uint32_t first;
+    };
+
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings_;
+    // Buckets holding at least one record, by number. Sparse, so gaps in
+    // the capture cost nothing.
+    std::vector<Bucket> buckets_;
+
+    std::vector<IsoTpTraceMessage> messages_;
+    std::vector<UdsTraceTransaction> transactions_;
+
+    void build();
+    void pairTransactions();
+};
+
+} // namespace lt::network
+
+#endif // LT_CANTRACEINDEX_H
@@ -1,7 +1,10 @@
 #include <utility>
 
 #include "elm327.h"
+#include "network/error.h"
 
+#include <cctype>
+#include <exception>
 #include <iomanip>
 #include <sstream>
 #include <stdexcept>
@@ -15,7 +18,46 @@ Elm327::Elm327(std::string port, serial::Settings serialSettings)
 
 }
 
-void Elm327::open() { device_.open(); }
+void Elm327::open()
+{
+    device_.open();
+    chip_ = ElmChip::Elm327;
+    version_ = 0;
+    header_.reset();
+    receiveAddress_.reset();
+    fcId_.reset();
+    timeout_.reset();
+    adaptiveTiming_.reset();
+
+    setEcho(false);
+    identify();
+}
+
+void Elm327::identify()
+{
+    // e.g. "ELM327 v1.5". Clones often report versions they do not
+    // implement, but the response count is harmless if ignored.
+    for (const std::string & line : sendCommand("AT I"))
+    {
+        auto pos = line.find(" v");
+        if (pos == std::string::npos || pos + 4 > line.size() || line[pos + 3] != '.')
+            continue;
+        if (std::isdigit(static_cast<unsigned char>(line[pos + 2])) &&
+            std::isdigit(static_cast<unsigned char>(line[pos + 4])))
+            version_ = (line[pos + 2] - '0') * 10 + (line[pos + 4] - '0');
+    }
+
+    // ELM327 chips respond with "?" to ST commands
+    try
+    {
+        std::vector<std::string> response = sendCommand("STI");
+        if (!response.empty() && response.front().compare(0, 3, "STN") == 0)
+            chip_ = ElmChip::Stn;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+}
 
 void Elm327::setProtocol(ElmProtocol protocol)
 {
@@ -37,34 +79,72 @@ void Elm327::writeLine(std::string line)
 }
 
 std::vector<std::string> Elm327::sendCommand(const std::string & command)
+{
+    std::vector<std::string> response;
+    sendCommand(command, [&response](std::string_view line) { response.emplace_back(line); });
+    return response;
+}
+
+void Elm327::sendCommand(const std::string & command, const LineCallback & onLine)
 {
     reader_.clear();
     writeLine(command);
+    readResponse(command, onLine);
+}
 
-    std::vector<std::string> response;
+void Elm327::readResponse(const std::string & command, const LineCallback & onLine)
+{
+    reader_.readUntil(response_, '>');
+
+    // Errors are reported after the whole response was read so the next
+    // command does not read the rest of this response
+    const char * error = nullptr;
+    bool noData = false;
+    std::exception_ptr callbackError;
+    bool first = true;
 
-    std::string line;
-    while (true)
+    std::string_view remaining(response_);
+    while (!remaining.empty())
     {
-        line = reader_.readLine(">");
+        std::size_t end = remaining.find_first_of("\r\n");
+        std::string_view line = remaining.substr(0, end);
+        remaining.remove_prefix(end == std::string_view::npos ? remaining.size() : end + 1);
+
         if (line.empty())
             continue;
-        if (line == command && response.empty())
+        if (line == command && first)
+        {
+            first = false;
             continue;
-        if (line == ">")
-            break;
+        }
+        first = false;
 
         if (line == "?")
-            throw std::runtime_error("received ? from elm");
-
-        if (line == "CAN ERROR")
-            throw std::runtime_error("received CAN ERROR");
-        if (line == "NO DATA")
-            throw std::runtime_error("received no data");
-
-        response.emplace_back(std::move(line));
+            error = "received ? from elm";
+        else if (line == "CAN ERROR")
+            error = "received CAN ERROR";
+        else if (line == "NO DATA")
+            noData = true;
+        else if (!callbackError)
+        {
+            try
+            {
+                onLine(line);
+            }
+            catch (...)
+            {
+                callbackError = std::current_exception();
+            }
+        }
     }
-    return response;
+
+    if (error != nullptr)
+        throw std::runtime_error(error);
+    // The adapter timed out waiting for a response
+    if (noData)
+        throw TimeoutError("received no data");
+    if (callbackError)
+        std::rethrow_exception(callbackError);
 }
 
 void Elm327::sendBasicCommand(const std::string & command)
@@ -76,6 +156,47 @@ void Elm327::sendBasicCommand(const std::string & command)
     }
 }
 
+void Elm327::sendBasicCommands(const std::vector<std::string> & commands)
+{
+    if (chip_ != ElmChip::Stn)
+    {
+        for (const std::string & command : commands)
+            sendBasicCommand(command);
+        return;
+    }
+
+    std::string batch;
+    for (const std::string & command : commands)
+    {
+        batch += command;
+        batch += '\r';
+    }
+
+    reader_.clear();
+    if (!isOpen())
+        throw std::runtime_error("attempted to write line to closed connection");
+    device_.write(batch);
+
+    // Read every response before reporting errors to keep the reader in sync
+    std::string failed;
+    for (const std::string & command : commands)
+    {
+        try
+        {
+            std::vector<std::string> response;
+            readResponse(command, [&response](std::string_view line) { response.emplace_back(line); });
+            if (response.size() != 1 || response.front() != "OK")
+                failed = command;
+        }
+        catch (const std::runtime_error &)
+        {
+            failed = command;
+        }
+    }
+    if (!failed.empty())
+        throw std::runtime_error("received invalid response to \"" + failed + "\", expected \"OK\"");
+}
+
 void Elm327::setEcho(bool echo)
 {
     std::string command = "AT E ";
@@ -92,23 +213,32 @@ void Elm327::setHeaders(bool headers)
 
 void Elm327::setCanFCId11(uint16_t id)
 {
+    if (fcId_ == id)
+        return;
     std::stringstream ss;
     ss << "AT FC SH " << std::setfill('0') << std::setw(3) << std::hex << id;
     sendBasicCommand(ss.str());
+    fcId_ = id;
 }
 
 void Elm327::setHeader(uint16_t header)
 {
+    if (header_ == header)
+        return;
     std::stringstream ss;
     ss << "AT SH " << std::setfill('0') << std::setw(3) << std::hex << header;
     sendBasicCommand(ss.str());
+    header_ = header;
 }
 
 void Elm327::setCanReceiveAddress11(uint16_t address)
 {
+    if (receiveAddress_ == address)
+        return;
     std::stringstream ss;
     ss << "AT CRA " << std::setfill('0') << std::setw(3) << std::hex << address;
     sendBasicCommand(ss.str());
+    receiveAddress_ = address;
 }
 
 void Elm327::setPrintSpaces(bool printSpaces)
@@ -120,9 +250,26 @@ void Elm327::setPrintSpaces(bool printSpaces)
 
 void Elm327::setTimeout(uint8_t timeout)
 {
+    if (timeout_ == timeout)
+        return;
     std::stringstream ss;
-    ss << "AT ST " << std::setfill('0') << std::setw(2) << std::hex << timeout;
+    // uint8_t would be formatted as a character
+    ss << "AT ST " << std::setfill('0') << std::setw(2) << std::hex << static_cast<uint32_t>(timeout);
     sendBasicCommand(ss.str());
+    timeout_ = timeout;
+
+    // The serial device gives up on reads long before the adapter does
+    reader_.setTimeout(std::chrono::milliseconds(timeout * 4096 / 1000 + 1000));
+}
+
+void Elm327::setAdaptiveTiming(uint8_t mode)
+{
+    if (mode > 2)
+        throw std::runtime_error("invalid adaptive timing mode " + std::to_string(mode));
+    if (adaptiveTiming_ == mode)
+        return;
+    sendBasicCommand("AT AT" + std::to_string(mode));
+    adaptiveTiming_ = mode;
 }
 
 } // namespace lt::network
\ No newline at end of file
@@ -1,7 +1,10 @@
 #ifndef LT_ELM327_H
 #define LT_ELM327_H
 
+#include <functional>
 #include <memory>
+#include <optional>
+#include <string_view>
 #include <serial/bufferedreader.h>
 #include <serial/device.h>
 
@@ -25,15 +28,39 @@ enum class ElmProtocol : uint8_t
     USER2_CAN = 0xC,
 };
 
+// Adapter chip family
+enum class ElmChip
+{
+    Elm327,
+    // ScanTool STN11xx/STN21xx. Supports STPX and deeper buffers.
+    Stn,
+};
+
 class Elm327
 {
 public:
+    // Called for each line of a response. The view is only valid during the
+    // call.
+    using LineCallback = std::function<void(std::string_view)>;
+
     Elm327(std::string port = "",
            serial::Settings serialSettings = serial::Settings{});
 
-    // Opens serial device
+    // Opens serial device, disables echo and identifies the chip
     void open();
 
+    inline ElmChip chip() const noexcept { return chip_; }
+
+    // ELM327 version reported by `AT I` times ten (e.g. 15 for v1.5), or 0 if
+    // unknown
+    inline int version() const noexcept { return version_; }
+
+    // True if requests may end with the expected response count (v1.3+)
+    inline bool supportsResponseCount() const noexcept { return chip_ == ElmChip::Stn || version_ >= 13; }
+
+    // True if messages longer than a single frame can be sent (STPX)
+    inline bool supportsLongMessages() const noexcept { return chip_ == ElmChip::Stn; }
+
     inline bool isOpen() const noexcept { return device_.isOpen(); }
 
     void setProtocol(ElmProtocol protocol);
@@ -61,20 +88,52 @@ public:
     // Enable or disables printing spaces
     void setPrintSpaces(bool printSpaces);
 
-    // Sets timeout byte (0 = 0ms, 0xFF = 1000ms)
+    // Sets timeout byte in units of 4.096ms (0xFF = 1044ms)
     void setTimeout(uint8_t timeout);
 
+    // Sets adaptive timing mode (0 = off, 1 = normal, 2 = aggressive)
+    void setAdaptiveTiming(uint8_t mode);
+
     // Sends a command and waits for a response. Returns response separated into
     // lines.
     std::vector<std::string> sendCommand(const std::string & command);
 
+    /* Sends a command and calls `onLine` with each line of the response as
+     * it is read. Error responses are thrown after the prompt. Exceptions
+     * from `onLine` are rethrown once the response has been read. */
+    void sendCommand(const std::string & command, const LineCallback & onLine);
+
     // Same as `sendCommand()` but throws an exception if the response is not
     // "OK"
     void sendBasicCommand(const std::string & command);
 
+    /* Sends multiple commands that respond with "OK". STN adapters receive
+     * the whole batch in a single write; ELM327 chips may abort a command
+     * when input arrives while busy, so they are sent one at a time. */
+    void sendBasicCommands(const std::vector<std::string> & commands);
+
 private:
     serial::Device device_;
     serial::BufferedReader reader_;
+
+    ElmChip chip_{ElmChip::Elm327};
+    int version_{0};
+
+    // Last values sent to the adapter. Used to skip redundant commands.
+    std::optional<uint16_t> header_;
+    std::optional<uint16_t> receiveAddress_;
+    std::optional<uint16_t> fcId_;
+    std::optional<uint8_t> timeout_;
+    std::optional<uint8_t> adaptiveTiming_;
+
+    // Text of the last response. Reused between commands.
+    std::string response_;
+
+    // Reads lines until the prompt. Skips the echo of `command`.
+    void readResponse(const std::string & command, const LineCallback & onLine);
+
+    // Determines the chip family and version
+    void identify();
 };
 using Elm327Ptr = std::shared_ptr<Elm327>;
 
@@ -0,0 +1,21 @@
+#ifndef LT_NETWORK_ERROR_H
+#define LT_NETWORK_ERROR_H
+
+#include <stdexcept>
+#include <string>
+
+namespace lt::network
+{
+
+/* Thrown when a response did not arrive in time. Kept separate from other
+ * errors so callers can tell a dead request, which is safe to retry, from
+ * a broken link. */
+class TimeoutError : public std::runtime_error
+{
+public:
+    explicit TimeoutError(const std::string & what = "timed out") : std::runtime_error(what) {}
+};
+
+} // namespace lt::network
+
+#endif // LT_NETWORK_ERROR_H
@@ -0,0 +1,193 @@
+#include "asyncisotp.h"
+#include "network/error.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+namespace lt::network
+{
+
+namespace detail
+{
+uint8_t calculate_st(std::chrono::microseconds time)
+{
+    assert(time.count() >= 0);
+    if (time.count() == 0)
+        return 0;
+
+    if (time >= std::chrono::milliseconds(1))
+    {
+        return static_cast<uint8_t>(std::min<std::chrono::milliseconds::rep>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(time).count(),
+            127));
+    }
+    uint8_t count = static_cast<uint8_t>(
+        std::max<std::chrono::milliseconds::rep>(time.count() / 100, 1));
+    return count + 0xF0;
+}
+
+std::chrono::microseconds calculate_time(uint8_t st)
+{
+    if (st <= 127)
+        return std::chrono::milliseconds(st);
+    if (st >= 0xF1 && st <= 0xF9)
+        return std::chrono::microseconds((st - 0xF0) * 100);
+    return std::chrono::microseconds(0);
+}
+} // namespace detail
+
+constexpr uint8_t typeSingle = 0;
+constexpr uint8_t typeFirst = 1;
+constexpr uint8_t typeConsec = 2;
+constexpr uint8_t typeFlow = 3;
+
+// Flow control flags
+constexpr uint8_t flowContinue = 0;
+constexpr uint8_t flowWait = 1;
+constexpr uint8_t flowAbort = 2;
+
+AsyncIsoTp::AsyncIsoTp(AsyncCan & can, IsoTpOptions options) : can_(can), options_(options) {}
+
+void AsyncIsoTp::sendFrame(CanMessage & message)
+{
+    message.setId(options_.sourceId);
+    message.pad();
+    can_.send(message);
+}
+
+async::Task<CanMessage> AsyncIsoTp::recvFrame(async::CancellationToken token)
+{
+    const auto deadline = async::Clock::now() + options_.timeout;
+    while (true)
+    {
+        std::optional<CanMessage> message = co_await can_.recv(deadline, token);
+        if (!message)
+            throw TimeoutError();
+
+        if (message->id() != options_.destId)
+            continue;
+        if (message->length() == 0)
+            throw std::runtime_error("received empty frame");
+        co_return *message;
+    }
+}
+
+async::Task<CanMessage> AsyncIsoTp::recvFrame(uint8_t expectedType, async::CancellationToken token)
+{
+    CanMessage message = co_await recvFrame(token);
+    uint8_t type = message[0] >> 4;
+    if (type != expectedType)
+    {
+        throw std::runtime_error("received unexpected frame type. Got " + std::to_string(type) + ", expected " +
+                                 std::to_string(expectedType));
+    }
+    co_return message;
+}
+
+async::Task<void> AsyncIsoTp::send(IsoTpPacket packet, async::CancellationToken token)
+{
+    token.throwIfCanceled();
+    if (packet.size() > 0xFFF)
+        throw std::runtime_error("packet is too large for ISO-TP: " + std::to_string(packet.size()) + " bytes");
+
+    CanMessage message;
+    if (packet.size() <= 7)
+    {
+        message[0] = (typeSingle << 4) | static_cast<uint8_t>(packet.size());
+        std::copy(packet.begin(), packet.end(), message.message() + 1);
+        message.setLength(static_cast<uint8_t>(packet.size() + 1));
+        sendFrame(message);
+        co_return;
+    }
+
+    IsoTpPacketReader reader(packet);
+    message[0] = (typeFirst << 4) | ((reader.remaining() & 0xF00) >> 8);
+    message[1] = reader.remaining() & 0xFF;
+    message.setLength(static_cast<uint8_t>(reader.next(message.message() + 2, 6) + 2));
+    sendFrame(message);
+
+    uint8_t consecIndex = 1;
+    while (reader.remaining() != 0)
+    {
+        CanMessage flow;
+        do
+        {
+            flow = co_await recvFrame(typeFlow, token);
+            if (flow.length() < 3)
+                throw std::runtime_error("received invalid flow control response: too short");
+            if ((flow[0] & 0x0F) == flowAbort)
+                throw std::runtime_error("remote requested to abort transfer");
+        } while ((flow[0] & 0x0F) == flowWait);
+
+        uint8_t blockSize = flow[1];
+        const auto separationTime = detail::calculate_time(flow[2]);
+
+        do
+        {
+            token.throwIfCanceled();
+            message = CanMessage();
+            message[0] = (typeConsec << 4) | consecIndex;
+            consecIndex = (consecIndex + 1) & 0x0F;
+            message.setLength(static_cast<uint8_t>(reader.next(message.message() + 1, 7) + 1));
+            sendFrame(message);
+
+            if (separationTime.count() != 0 && reader.remaining() != 0)
+                co_await can_.loop().sleep(separationTime, token);
+        } while (reader.remaining() != 0 && (blockSize == 0 || --blockSize != 0));
+    }
+}
+
+async::Task<IsoTpPacket> AsyncIsoTp::recv(async::CancellationToken token)
+{
+    CanMessage message = co_await recvFrame(token);
+    IsoTpPacket result;
+
+    uint8_t type = message[0] >> 4;
+    if (type == typeSingle)
+    {
+        uint8_t length = std::min<uint8_t>(message[0] & 0x0F, message.length() - 1);
+        result.setData(message.message() + 1, length);
+        co_return result;
+    }
+
+    if (type != typeFirst)
+    {
+        throw std::runtime_error("received invalid frame type. Expected " + std::to_string(typeSingle) + " or " +
+                                 std::to_string(typeFirst) + ", got " + std::to_string(type));
+    }
+
+    std::size_t remaining = ((message[0] & 0x0F) << 8) | message[1];
+    std::size_t first = std::min<std::size_t>(remaining, 6);
+    result.append(message.message() + 2, first);
+    remaining -= first;
+
+    // Flow control: no block limit or separation time
+    CanMessage flow;
+    flow[0] = typeFlow << 4;
+    flow.setLength(3);
+    sendFrame(flow);
+
+    uint8_t consecIndex = 1;
+    while (remaining != 0)
+    {
+        CanMessage frame = co_await recvFrame(typeConsec, token);
+        if ((frame[0] & 0x0F) != consecIndex)
+            throw std::runtime_error("received invalid consecutive frame index");
+        consecIndex = (consecIndex + 1) & 0x0F;
+
+        std::size_t received = std::min<std::size_t>(frame.length() - 1, remaining);
+        result.append(frame.message() + 1, received);
+        remaining -= received;
+    }
+    co_return result;
+}
+
+async::Task<IsoTpPacket> AsyncIsoTp::request(IsoTpPacket packet, async::CancellationToken token)
+{
+    co_await send(std::move(packet), token);
+    co_return co_await recv(std::move(token));
+}
+
+} // namespace lt::network
@@ -0,0 +1,54 @@
+#ifndef LT_ASYNCISOTP_H
+#define LT_ASYNCISOTP_H
+
+#include "async/task.h"
+#include "isotp.h"
+#include "network/can/asynccan.h"
+
+namespace lt::network
+{
+
+namespace detail
+{
+// Encodes a separation time as an STmin byte
+uint8_t calculate_st(std::chrono::microseconds time);
+// Decodes an STmin byte. Reserved values decode to 0.
+std::chrono::microseconds calculate_time(uint8_t st);
+} // namespace detail
+
+/* ISO 15765-2 transport layer (ISO-TP) over an AsyncCan. Operations are
+ * coroutines run on the CAN interface's event loop. Cancellation is checked
+ * at every frame, so a canceled token aborts a transfer in progress instead
+ * of waiting for it to finish or time out. Packets are taken by value
+ * because the coroutines may outlive the caller's arguments. */
+class AsyncIsoTp
+{
+public:
+    explicit AsyncIsoTp(AsyncCan & can, IsoTpOptions options = IsoTpOptions());
+
+    async::Task<void> send(IsoTpPacket packet, async::CancellationToken token = {});
+
+    async::Task<IsoTpPacket> recv(async::CancellationToken token = {});
+
+    // Sends a request and waits for a response
+    async::Task<IsoTpPacket> request(IsoTpPacket packet, async::CancellationToken token = {});
+
+    inline void setOptions(const IsoTpOptions & options) noexcept { options_ = options; }
+    inline const IsoTpOptions & options() const noexcept { return options_; }
+
+    inline AsyncCan & can() noexcept { return can_; }
+
+private:
+    AsyncCan & can_;
+    IsoTpOptions options_;
+
+    // Receives the next frame from destId. Throws on timeout.
+    async::Task<CanMessage> recvFrame(async::CancellationToken token);
+    async::Task<CanMessage> recvFrame(uint8_t expectedType, async::CancellationToken token);
+
+    void sendFrame(CanMessage & message);
+};
+
+} // namespace lt::network
+
+#endif // LT_ASYNCISOTP_H
@@ -1,5 +1,7 @@
 #include "isotp.h"
 
+#include <algorithm>
+
 namespace lt::network
 {
 
@@ -25,4 +27,30 @@ void IsoTpPacket::append(const uint8_t * data, size_t size)
     data_.insert(data_.begin() + data_.size(), data, data + size);
 }
 
+std::vector<uint8_t> IsoTpPacketReader::next(std::size_t max)
+{
+    std::size_t toRead = std::min(max, remaining());
+
+    std::vector<uint8_t> rem(packet_.cbegin() + pointer_,
+                             packet_.cbegin() + pointer_ + toRead);
+    pointer_ += toRead;
+    return rem;
+}
+
+std::size_t IsoTpPacketReader::next(uint8_t * dest, std::size_t max)
+{
+    std::size_t toRead = std::min(max, remaining());
+    std::copy(packet_.cbegin() + pointer_, packet_.cbegin() + pointer_ + toRead,
+              dest);
+    pointer_ += toRead;
+    return toRead;
+}
+
+std::vector<uint8_t> IsoTpPacketReader::readRemaining()
+{
+    std::vector<uint8_t> rem(packet_.cbegin() + pointer_, packet_.cend());
+    pointer_ = packet_.size();
+    return rem;
+}
+
 } // namespace lt::network
@@ -34,6 +34,9 @@ public:
 
     inline std::vector<uint8_t>::size_type size() const { return data_.size(); }
 
+    /* Resizes the packet. Used to decode data in place. */
+    inline void resize(std::size_t size) { data_.resize(size); }
+
     inline uint8_t & operator[](int index) { return data_[index]; }
 
     inline uint8_t operator[](int index) const { return data_[index]; }
@@ -89,6 +92,15 @@ public:
     virtual void send(const IsoTpPacket & packet) = 0;
 
     virtual void setOptions(const IsoTpOptions & options) = 0;
+
+    // Sets the response timeout, keeping the other options
+    virtual void setTimeout(std::chrono::milliseconds timeout) = 0;
+
+    // Current response timeout
+    virtual std::chrono::milliseconds timeout() const = 0;
+
+    // Discards received packets that have not been read
+    virtual void clearBuffer() {}
 };
 using IsoTpPtr = std::unique_ptr<IsoTp>;
 
@@ -1,19 +1,20 @@
 #ifndef LT_ISOTPCAN_H
 #define LT_ISOTPCAN_H
 
+#include "asyncisotp.h"
 #include "isotp.h"
 
 namespace lt::network
 {
 
-// ISO 15765-2 transport layer (ISO-TP) for sending large packets over CAN
+/* ISO 15765-2 transport layer (ISO-TP) for sending large packets over CAN.
+ * Blocking calls are run by AsyncIsoTp on a private event loop, so both
+ * share a single framing and flow control implementation. */
 class IsoTpCan : public IsoTp
 {
 public:
     // Takes ownership of a CAN interface
-    explicit IsoTpCan(CanPtr && can = CanPtr(),
-                      IsoTpOptions options = IsoTpOptions());
-    ~IsoTpCan();
+    explicit IsoTpCan(CanPtr && can, IsoTpOptions options = IsoTpOptions());
 
     void recv(IsoTpPacket & result) override;
 
@@ -22,27 +23,19 @@ public:
 
     void send(const IsoTpPacket & packet) override;
 
-    inline void setCan(CanPtr && can) { can_ = std::move(can); }
+    void setOptions(const IsoTpOptions & options) override { isotp_.setOptions(options); }
 
-    // May return nullptr
-    inline Can * can() { return can_.get(); }
+    void setTimeout(std::chrono::milliseconds timeout) override;
+    std::chrono::milliseconds timeout() const override { return isotp_.options().timeout; }
 
-    void setOptions(const IsoTpOptions & options) override
-    {
-        options_ = options;
-    }
+    void clearBuffer() override { can_.clear(); }
 
-    inline const IsoTpOptions & options() const { return options_; }
-
-    // Receives next CAN message with proper id
-    CanMessage recvNextFrame();
-    CanMessage recvNextFrame(uint8_t expectedType);
+    inline const IsoTpOptions & options() const { return isotp_.options(); }
 
 private:
-    CanPtr can_;
-    IsoTpOptions options_;
-
-    void sendSingleFrame(const uint8_t * data, std::size_t size);
+    async::EventLoop loop_;
+    AsyncCan can_;
+    AsyncIsoTp isotp_;
 };
 } // namespace lt::network
 
@@ -1,47 +1,75 @@
 #include "isotpelm.h"
 
-#include "../../support/util.hpp"
-
 #include <algorithm>
+#include <array>
 #include <cassert>
-#include <iomanip>
-#include <sstream>
+#include <stdexcept>
 
 namespace lt::network
 {
 namespace detail
 {
-inline uint8_t hexToInt(char c)
-{
-    if (c >= '0' && c <= '9')
+// Value of each hex digit; -1 for other characters
+constexpr std::array<int8_t, 256> hexValues = []() {
+    std::array<int8_t, 256> values{};
+    for (int8_t & value : values)
+        value = -1;
+    for (int i = 0; i < 10; ++i)
+        values['0' + i] = static_cast<int8_t>(i);
+    for (int i = 0; i < 6; ++i)
     {
-        return static_cast<uint8_t>(c - '0');
+        values['a' + i] = static_cast<int8_t>(0xA + i);
+        values['A' + i] = static_cast<int8_t>(0xA + i);
     }
-    if (c >= 'a' && c <= 'z')
-    {
-        return 0xA + static_cast<uint8_t>(c - 'a');
-    }
-    if (c >= 'A' && c <= 'Z')
+    return values;
+}();
+
+/* Decodes hex digits from `text` into `out`, ignoring spaces. `out` must
+ * have room for text.size() / 2 bytes. A trailing odd digit is ignored.
+ * Returns the number of bytes written. */
+inline std::size_t decodeHex(std::string_view text, uint8_t * out)
+{
+    std::size_t written = 0;
+    int high = -1;
+    for (char c : text)
     {
-        return 0xA + static_cast<uint8_t>(c - 'A');
+        if (c == ' ')
+            continue;
+        int value = hexValues[static_cast<uint8_t>(c)];
+        if (value < 0)
+            throw std::runtime_error(std::string("invalid hex character: ") + c);
+
+        if (high < 0)
+            high = value;
+        else
+        {
+            out[written++] = static_cast<uint8_t>((high << 4) | value);
+            high = -1;
+        }
     }
-    throw std::runtime_error(std::string("invalid hex character: ") + c);
+    return written;
 }
 
-template <typename Iter> std::string decodeHex(Iter begin, Iter end)
+inline void appendHex(std::string & out, const uint8_t * data, std::size_t size)
 {
-    std::string decoded;
-    for (auto it = begin; it != end; ++it)
+    constexpr char digits[] = "0123456789ABCDEF";
+    for (std::size_t i = 0; i < size; ++i)
     {
-        uint8_t byte = hexToInt(*it) << 4;
-        if (++it == end)
-        {
-            break;
-        }
-        byte |= hexToInt(*it);
-        decoded += static_cast<char>(byte);
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 0xF];
     }
-    return decoded;
+}
+
+/* Requests of the same shape usually get responses of the same length. The
+ * shape is the request length and up to three leading bytes: the service
+ * and its sub-function or data identifier. Later bytes, such as the low
+ * bytes of an address, are left out so that reading memory shares a hint. */
+inline uint64_t hintKey(const IsoTpPacket & packet)
+{
+    uint64_t key = packet.size();
+    for (std::size_t i = 0; i < 3; ++i)
+        key = (key << 8) | (i < packet.size() ? packet.data()[i] : 0);
+    return key;
 }
 } // namespace detail
 
@@ -54,14 +82,12 @@ IsoTpElm::IsoTpElm(Elm327Ptr device, IsoTpOptions options)
         throw std::runtime_error("Elm327 device is not open");
     }
 
-    // Disable  echo
-    device_->setEcho(false);
-    // Set protocol
-    device_->setProtocol(ElmProtocol::ISO_15765_4_CAN_11bit_500);
-    // Disable printing spaces
-    device_->setPrintSpaces(false);
-    // Disable printing headers
-    device_->setHeaders(false);
+    // Echo is disabled by Elm327::open(). Protocol 6 is ISO 15765-4 CAN
+    // (11 bit ID, 500 kbaud); no linefeeds, spaces or headers keeps each
+    // response as short as possible.
+    device_->sendBasicCommands({"AT SP 6", "AT L0", "AT S0", "AT H0"});
+    // STN adaptive timing is reliable enough to run aggressively
+    device_->setAdaptiveTiming(device_->chip() == ElmChip::Stn ? 2 : 1);
 
     updateOptions();
 }
@@ -89,18 +115,81 @@ void IsoTpElm::request(const IsoTpPacket & req, IsoTpPacket & result)
     buffer_.pop();
 }
 
+std::string IsoTpElm::formatRequest(const IsoTpPacket & packet, uint8_t expectedFrames) const
+{
+    std::string command;
+    // Plain requests take a single digit response count
+    if (packet.size() > 7 || (expectedFrames > 0xF && device_->supportsLongMessages()))
+    {
+        // Only a single frame can be sent with a plain request
+        if (!device_->supportsLongMessages())
+            throw std::runtime_error("ELM327 adapters cannot send messages longer than 7 bytes");
+
+        command.reserve(packet.size() * 2 + 16);
+        command += "STPX D:";
+        detail::appendHex(command, packet.data(), packet.size());
+        if (expectedFrames != 0)
+        {
+            command += ", R:";
+            command += std::to_string(expectedFrames);
+        }
+        return command;
+    }
+
+    command.reserve(packet.size() * 2 + 1);
+    detail::appendHex(command, packet.data(), packet.size());
+    // The count is a single hex digit
+    if (expectedFrames != 0 && expectedFrames <= 0xF)
+        command += "0123456789ABCDEF"[expectedFrames];
+    return command;
+}
+
+std::size_t IsoTpElm::exchange(const IsoTpPacket & packet, uint8_t expectedFrames)
+{
+    parser_.reset();
+    device_->sendCommand(formatRequest(packet, expectedFrames),
+                         [this](std::string_view line) { parser_.parseLine(line); });
+    parser_.finish();
+    return parser_.frames();
+}
+
 void IsoTpElm::send(const IsoTpPacket & packet)
 {
-    // Format packet into hex string
-    std::stringstream ss;
-    for (uint8_t ch : packet)
+    if (packet.empty())
+        throw std::runtime_error("attempted to send an empty packet");
+
+    const uint64_t key = detail::hintKey(packet);
+    // Unknown shapes get 0, which sends no hint
+    uint8_t expectedFrames = device_->supportsResponseCount() ? responseFrames_.get(key) : 0;
+
+    const std::size_t queued = buffer_.size();
+    std::size_t frames;
+    try
     {
-        ss << std::hex << std::setw(2) << std::setfill('0')
-           << static_cast<uint32_t>(ch);
+        frames = exchange(packet, expectedFrames);
     }
+    catch (const std::runtime_error &)
+    {
+        responseFrames_.erase(key);
+        if (expectedFrames == 0)
+            throw;
 
-    std::vector<std::string> response = device_->sendCommand(ss.str());
-    processResponse(response);
+        // The hint may have cut the response short. Drop what this attempt
+        // queued and retry once without it.
+        std::queue<IsoTpPacket> kept;
+        for (std::size_t i = 0; i < queued; ++i)
+        {
+            kept.push(std::move(buffer_.front()));
+            buffer_.pop();
+        }
+        buffer_ = std::move(kept);
+        frames = exchange(packet, 0);
+    }
+
+    if (frames == 0 || frames > 0xFF)
+        responseFrames_.erase(key);
+    else
+        responseFrames_.put(key, static_cast<uint8_t>(frames), 1);
 }
 
 void IsoTpElm::setOptions(const IsoTpOptions & options)
@@ -113,85 +202,111 @@ void IsoTpElm::updateOptions()
 {
     device_->setHeader(options_.sourceId);
     device_->setCanReceiveAddress11(options_.destId);
-    // TODO: set timeout
+    setTimeout(options_.timeout);
+}
+
+void IsoTpElm::setTimeout(std::chrono::milliseconds timeout)
+{
+    options_.timeout = timeout;
+    // The adapter timeout is in units of 4.096ms. Requests without a
+    // response count wait this long after the last response, so it is never
+    // raised above the adapter default (0x32, ~200ms); adaptive timing lowers
+    // it further. Elm327 caches the value, so unchanged timeouts cost no
+    // command.
+    auto units = std::clamp<long long>(timeout.count() * 1000 / 4096, 1, 0x32);
+    device_->setTimeout(static_cast<uint8_t>(units));
 }
 
-void IsoTpElm::processResponse(std::vector<std::string> & response)
+void ElmResponseParser::reset() noexcept
 {
-    IsoTpPacket packet;
+    packet_.clear();
+    expectedLength_ = 0;
+    frames_ = 0;
+    negative_ = false;
+}
 
-    int expectedLength = 0;
+void ElmResponseParser::emit()
+{
+    negative_ |= !packet_.empty() && packet_[0] == 0x7F;
+    out_.emplace(std::move(packet_));
+    packet_.clear();
+}
 
-    for (std::string & line : response)
+void ElmResponseParser::parseLine(std::string_view line)
+{
+    std::size_t digits = 0;
+    std::size_t delim = std::string_view::npos;
+    for (std::size_t i = 0; i < line.size(); ++i)
     {
-        // Strip whitespace
-        lt::remove_whitespace(line);
-        if (line.empty())
-        {
-            continue;
-        }
+        if (line[i] == ':' && delim == std::string_view::npos)
+            delim = i;
+        else if (line[i] != ' ')
+            ++digits;
+    }
+    if (digits == 0 && delim == std::string_view::npos)
+        return;
 
-        if (line.size() == 3)
+    if (digits == 3 && delim == std::string_view::npos)
+    {
+        // Multi-line packet length
+        if (!packet_.empty())
         {
-            // Multi-line packet length
-
-            if (!packet.empty())
-            {
-                // Last multi-line response was incomplete
-                throw std::runtime_error(
-                    "message did not meet expected length");
-            }
-            std::size_t pos;
-            expectedLength = std::stoul(line, &pos, 16);
-            if (pos != 3)
-            {
-                // Non-numeric character somewhere
-                throw std::runtime_error("unexpected character in response: " +
-                                         line);
-            }
-            continue;
+            // Last multi-line response was incomplete
+            throw std::runtime_error("message did not meet expected length");
         }
 
-        auto delim = std::find(line.begin(), line.end(), ':');
-        if (delim != line.end())
+        expectedLength_ = 0;
+        for (char c : line)
         {
-            // Part of multi-line packet
-            auto msgBegin = delim + 1;
-            std::string message = detail::decodeHex(msgBegin, line.end());
-            expectedLength -= message.size();
-            if (expectedLength < 0)
-            {
-                // Remove extra bytes
-                std::size_t toRemove =
-                    std::min<std::size_t>(message.size(), -expectedLength);
-                message.erase(message.begin() + (message.size() - toRemove),
-                              message.end());
-                expectedLength += toRemove;
-            }
-            // Can ranges please come sooner?
-            packet.append(reinterpret_cast<const uint8_t *>(message.c_str()),
-                          message.length());
-
-            if (expectedLength <= 0)
-            {
-                buffer_.emplace(std::move(packet));
-                packet.clear();
-            }
-            continue;
+            if (c == ' ')
+                continue;
+            int value = detail::hexValues[static_cast<uint8_t>(c)];
+            if (value < 0)
+                throw std::runtime_error("unexpected character in response: " + std::string(line));
+            expectedLength_ = expectedLength_ * 16 + value;
         }
+        return;
+    }
 
-        if (!packet.empty())
-        {
-            // The last message did not meet the expected length.
-            throw std::runtime_error("message did not meet expected length");
-        }
+    if (delim != std::string_view::npos)
+    {
+        // Part of multi-line packet
+        ++frames_;
+        std::string_view message = line.substr(delim + 1);
+
+        const std::size_t old = packet_.size();
+        packet_.resize(old + message.size() / 2);
+        int decoded = static_cast<int>(detail::decodeHex(message, packet_.data() + old));
+        // The last frame is padded past the expected length
+        int kept = std::max(0, std::min(decoded, expectedLength_));
+        packet_.resize(old + kept);
+        expectedLength_ -= kept;
+
+        if (expectedLength_ <= 0)
+            emit();
+        return;
+    }
 
-        // Single-line message
-        std::string message = detail::decodeHex(line.begin(), line.end());
-        packet.append(reinterpret_cast<const uint8_t *>(message.c_str()),
-                      message.length());
-        buffer_.emplace(std::move(packet));
-        packet.clear();
+    if (!packet_.empty())
+    {
+        // The last message did not meet the expected length.
+        throw std::runtime_error("message did not meet expected length");
+    }
+
+    // Single-line message
+    ++frames_;
+    packet_.resize(line.size() / 2);
+    packet_.resize(detail::decodeHex(line, packet_.data()));
+    emit();
+}
+
+void ElmResponseParser::finish()
+{
+    if (!packet_.empty())
+    {
+        // The response ended in the middle of a multi-line packet
+        throw std::runtime_error("message did not meet expected length");
     }
 }
-} // namespace lt::network
\ No newline at end of file
+
+} // namespace lt::network
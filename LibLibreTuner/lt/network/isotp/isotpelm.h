@@ -1,14 +1,51 @@
 #ifndef LT_ISOTPELM_H
 #define LT_ISOTPELM_H
 
+#include "../../support/lrucache.h"
 #include "../command/elm327.h"
 #include "isotp.h"
 
+#include <cstdint>
 #include <queue>
+#include <string>
+#include <string_view>
 
 namespace lt::network
 {
 
+/* Decodes ISO-TP messages from the lines of an ELM327 response (headers
+ * off). Multi-frame messages start with a 3 digit length line followed by
+ * lines prefixed with the frame index ("0:", "1:", ...). Hex is decoded
+ * straight into the packet being built. */
+class ElmResponseParser
+{
+public:
+    explicit ElmResponseParser(std::queue<IsoTpPacket> & out) : out_(out) {}
+
+    // Parses a single line and queues any completed packets
+    void parseLine(std::string_view line);
+
+    // Throws if the response ended in the middle of a message
+    void finish();
+
+    // Prepares for a new response
+    void reset() noexcept;
+
+    // Number of CAN frames in the response, or 0 if it included a negative
+    // response
+    inline std::size_t frames() const noexcept { return negative_ ? 0 : frames_; }
+
+private:
+    std::queue<IsoTpPacket> & out_;
+    IsoTpPacket packet_;
+    // Bytes remaining in the current multi-line message
+    int expectedLength_{0};
+    std::size_t frames_{0};
+    bool negative_{false};
+
+    void emit();
+};
+
 class IsoTpElm : public IsoTp
 {
 public:
@@ -23,6 +60,12 @@ public:
 
     void setOptions(const IsoTpOptions & options) override;
 
+    void setTimeout(std::chrono::milliseconds timeout) override;
+
+    std::chrono::milliseconds timeout() const override { return options_.timeout; }
+
+    void clearBuffer() override { buffer_ = std::queue<IsoTpPacket>(); }
+
     // Updates header and receive ids
     void updateOptions();
 
@@ -31,9 +74,20 @@ private:
     IsoTpOptions options_;
 
     std::queue<IsoTpPacket> buffer_;
+    ElmResponseParser parser_{buffer_};
+
+    /* Number of CAN frames in the last response to a request of the same
+     * shape. Appended to requests so the adapter returns as soon as they
+     * arrive instead of waiting for its timeout. */
+    static constexpr std::size_t maxResponseHints = 64;
+    LruCache<uint64_t, uint8_t> responseFrames_{maxResponseHints};
+
+    // Formats the command that sends `packet`
+    std::string formatRequest(const IsoTpPacket & packet, uint8_t expectedFrames) const;
 
-    // Extracts packets from ELM327 response and fills buffer
-    void processResponse(std::vector<std::string> & response);
+    // Sends `packet` once and queues the responses. Returns the number of
+    // frames received.
+    std::size_t exchange(const IsoTpPacket & packet, uint8_t expectedFrames);
 };
 
 } // namespace lt::network
@@ -1,4 +1,5 @@
 #include "isotpj2534.h"
+#include "network/error.h"
 #include <iostream>
 
 namespace lt::network
@@ -46,6 +47,8 @@ void IsoTpJ2534::recv(IsoTpPacket & result)
 
         uint32_t pNumMsgs = 1;
         channel_.readMsgs(&msg, pNumMsgs, options_.timeout.count());
+        if (pNumMsgs == 0)
+            throw TimeoutError();
 
         // Fill buffer
         if (msg.DataSize <= 4)
@@ -26,6 +26,9 @@ public:
         options_ = options;
     }
 
+    void setTimeout(std::chrono::milliseconds timeout) override { options_.timeout = timeout; }
+    std::chrono::milliseconds timeout() const override { return options_.timeout; }
+
 private:
     j2534::DevicePtr device_;
     j2534::Channel channel_;
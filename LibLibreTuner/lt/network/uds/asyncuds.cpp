@@ -0,0 +1,82 @@
+#include "asyncuds.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace lt::network
+{
+
+async::Task<UdsPacket> AsyncUds::requestRaw(uint8_t sid, std::vector<uint8_t> data, async::CancellationToken token)
+{
+    IsoTpPacket packet;
+    packet.append(&sid, 1);
+    packet.append(data.data(), data.size());
+
+    IsoTpPacket raw = co_await isotp_.request(std::move(packet), token);
+    while (true)
+    {
+        UdsPacket response(raw.data(), raw.size());
+        if (!response.negative() || response.negativeCode() != UDS_NRES_RCRRP)
+            co_return response;
+
+        // Response pending
+        raw = co_await isotp_.recv(token);
+    }
+}
+
+async::Task<UdsPacket> AsyncUds::request(uint8_t sid, std::vector<uint8_t> data, async::CancellationToken token)
+{
+    UdsPacket response = co_await requestRaw(sid, std::move(data), std::move(token));
+    if (response.negative())
+    {
+        uint8_t code = response.negativeCode();
+        std::stringstream ss;
+        ss << "negative UDS response: 0x" << std::hex << static_cast<int>(code) << " (" << std::dec
+           << static_cast<int>(code) << ")";
+        throw std::runtime_error(ss.str());
+    }
+
+    if (response.code != sid + 0x40)
+    {
+        throw std::runtime_error("uds response id (" + std::to_string(response.code) +
+                                 ") does not match expected id (" + std::to_string(sid + 0x40) + ")");
+    }
+    co_return response;
+}
+
+async::Task<std::vector<uint8_t>> AsyncUds::requestSession(uint8_t type, async::CancellationToken token)
+{
+    std::vector<uint8_t> req(1, type);
+
+    UdsPacket res = co_await request(UDS_REQ_SESSION, std::move(req), std::move(token));
+    if (res.data.empty())
+        throw std::runtime_error("received empty session control response");
+    if (res.data[0] != type)
+        throw std::runtime_error("diagnosticSessionType mismatch");
+
+    res.data.erase(res.data.begin());
+    co_return res.data;
+}
+
+async::Task<std::vector<uint8_t>> AsyncUds::readMemoryByAddress(uint32_t address, uint16_t length,
+                                                                 async::CancellationToken token)
+{
+    std::vector<uint8_t> req{
+        static_cast<uint8_t>(address >> 24), static_cast<uint8_t>(address >> 16), static_cast<uint8_t>(address >> 8),
+        static_cast<uint8_t>(address),       static_cast<uint8_t>(length >> 8),   static_cast<uint8_t>(length),
+    };
+
+    UdsPacket res = co_await request(UDS_REQ_READMEM, std::move(req), std::move(token));
+    co_return res.data;
+}
+
+async::Task<std::vector<uint8_t>> AsyncUds::readDataByIdentifier(uint16_t id, async::CancellationToken token)
+{
+    std::vector<uint8_t> req{static_cast<uint8_t>(id >> 8), static_cast<uint8_t>(id)};
+
+    UdsPacket res = co_await request(UDS_REQ_READBYID, std::move(req), std::move(token));
+    co_return res.data;
+}
+
+} // namespace lt::network
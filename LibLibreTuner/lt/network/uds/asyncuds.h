@@ -0,0 +1,43 @@
+#ifndef LT_ASYNCUDS_H
+#define LT_ASYNCUDS_H
+
+#include "network/isotp/asyncisotp.h"
+#include "uds.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace lt::network
+{
+
+// UDS client over AsyncIsoTp. Mirrors Uds with cancellable coroutines.
+class AsyncUds
+{
+public:
+    explicit AsyncUds(AsyncIsoTp & isotp) : isotp_(isotp) {}
+
+    /* Sends a request and waits for the positive response, skipping
+     * "response pending" (RCRRP) responses. Throws on negative responses. */
+    async::Task<UdsPacket> request(uint8_t sid, std::vector<uint8_t> data, async::CancellationToken token = {});
+
+    /* Sends a request and returns the final response, skipping "response
+     * pending" responses. Does not throw on negative responses. */
+    async::Task<UdsPacket> requestRaw(uint8_t sid, std::vector<uint8_t> data, async::CancellationToken token = {});
+
+    // DiagnosticSessionControl. Returns the parameter record.
+    async::Task<std::vector<uint8_t>> requestSession(uint8_t type, async::CancellationToken token = {});
+
+    async::Task<std::vector<uint8_t>> readMemoryByAddress(uint32_t address, uint16_t length,
+                                                          async::CancellationToken token = {});
+
+    async::Task<std::vector<uint8_t>> readDataByIdentifier(uint16_t id, async::CancellationToken token = {});
+
+    inline AsyncIsoTp & isotp() noexcept { return isotp_; }
+
+private:
+    AsyncIsoTp & isotp_;
+};
+
+} // namespace lt::network
+
+#endif // LT_ASYNCUDS_H
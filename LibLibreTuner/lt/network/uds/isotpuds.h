@@ -19,6 +19,9 @@ public:
     // Inherited via Uds
     virtual UdsPacket requestRaw(const UdsPacket & packet) override;
     virtual UdsPacket receiveRaw() override;
+    void setTimeout(std::chrono::milliseconds timeout) override { isotp_->setTimeout(timeout); }
+    std::optional<std::chrono::milliseconds> timeout() const override { return isotp_->timeout(); }
+    void clearBuffer() override { isotp_->clearBuffer(); }
 
 private:
     IsoTpPtr isotp_;
@@ -1,4 +1,5 @@
 #include "uds.h"
+#include "network/error.h"
 
 #include <array>
 #include <sstream>
@@ -9,42 +10,103 @@ namespace lt
 namespace network
 {
 
-UdsPacket Uds::request(uint8_t sid, const uint8_t * data, size_t size)
+UdsPacket Uds::query(uint8_t sid, const uint8_t * data, size_t size)
 {
-    // Receive until we get a non-response-pending packet
-
     // Build request
     UdsPacket request(sid, data, size);
+    ++stats_.requests;
 
-    UdsPacket response = requestRaw(request);
+    if (stale_)
+    {
+        clearBuffer();
+        stale_ = false;
+    }
 
-    do
+    // Only idempotent services adapt their timeout; a timed out erase or
+    // download cannot be repeated
+    const bool retryable = UdsTiming::retryable(sid);
+    const std::optional<std::chrono::milliseconds> configured = retryable ? timeout() : std::nullopt;
+    struct RestoreTimeout
     {
-        if (response.negative())
+        Uds & uds;
+        std::optional<std::chrono::milliseconds> timeout;
+        ~RestoreTimeout()
+        {
+            if (timeout)
+                uds.setTimeout(*timeout);
+        }
+    } restore{*this, configured};
+
+    const int attempts = retryable ? timing_.options().retries + 1 : 1;
+    for (int attempt = 0;; ++attempt)
+    {
+        if (configured)
+            setTimeout(timing_.timeout(sid, attempt));
+        auto start = std::chrono::steady_clock::now();
+
+        UdsPacket response;
+        try
+        {
+            response = requestRaw(request);
+        }
+        catch (const TimeoutError &)
+        {
+            ++stats_.timeouts;
+            if (attempt + 1 >= attempts)
+                throw;
+            ++stats_.retries;
+            clearBuffer();
+            continue;
+        }
+
+        // Receive until we get a non-response-pending packet
+        bool pending = false;
+        while (response.negative() && response.negativeCode() == UDS_NRES_RCRRP)
         {
-            uint8_t code = response.negativeCode();
-            if (code == UDS_NRES_RCRRP)
-            {
-                // Response pending
-                response = receiveRaw();
-                continue;
-            }
-            std::stringstream ss;
-            ss << "negative UDS response: 0x" << std::hex
-               << static_cast<int>(code) << " (" << std::dec
-               << static_cast<int>(code) << ")";
-            throw std::runtime_error(ss.str());
+            ++stats_.pending;
+            pending = true;
+            if (configured)
+                setTimeout(timing_.pendingTimeout());
+            response = receiveRaw();
         }
 
-        if (response.code != sid + 0x40)
+        // Only unambiguous round trips are sampled: after a retry the
+        // response may belong to an earlier attempt (Karn's algorithm), and
+        // pending responses measure the server's processing time
+        if (attempt == 0 && !pending)
         {
-            throw std::runtime_error("uds response id (" +
-                                     std::to_string(response.code) +
-                                     ") does not match expected id (" +
-                                     std::to_string(sid + 0x40) + ")");
+            timing_.sample(sid, std::chrono::duration_cast<std::chrono::microseconds>(
+                                    std::chrono::steady_clock::now() - start));
         }
+
+        if (response.negative())
+            ++stats_.negative;
+        stale_ = attempt != 0;
         return response;
-    } while (true);
+    }
+}
+
+UdsPacket Uds::request(uint8_t sid, const uint8_t * data, size_t size)
+{
+    UdsPacket response = query(sid, data, size);
+    if (response.negative())
+    {
+        uint8_t code = response.negativeCode();
+        std::stringstream ss;
+        ss << "negative UDS response: 0x" << std::hex
+           << static_cast<int>(code) << " (" << std::dec
+           << static_cast<int>(code) << ")";
+        throw std::runtime_error(ss.str());
+    }
+
+    if (response.code != sid + 0x40)
+    {
+        throw std::runtime_error("uds response id (" +
+                                 std::to_string(response.code) +
+                                 ") does not match expected id (" +
+                                 std::to_string(sid + 0x40) + ")");
+    }
+    return response;
 }
 
 std::vector<uint8_t> Uds::requestSession(uint8_t type)
@@ -61,6 +123,12 @@ std::vector<uint8_t> Uds::requestSession(uint8_t type)
     }
 
     res.data.erase(res.data.begin());
+    if (res.data.size() >= 4)
+    {
+        // P2server_max in 1ms and P2*server_max in 10ms resolution
+        timing_.setServerTiming(std::chrono::milliseconds((res.data[0] << 8) | res.data[1]),
+                                std::chrono::milliseconds(((res.data[2] << 8) | res.data[3]) * 10));
+    }
     return res.data;
 }
 
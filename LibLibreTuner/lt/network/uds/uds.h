@@ -1,8 +1,12 @@
 #ifndef LT_UDS_H
 #define LT_UDS_H
 
+#include "udstiming.h"
+
+#include <chrono>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <vector>
 
 namespace lt
@@ -53,7 +57,7 @@ struct UdsPacket
     bool negative() const noexcept { return code == UDS_RES_NEGATIVE; }
     uint8_t negativeCode() const noexcept
     {
-        return data.size() > 1 ? 0 : data[1];
+        return data.size() > 1 ? data[1] : 0;
     }
 };
 
@@ -67,8 +71,16 @@ public:
        including RCRRP). */
     UdsPacket request(uint8_t sid, const uint8_t * data, size_t size);
 
+    /* Like request() but returns negative responses instead of throwing.
+       Idempotent services time out adaptively and are retried after a
+       timeout; the transport timeout is restored afterwards. Other
+       services, e.g. erasing or programming, keep the transport timeout.
+       Throws TimeoutError if every attempt timed out. */
+    UdsPacket query(uint8_t sid, const uint8_t * data, size_t size);
+
     /* All requests may throw an exception */
-    /* Sends a DiagnosticSessionControl request. Returns parameter record. */
+    /* Sends a DiagnosticSessionControl request. Returns parameter record.
+       Updates the server timing (P2/P2*) from the record. */
     std::vector<uint8_t> requestSession(uint8_t type);
 
     std::vector<uint8_t> requestSecuritySeed();
@@ -86,6 +98,25 @@ public:
     virtual UdsPacket requestRaw(const UdsPacket & packet) = 0;
 
     virtual UdsPacket receiveRaw() = 0;
+
+    // Sets the transport timeout for the next response
+    virtual void setTimeout(std::chrono::milliseconds /*timeout*/) {}
+
+    // Transport timeout, or empty if it cannot be changed
+    virtual std::optional<std::chrono::milliseconds> timeout() const { return std::nullopt; }
+
+    // Discards responses that have not been read
+    virtual void clearBuffer() {}
+
+    inline UdsTiming & timing() noexcept { return timing_; }
+    inline const UdsStats & stats() const noexcept { return stats_; }
+    inline void resetStats() noexcept { stats_ = UdsStats{}; }
+
+private:
+    UdsTiming timing_;
+    UdsStats stats_;
+    // A duplicate response to a retried request may still arrive
+    bool stale_{false};
 };
 using UdsPtr = std::unique_ptr<Uds>;
 
@@ -0,0 +1,94 @@
+#include "udstiming.h"
+
+#include <algorithm>
+
+namespace lt::network
+{
+
+void RttEstimator::sample(Duration rtt) noexcept
+{
+    if (!srtt_)
+    {
+        srtt_ = rtt;
+        rttvar_ = rtt / 2;
+        return;
+    }
+
+    // alpha = 1/8, beta = 1/4
+    Duration error = rtt > *srtt_ ? rtt - *srtt_ : *srtt_ - rtt;
+    rttvar_ = (rttvar_ * 3 + error) / 4;
+    srtt_ = (*srtt_ * 7 + rtt) / 8;
+}
+
+RttEstimator::Duration RttEstimator::rto(Duration fallback) const noexcept
+{
+    if (!srtt_)
+        return fallback;
+    return *srtt_ + rttvar_ * 4;
+}
+
+void UdsTiming::sample(uint8_t sid, std::chrono::microseconds rtt) noexcept
+{
+    services_[sid].sample(rtt);
+    all_.sample(rtt);
+}
+
+std::chrono::milliseconds UdsTiming::timeout(uint8_t sid, int attempt) const noexcept
+{
+    // Services that are not retried get a single try, so they never adapt
+    if (!retryable(sid))
+        return options_.maxTimeout;
+
+    std::chrono::microseconds initial = options_.initialTimeout;
+    if (p2_)
+    {
+        // The server promised to answer within P2; transport overhead is
+        // unknown until measured
+        initial = std::min(initial, std::max<std::chrono::microseconds>(*p2_ * 4, options_.minTimeout));
+    }
+
+    auto rto = std::chrono::ceil<std::chrono::milliseconds>(services_[sid].rto(all_.rto(initial)));
+    rto = std::max(rto, options_.minTimeout);
+    // Exponential backoff
+    rto *= 1 << std::clamp(attempt, 0, 8);
+    return std::min(rto, options_.maxTimeout);
+}
+
+std::chrono::milliseconds UdsTiming::pendingTimeout() const noexcept
+{
+    if (!p2Star_)
+        return options_.maxTimeout;
+    // P2* is measured at the server; leave room for the transport
+    auto rtt = std::chrono::ceil<std::chrono::milliseconds>(all_.rto(std::chrono::microseconds(0)));
+    return std::max(*p2Star_ + rtt, options_.minTimeout);
+}
+
+void UdsTiming::setServerTiming(std::chrono::milliseconds p2, std::chrono::milliseconds p2Star) noexcept
+{
+    p2_ = p2;
+    p2Star_ = p2Star;
+}
+
+bool UdsTiming::retryable(uint8_t sid) noexcept
+{
+    switch (sid)
+    {
+    case 0x01: // OBD-II services
+    case 0x02:
+    case 0x03:
+    case 0x06:
+    case 0x07:
+    case 0x09:
+    case 0x0A:
+    case 0x19: // ReadDTCInformation
+    case 0x22: // ReadDataByIdentifier
+    case 0x23: // ReadMemoryByAddress
+    case 0x24: // ReadScalingDataByIdentifier
+    case 0x3E: // TesterPresent
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace lt::network
@@ -0,0 +1,101 @@
+#ifndef LT_UDSTIMING_H
+#define LT_UDSTIMING_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace lt::network
+{
+
+/* Estimates a retransmission timeout from observed round-trip times like
+ * TCP (RFC 6298): a smoothed RTT plus four times its mean deviation. */
+class RttEstimator
+{
+public:
+    using Duration = std::chrono::microseconds;
+
+    void sample(Duration rtt) noexcept;
+
+    inline bool empty() const noexcept { return !srtt_; }
+    inline Duration srtt() const noexcept { return srtt_.value_or(Duration(0)); }
+    inline Duration rttvar() const noexcept { return rttvar_; }
+
+    // Returns `fallback` until the first sample
+    Duration rto(Duration fallback) const noexcept;
+
+private:
+    std::optional<Duration> srtt_;
+    Duration rttvar_{0};
+};
+
+struct UdsTimingOptions
+{
+    // Used before any round trip was measured
+    std::chrono::milliseconds initialTimeout{1000};
+    std::chrono::milliseconds minTimeout{100};
+    std::chrono::milliseconds maxTimeout{6000};
+    // Retries after a timeout, for idempotent services only. Each retry
+    // doubles the timeout.
+    int retries{2};
+};
+
+struct UdsStats
+{
+    uint64_t requests{0};
+    uint64_t retries{0};
+    uint64_t timeouts{0};
+    // Response pending (0x78) responses received
+    uint64_t pending{0};
+    uint64_t negative{0};
+
+    inline double retryRate() const noexcept
+    {
+        return requests == 0 ? 0.0 : static_cast<double>(retries) / static_cast<double>(requests);
+    }
+};
+
+/* Adaptive request timeouts for a UDS server. Round trips are tracked per
+ * service since reading memory takes much longer than tester present;
+ * services without samples fall back to the estimate over all services.
+ * Only retryable services adapt; others always get the maximum timeout. */
+class UdsTiming
+{
+public:
+    explicit UdsTiming(UdsTimingOptions options = UdsTimingOptions()) : options_(options) {}
+
+    // Records the round trip of a request that was answered without a
+    // retry or a pending response
+    void sample(uint8_t sid, std::chrono::microseconds rtt) noexcept;
+
+    // Timeout for the `attempt`th try (starting at 0) of a request
+    std::chrono::milliseconds timeout(uint8_t sid, int attempt = 0) const noexcept;
+
+    /* Timeout while waiting after a response pending (0x78). Uses P2*
+     * from the server when known. */
+    std::chrono::milliseconds pendingTimeout() const noexcept;
+
+    // Sets the server timing from a DiagnosticSessionControl response
+    void setServerTiming(std::chrono::milliseconds p2, std::chrono::milliseconds p2Star) noexcept;
+
+    inline std::optional<std::chrono::milliseconds> p2() const noexcept { return p2_; }
+    inline std::optional<std::chrono::milliseconds> p2Star() const noexcept { return p2Star_; }
+
+    inline const UdsTimingOptions & options() const noexcept { return options_; }
+    inline void setOptions(const UdsTimingOptions & options) noexcept { options_ = options; }
+
+    // Returns true if `sid` may be sent again after a timeout
+    static bool retryable(uint8_t sid) noexcept;
+
+private:
+    UdsTimingOptions options_;
+    std::array<RttEstimator, 256> services_;
+    RttEstimator all_;
+    std::optional<std::chrono::milliseconds> p2_;
+    std::optional<std::chrono::milliseconds> p2Star_;
+};
+
+} // namespace lt::network
+
+#endif // LT_UDSTIMING_H
@@ -0,0 +1,92 @@
+#include "mappedfile.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LT_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lt
+{
+namespace os
+{
+
+MappedFile::MappedFile(const std::filesystem::path & path)
+{
+#ifdef LT_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error("failed to open '" + path.string() + "'");
+
+    struct stat st;
+    if (::fstat(fd, &st) == -1)
+    {
+        ::close(fd);
+        throw std::runtime_error("failed to stat '" + path.string() + "'");
+    }
+
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ != 0)
+    {
+        void * map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("failed to map '" + path.string() + "'");
+        }
+        data_ = static_cast<const uint8_t *>(map);
+        mapped_ = true;
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open '" + path.string() + "'");
+
+    buffer_.resize(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char *>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile() { release(); }
+
+MappedFile::MappedFile(MappedFile && other) noexcept { *this = std::move(other); }
+
+MappedFile & MappedFile::operator=(MappedFile && other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    release();
+    // A moved vector keeps its storage, so data_ remains valid
+    buffer_ = std::move(other.buffer_);
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    mapped_ = std::exchange(other.mapped_, false);
+    return *this;
+}
+
+void MappedFile::release() noexcept
+{
+#ifdef LT_HAVE_MMAP
+    if (mapped_)
+        ::munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+    mapped_ = false;
+    data_ = nullptr;
+    size_ = 0;
+    buffer_.clear();
+}
+
+} // namespace os
+} // namespace lt
@@ -0,0 +1,46 @@
+#ifndef LT_MAPPEDFILE_H
+#define LT_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace lt
+{
+namespace os
+{
+
+/* Read-only view of a whole file. Memory mapped on POSIX systems; read
+ * into memory elsewhere. */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    // Maps the file. Throws an exception if it cannot be opened.
+    explicit MappedFile(const std::filesystem::path & path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile && other) noexcept;
+    MappedFile & operator=(MappedFile && other) noexcept;
+
+    inline const uint8_t * data() const noexcept { return data_; }
+    inline std::size_t size() const noexcept { return size_; }
+
+private:
+    const uint8_t * data_{nullptr};
+    std::size_t size_{0};
+    // True if data_ is a mapping that must be unmapped
+    bool mapped_{false};
+    // Backing storage when mapping is unavailable
+    std::vector<uint8_t> buffer_;
+
+    void release() noexcept;
+};
+
+} // namespace os
+} // namespace lt
+
+#endif // LT_MAPPEDFILE_H
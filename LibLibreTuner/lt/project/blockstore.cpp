@@ -0,0 +1,130 @@
+#include "blockstore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace lt
+{
+
+fs::path BlockStore::blockPath(const Digest & digest) const
+{
+    std::string hex = toHex(digest);
+    return path_ / hex.substr(0, 2) / hex.substr(2);
+}
+
+bool BlockStore::contains(const Digest & digest) const { return fs::exists(blockPath(digest)); }
+
+Digest BlockStore::put(const uint8_t * data, std::size_t size)
+{
+    Digest digest = Sha256::hash(data, size);
+    fs::path path = blockPath(digest);
+    if (fs::exists(path))
+        return digest;
+
+    fs::create_directories(path.parent_path());
+
+    // Write to a temporary file first so a crash never leaves a truncated
+    // block behind under a valid digest.
+    fs::path temp = path;
+    temp += ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("failed to open block file '" + temp.string() + "' for writing");
+        file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        if (!file)
+            throw std::runtime_error("failed to write block file '" + temp.string() + "'");
+    }
+    fs::rename(temp, path);
+    return digest;
+}
+
+void BlockStore::get(const Digest & digest, uint8_t * out, std::size_t size) const
+{
+    fs::path path = blockPath(digest);
+    std::ifstream file(path, std::ios::binary | std::ios::in | std::ios::ate);
+    if (!file.is_open())
+        throw std::runtime_error("missing block '" + toHex(digest) + "' in '" + path_.string() + "'");
+
+    if (static_cast<std::size_t>(file.tellg()) != size)
+        throw std::runtime_error("block '" + toHex(digest) + "' has an unexpected size");
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char *>(out), static_cast<std::streamsize>(size));
+
+    if (Sha256::hash(out, size) != digest)
+        throw std::runtime_error("block '" + toHex(digest) + "' is corrupt");
+}
+
+BlockDelta BlockStore::storeDelta(const Digest & baseDigest, const uint8_t * base, const uint8_t * data,
+                                  std::size_t size, uint32_t blockSize)
+{
+    if (blockSize == 0)
+        throw std::runtime_error("block size must be greater than zero");
+
+    BlockDelta delta;
+    delta.base = baseDigest;
+    delta.size = static_cast<uint32_t>(size);
+    delta.blockSize = blockSize;
+
+    for (std::size_t offset = 0; offset < size; offset += blockSize)
+    {
+        std::size_t length = std::min<std::size_t>(blockSize, size - offset);
+        if (std::memcmp(base + offset, data + offset, length) == 0)
+            continue;
+
+        delta.blocks.emplace_back(static_cast<uint32_t>(offset / blockSize), put(data + offset, length));
+    }
+    return delta;
+}
+
+void BlockStore::applyDelta(const BlockDelta & delta, uint8_t * data, std::size_t size) const
+{
+    if (delta.size != size)
+        throw std::runtime_error("delta size (" + std::to_string(delta.size) + ") does not match the base size (" +
+                                 std::to_string(size) + ")");
+    if (delta.blockSize == 0)
+        throw std::runtime_error("delta has an invalid block size");
+
+    for (const auto & [index, digest] : delta.blocks)
+    {
+        std::size_t offset = static_cast<std::size_t>(index) * delta.blockSize;
+        if (offset >= size)
+            throw std::runtime_error("delta block index " + std::to_string(index) + " is out of range");
+        get(digest, data + offset, std::min<std::size_t>(delta.blockSize, size - offset));
+    }
+}
+
+std::size_t BlockStore::prune(const std::vector<BlockDelta> & deltas)
+{
+    if (!fs::exists(path_))
+        return 0;
+
+    std::set<std::string> referenced;
+    for (const BlockDelta & delta : deltas)
+    {
+        for (const auto & block : delta.blocks)
+            referenced.emplace(toHex(block.second));
+    }
+
+    // Collect first; removing entries while iterating is unspecified
+    std::vector<fs::path> unreferenced;
+    for (const auto & entry : fs::recursive_directory_iterator(path_))
+    {
+        if (!entry.is_regular_file())
+            continue;
+        std::string hex = entry.path().parent_path().filename().string() + entry.path().filename().string();
+        if (referenced.find(hex) == referenced.end())
+            unreferenced.emplace_back(entry.path());
+    }
+
+    for (const fs::path & path : unreferenced)
+        fs::remove(path);
+    return unreferenced.size();
+}
+
+} // namespace lt
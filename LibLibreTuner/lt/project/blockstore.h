@@ -0,0 +1,74 @@
+#ifndef LT_BLOCKSTORE_H
+#define LT_BLOCKSTORE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../support/hash.h"
+
+namespace lt
+{
+
+/* Difference between a buffer and the base it was derived from. Only
+ * blocks that differ from the base are referenced; their contents live in
+ * a BlockStore. */
+struct BlockDelta
+{
+    // Digest of the base data the delta applies to
+    Digest base{};
+    // Size of the complete buffer
+    uint32_t size{0};
+    uint32_t blockSize{0};
+    // (block index, digest of block contents)
+    std::vector<std::pair<uint32_t, Digest>> blocks;
+
+    template <class Archive> void serialize(Archive & archive) { archive(base, size, blockSize, blocks); }
+};
+
+/* Content-addressed store of data blocks. Blocks are stored once per
+ * unique content as `path`/ab/cdef..., so identical blocks written by
+ * different tunes share a single file. */
+class BlockStore
+{
+public:
+    static constexpr uint32_t defaultBlockSize = 1024;
+
+    explicit BlockStore(std::filesystem::path path) : path_(std::move(path)) {}
+
+    inline const std::filesystem::path & path() const noexcept { return path_; }
+
+    // Stores a block and returns its digest. Does nothing if the block exists.
+    Digest put(const uint8_t * data, std::size_t size);
+
+    // Reads the block with `digest` into `out`. Throws an exception if the
+    // block is missing, has the wrong size, or does not match its digest.
+    void get(const Digest & digest, uint8_t * out, std::size_t size) const;
+
+    bool contains(const Digest & digest) const;
+
+    /* Stores the blocks of `data` that differ from `base` and returns a
+     * delta referencing them. Both buffers must be `size` bytes long. */
+    BlockDelta storeDelta(const Digest & baseDigest, const uint8_t * base, const uint8_t * data, std::size_t size,
+                          uint32_t blockSize = defaultBlockSize);
+
+    /* Applies a delta to `data`, which must contain a copy of the base
+     * the delta was made against. */
+    void applyDelta(const BlockDelta & delta, uint8_t * data, std::size_t size) const;
+
+    /* Removes every block not referenced by `deltas`. Returns the number of
+     * removed blocks. */
+    std::size_t prune(const std::vector<BlockDelta> & deltas);
+
+private:
+    std::filesystem::path path_;
+
+    std::filesystem::path blockPath(const Digest & digest) const;
+};
+using BlockStorePtr = std::shared_ptr<BlockStore>;
+
+} // namespace lt
+
+#endif // LT_BLOCKSTORE_H
@@ -2,12 +2,12 @@
 
 #include "project.h"
 
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 
-#include <cereal/archives/binary.hpp>
-#include <cereal/types/string.hpp>
-#include <cereal/types/vector.hpp>
+#include "projectfile.h"
+
 #include <nlohmann/json.hpp>
 
 namespace fs = std::filesystem;
@@ -18,20 +18,26 @@ namespace lt
 
 RomPtr Project::getRom(const std::string & filename)
 {
-    // Search the cache
-    if (auto it = cache_.find(filename); it != cache_.end())
     {
-        // Check if the pointer has expired
-        if (auto rom = it->second.lock())
+        std::lock_guard lock(cacheMutex_);
+        if (RomPtr rom = findRom(filename))
             return rom;
     }
 
-    std::ifstream file(romsDir_ / filename, std::ios::binary | std::ios::in);
-    if (!file.is_open())
+    RomPtr rom = readRom(filename);
+    if (!rom)
+        return rom;
+
+    std::lock_guard lock(cacheMutex_);
+    return cacheRom(filename, std::move(rom));
+}
+
+RomPtr Project::readRom(const std::string & filename) const
+{
+    if (!fs::is_regular_file(romsDir_ / filename))
         return RomPtr();
 
-    // Deserialize ROM with cereal
-    cereal::BinaryInputArchive archive(file);
+    ProjectFileReader archive(romsDir_ / filename, Rom::magic, Rom::fileVersion);
     Rom::MetaData meta;
     MemoryBuffer data;
     archive(meta, data);
@@ -47,97 +53,290 @@ RomPtr Project::getRom(const std::string & filename)
     rom->setPath(romsDir_ / filename);
     rom->setName(meta.name);
     rom->setData(std::move(data));
-    // Insert into cache
-    cache_.emplace(filename, rom);
     return rom;
 }
 
+RomPtr Project::findRom(const std::string & filename)
+{
+    // Cached ROMs are always in loadedRoms_, which is checked first so that
+    // ROMs evicted while in use elsewhere count as hits
+    auto it = loadedRoms_.find(filename);
+    RomPtr rom = it != loadedRoms_.end() ? it->second.lock() : RomPtr();
+    if (!rom)
+        return romCache_.get(filename); // Not cached either; counts the miss
+
+    if (romCache_.contains(filename))
+        return romCache_.get(filename);
+    romCache_.put(filename, rom, rom->size());
+    romCache_.countHit();
+    return rom;
+}
+
+RomPtr Project::cacheRom(const std::string & filename, RomPtr rom)
+{
+    // Keep the ROM loaded by another thread in the meantime
+    WeakRomPtr & loaded = loadedRoms_[filename];
+    if (RomPtr existing = loaded.lock())
+        rom = std::move(existing);
+    else
+        loaded = rom;
+    romCache_.put(filename, rom, rom->size());
+
+    std::erase_if(loadedRoms_, [](const auto & entry) { return entry.second.expired(); });
+    return rom;
+}
+
+TunePtr Project::findTune(const std::string & filename)
+{
+    // Tunes are only shared while in use. Keeping released tunes would
+    // hand discarded edits back on the next load.
+    if (auto it = loadedTunes_.find(filename); it != loadedTunes_.end())
+        return it->second.lock();
+    return TunePtr();
+}
+
+TunePtr Project::cacheTune(const std::string & filename, TunePtr tune)
+{
+    WeakTunePtr & loaded = loadedTunes_[filename];
+    if (TunePtr existing = loaded.lock())
+        tune = std::move(existing);
+    else
+        loaded = tune;
+
+    std::erase_if(loadedTunes_, [](const auto & entry) { return entry.second.expired(); });
+    return tune;
+}
+
+void Project::prefetchRom(const std::string & filename)
+{
+    prefetch({filename});
+}
+
+void Project::prefetch(std::vector<std::string> filenames)
+{
+    {
+        std::lock_guard lock(cacheMutex_);
+        std::erase_if(filenames, [this](const std::string & filename) { return romCache_.contains(filename); });
+    }
+    if (filenames.empty())
+        return;
+
+    JobPtr job = JobPool::global().run(
+        [this, filenames = std::move(filenames)](JobControl control) {
+            for (const std::string & filename : filenames)
+            {
+                if (control.canceled())
+                    return;
+
+                // Only fill free space; never evict recently used data for a guess
+                std::error_code ec;
+                auto size = fs::file_size(romsDir_ / filename, ec);
+                if (ec)
+                    continue;
+                {
+                    std::lock_guard lock(cacheMutex_);
+                    if (romCache_.contains(filename) || romCache_.stats().bytes + size > romCache_.budget())
+                        continue;
+                }
+
+                try
+                {
+                    if (RomPtr rom = readRom(filename))
+                    {
+                        std::lock_guard lock(cacheMutex_);
+                        cacheRom(filename, std::move(rom));
+                    }
+                }
+                catch (const std::exception &)
+                {
+                    // Reported when the ROM is opened
+                }
+            }
+        },
+        JobPriority::Background);
+
+    std::lock_guard lock(cacheMutex_);
+    std::erase_if(prefetchJobs_, [](const JobPtr & j) { return !j->running(); });
+    prefetchJobs_.emplace_back(std::move(job));
+}
+
+void Project::prefetchBases()
+{
+    std::vector<std::string> bases;
+    for (const auto & tune : index_.tunes())
+    {
+        if (!tune.base.empty() && std::find(bases.begin(), bases.end(), tune.base) == bases.end())
+            bases.emplace_back(tune.base);
+    }
+    prefetch(std::move(bases));
+}
+
+void Project::setCacheBudget(std::size_t bytes)
+{
+    std::lock_guard lock(cacheMutex_);
+    romCache_.setBudget(bytes);
+}
+
+CacheStats Project::romCacheStats() const
+{
+    std::lock_guard lock(cacheMutex_);
+    return romCache_.stats();
+}
+
 TunePtr Project::loadTune(const std::string & filename)
 {
-    // Search the cache
-    if (auto it = tuneCache_.find(filename); it != tuneCache_.end())
     {
-        // Check if the pointer has expired
-        if (auto tune = it->second.lock())
+        std::lock_guard lock(cacheMutex_);
+        if (TunePtr tune = findTune(filename))
             return tune;
     }
 
-    std::ifstream file(tunesDir_ / filename, std::ios::binary | std::ios::in);
-    if (!file.is_open())
+    if (!fs::is_regular_file(tunesDir_ / filename))
         return TunePtr();
 
-    cereal::BinaryInputArchive archive(file);
+    ProjectFileReader archive(tunesDir_ / filename, Tune::magic, Tune::fileVersion);
     Tune::MetaData meta;
-    MemoryBuffer data;
-    archive(meta, data);
+    archive(meta);
 
     RomPtr rom = getRom(meta.base);
     if (!rom)
         throw std::runtime_error("unable to find ROM with id '" +
                                  meta.base + "'");
 
+    // Version 1 tunes store the full data with no storage tag
+    Tune::Storage storage = Tune::Storage::Full;
+    if (meta.formatVersion >= 2)
+        archive(storage);
+
+    MemoryBuffer data;
+    switch (storage)
+    {
+    case Tune::Storage::Full:
+        archive(data);
+        break;
+    case Tune::Storage::Delta:
+    {
+        BlockDelta delta;
+        archive(delta);
+        if (delta.base != rom->digest())
+            throw std::runtime_error("tune '" + filename +
+                                     "' was created from a different revision of ROM '" +
+                                     meta.base + "'");
+        data = MemoryBuffer(rom->cbegin(), rom->cend());
+        blocks_->applyDelta(delta, data.data(), data.size());
+        break;
+    }
+    default:
+        throw std::runtime_error("tune '" + filename +
+                                 "' uses an unknown storage kind");
+    }
+
     auto tune = std::make_shared<Tune>(rom, std::move(data));
+    tune->setBlockStore(blocks_);
     tune->setPath(tunesDir_ / filename);
     tune->setName(meta.name);
-    tuneCache_.emplace(filename, tune);
-    return tune;
+
+    std::lock_guard lock(cacheMutex_);
+    return cacheTune(filename, std::move(tune));
 }
 
 const fs::path & Project::tunesDirectory() const noexcept { return tunesDir_; }
 
 const fs::path & Project::romsDirectory() const noexcept { return romsDir_; }
 
+const fs::path & Project::blocksDirectory() const noexcept
+{
+    return blocks_->path();
+}
+
 Project::Project(const fs::path& base, const Platforms & platforms)
     : path_(base), tunesDir_(base / "tunes"), romsDir_(base / "roms"),
-      platforms_(std::move(platforms))
+      blocks_(std::make_shared<BlockStore>(base / "blocks")),
+      platforms_(std::move(platforms)),
+      index_(base / index_filename, romsDir_, tunesDir_, enforceExtensions_)
 {
+    index_.load();
 }
 
-template <typename MetaData>
-std::vector<MetaData> getMetaData(fs::path & dir, bool requiresExtension,
-                                  const std::string & extension)
+Project::~Project()
 {
-    std::vector<MetaData> metadata;
-    for (const auto & entry : fs::directory_iterator(dir))
+    std::vector<JobPtr> jobs;
     {
-        if (!entry.is_regular_file() ||
-            (requiresExtension && entry.path().extension() != extension))
-            continue;
-
-        std::ifstream file(entry.path(), std::ios::binary | std::ios::in);
-        if (!file.is_open())
-            continue; // TODO: Log this
-
-        cereal::BinaryInputArchive ar(file);
-        MetaData md;
-        try
-        {
-            ar(md);
-        }
-        catch (const std::runtime_error & err)
-        {
-            // TODO: Log exception
-        }
-        md.path = entry.path();
-        metadata.emplace_back(std::move(md));
+        std::lock_guard lock(cacheMutex_);
+        jobs.swap(prefetchJobs_);
+    }
+    for (const JobPtr & job : jobs)
+    {
+        job->cancel();
+        job->wait();
     }
-    return metadata;
+    // Tunes saved over their old versions leave their old blocks behind
+    prunePendingBlocks();
 }
 
 std::vector<Rom::MetaData> Project::queryRoms()
 {
-    if (!fs::exists(romsDir_))
-        return std::vector<Rom::MetaData>();
-    return getMetaData<Rom::MetaData>(romsDir_, enforceExtensions_,
-                                      Rom::extension);
+    refreshRoms();
+    return index_.roms();
+}
+
+std::vector<Rom::MetaData> Project::queryRoms(const std::string & platform,
+                                              const std::string & model)
+{
+    refreshRoms();
+    return index_.roms(platform, model);
 }
 
 std::vector<Tune::MetaData> Project::queryTunes()
 {
-    if (!fs::exists(tunesDir_))
-        return std::vector<Tune::MetaData>();
-    return getMetaData<Tune::MetaData>(tunesDir_, enforceExtensions_,
-                                       Tune::extension);
+    refreshTunes();
+    return index_.tunes();
+}
+
+std::vector<Tune::MetaData> Project::queryTunes(const std::string & base)
+{
+    refreshTunes();
+    return index_.tunesOf(base);
+}
+
+IndexChanges Project::refreshRoms()
+{
+    IndexChanges changes = index_.refreshRoms();
+    saveIndex();
+    return changes;
+}
+
+IndexChanges Project::refreshTunes()
+{
+    IndexChanges changes = index_.refreshTunes();
+    saveIndex();
+    // Listed tunes are likely to be opened next
+    prefetchBases();
+    return changes;
+}
+
+void Project::saveIndex() noexcept
+{
+    try
+    {
+        index_.save();
+    }
+    catch (const std::exception & err)
+    {
+        // TODO: Log exception
+    }
+}
+
+void Project::prunePendingBlocks() noexcept
+{
+    try
+    {
+        pruneBlocks();
+    }
+    catch (const std::exception & err)
+    {
+        // Unreadable tunes keep every block; the next prune tries again
+    }
 }
 
 TunePtr Project::createTune(RomPtr base, const std::string & name)
@@ -145,6 +344,7 @@ TunePtr Project::createTune(RomPtr base, const std::string & name)
     assert(base);
 
     auto tune = std::make_shared<Tune>(std::move(base));
+    tune->setBlockStore(blocks_);
     tune->setName(name);
     tune->setPath(generateTunePath(name));
     // tunes_.emplace_back(tune);
@@ -156,6 +356,7 @@ void Project::makeDirectories()
     fs::create_directories(romsDirectory());
     fs::create_directories(tunesDirectory());
     fs::create_directories(logsDirectory());
+    fs::create_directories(blocksDirectory());
 }
 
 std::filesystem::path Project::logsDirectory() const noexcept
@@ -223,8 +424,40 @@ RomPtr Project::createRom(const std::string & name, lt::ModelPtr model)
     rom->setName(name);
     rom->setPath(generateRomPath(name));
 
-    cache_.emplace(rom->path().string(), rom);
-    return rom;
+    std::string filename = rom->path().filename().string();
+    std::lock_guard lock(cacheMutex_);
+    return cacheRom(filename, std::move(rom));
+}
+
+RomPtr Project::addRom(const std::string & name, ModelPtr model, MemoryBuffer && data)
+{
+    auto rom = std::make_shared<lt::Rom>(std::move(model));
+    rom->setName(name);
+    {
+        // Create the file before releasing the lock so no other ROM gets
+        // the same path
+        std::lock_guard lock(pathMutex_);
+        rom->setPath(generateRomPath(name));
+        std::ofstream reserve(rom->path(), std::ios::binary | std::ios::out);
+        if (!reserve.is_open())
+            throw std::runtime_error("failed to create ROM file '" + rom->path().string() + "'");
+    }
+    rom->setData(std::move(data));
+    try
+    {
+        rom->save();
+    }
+    catch (...)
+    {
+        // Release the reserved path
+        std::error_code ec;
+        std::filesystem::remove(rom->path(), ec);
+        throw;
+    }
+
+    std::string filename = rom->path().filename().string();
+    std::lock_guard lock(cacheMutex_);
+    return cacheRom(filename, std::move(rom));
 }
 
 RomPtr Project::importRom(const std::string & name,
@@ -260,14 +493,63 @@ RomPtr Project::importRom(const std::string & name,
 
 bool Project::deleteRom(const std::string & filename)
 {
-    cache_.erase(filename);
-    return fs::remove(romsDir_ / filename);
+    {
+        std::lock_guard lock(cacheMutex_);
+        romCache_.erase(filename);
+        loadedRoms_.erase(filename);
+    }
+    bool removed = fs::remove(romsDir_ / filename);
+    index_.updateRom(filename);
+    saveIndex();
+    return removed;
 }
 
 bool Project::deleteTune(const std::string & filename)
 {
-    tuneCache_.erase(filename);
-    return fs::remove(tunesDir_ / filename);
+    {
+        std::lock_guard lock(cacheMutex_);
+        loadedTunes_.erase(filename);
+    }
+    bool removed = fs::remove(tunesDir_ / filename);
+    index_.updateTune(filename);
+    saveIndex();
+    if (removed)
+        prunePendingBlocks();
+    return removed;
+}
+
+std::size_t Project::pruneBlocks()
+{
+    std::vector<BlockDelta> deltas;
+    if (fs::exists(tunesDir_))
+    {
+        for (const auto & entry : fs::directory_iterator(tunesDir_))
+        {
+            if (!entry.is_regular_file() ||
+                (enforceExtensions_ &&
+                 entry.path().extension() != Tune::extension))
+                continue;
+
+            // Any read failure propagates; pruning with an incomplete set
+            // of references would delete live blocks.
+            ProjectFileReader archive(entry.path(), Tune::magic,
+                                      Tune::fileVersion);
+            Tune::MetaData meta;
+            archive(meta);
+            if (meta.formatVersion < 2)
+                continue;
+
+            Tune::Storage storage;
+            archive(storage);
+            if (storage != Tune::Storage::Delta)
+                continue;
+
+            BlockDelta delta;
+            archive(delta);
+            deltas.emplace_back(std::move(delta));
+        }
+    }
+    return blocks_->prune(deltas);
 }
 
 } // namespace lt
@@ -2,7 +2,12 @@
 #define LIBRETUNER_PROJECT_H
 
 #include "../rom/rom.h"
+#include "../support/job.h"
+#include "../support/lrucache.h"
+#include "blockstore.h"
+#include "projectindex.h"
 #include <filesystem>
+#include <mutex>
 #include <string>
 
 namespace lt
@@ -11,15 +16,26 @@ class Project
 {
 public:
     /* Initializes base path for storage. Tunes and ROMs path are set to
-     * '`base`/tunes' and '`base`/roms' respectively. */
+     * '`base`/tunes' and '`base`/roms' respectively. Tune data blocks are
+     * stored in '`base`/blocks'. */
     Project(const std::filesystem::path& base, const Platforms & platforms);
 
-    /* Loads a ROM by filename. If the ROM is cached, it will be returned.
-     * Otherwise, the directory is searched and if the ROM cannot
+    // Waits for prefetching to stop
+    ~Project();
+
+    Project(const Project &) = delete;
+    Project & operator=(const Project &) = delete;
+
+    /* Loads a ROM by filename. If the ROM is cached or still in use, it will
+     * be returned. Otherwise, the directory is searched and if the ROM cannot
      * be found, RomPtr() is returned. If the ROM was found but deserialization
      * fails, throws an exception. */
     RomPtr getRom(const std::string & filename);
 
+    /* Loads a ROM into the cache in the background if it is not cached and
+     * fits the free part of the cache budget. */
+    void prefetchRom(const std::string & filename);
+
     /* Creates a new blank ROM from `name`. Sets path. */
     RomPtr createRom(const std::string & name,
                      lt::ModelPtr model = lt::ModelPtr());
@@ -28,10 +44,15 @@ public:
      * false if it could not be found or there is insufficient permission. */
     bool deleteRom(const std::string & filename);
 
-    /* Deletes tune by filename. Returns true if the tune was deleted or
-     * false if it could not be found or there is insufficient permission. */
+    /* Deletes tune by filename and prunes the blocks only it used. Returns
+     * true if the tune was deleted or false if it could not be found or
+     * there is insufficient permission. */
     bool deleteTune(const std::string & filename);
 
+    /* Creates a ROM from `data` and saves it under a new path generated
+     * from `name`. Safe to call from several threads. */
+    RomPtr addRom(const std::string & name, ModelPtr model, MemoryBuffer && data);
+
     /* Creates a new ROM from a file containing the raw ROM from an ECU.
      * Throws an exception if the file cannot be opened or the model
      * cannot be determined. */
@@ -44,18 +65,51 @@ public:
      * cannot be found. */
     TunePtr loadTune(const std::string & filename);
 
-    /* Searches all ROM files and extracts their metadata. Silently ignores
-     * invalid ROMs. This is an expensive operation that should not
-     * be called often. */
+    /* Returns the metadata of all ROM files. Only files added or changed
+     * since the last query are read; the rest comes from the project
+     * index. Invalid ROMs are returned with empty metadata. */
     std::vector<Rom::MetaData> queryRoms();
 
-    /* Searches all tune files and extracts their metadata. Silently ignores
-     * invalid tunes. This is an expensive operation that should not
-     * be called often. */
+    // Returns ROMs of `platform` and `model`. Empty strings match anything.
+    std::vector<Rom::MetaData> queryRoms(const std::string & platform,
+                                         const std::string & model);
+
+    /* Returns the metadata of all tune files. Only files added or changed
+     * since the last query are read. Invalid tunes are returned with empty
+     * metadata. */
     std::vector<Tune::MetaData> queryTunes();
 
+    // Returns tunes based on the ROM with file name `base`
+    std::vector<Tune::MetaData> queryTunes(const std::string & base);
+
+    /* Updates the index from the ROM or tune directory and returns the
+     * files that changed. Call when the directory changes. */
+    IndexChanges refreshRoms();
+    IndexChanges refreshTunes();
+
+    // Metadata index. Queries on it do not touch the disk.
+    inline const ProjectIndex & index() const noexcept { return index_; }
+
+    /* Sets the number of bytes of ROM data kept loaded after their last
+     * user releases them. Tunes are mutable and never cached; a tune is
+     * only shared while it is in use. */
+    void setCacheBudget(std::size_t bytes);
+
+    // Cache counters. ROMs in use elsewhere count as hits.
+    CacheStats romCacheStats() const;
+
+    static constexpr std::size_t defaultCacheBudget = 64 * 1024 * 1024;
+
     const std::filesystem::path & tunesDirectory() const noexcept;
     const std::filesystem::path & romsDirectory() const noexcept;
+    const std::filesystem::path & blocksDirectory() const noexcept;
+
+    /* Removes data blocks no longer referenced by any tune. Returns the
+     * number of removed blocks. Throws an exception if a tune cannot be
+     * read, as its blocks could otherwise be removed. Runs after a tune is
+     * deleted and when the project is closed; tunes must not be saved
+     * concurrently, as blocks are stored before the tune referencing them. */
+    std::size_t pruneBlocks();
 
     /* Creates a tune from the base calibration. Generates an
      * id based on the name. */
@@ -81,6 +135,7 @@ public:
     std::filesystem::path logsDirectory() const noexcept;
 
     static constexpr auto config_filename = "config.json";
+    static constexpr auto index_filename = "index.ltpi";
 
 private:
     // Project directory
@@ -89,15 +144,28 @@ private:
     std::filesystem::path tunesDir_;
     std::filesystem::path romsDir_;
 
-    // Caches loaded ROMs
-    std::unordered_map<std::string, WeakRomPtr> cache_;
-    std::unordered_map<std::string, WeakTunePtr> tuneCache_;
+    // Content-addressed store of tune data blocks shared by all tunes
+    BlockStorePtr blocks_;
+
+    // Recently used ROMs by filename
+    LruCache<std::string, RomPtr> romCache_{defaultCacheBudget};
+    // Loaded ROMs and tunes, so a file in use is not loaded twice
+    std::unordered_map<std::string, WeakRomPtr> loadedRoms_;
+    std::unordered_map<std::string, WeakTunePtr> loadedTunes_;
+    // Guards the caches, which prefetching fills from worker threads
+    mutable std::mutex cacheMutex_;
+    std::vector<JobPtr> prefetchJobs_;
+    // Serializes generating paths for new files
+    std::mutex pathMutex_;
     const Platforms & platforms_;
 
     /* If true, tunes and ROMs must have the proper extension
      * to be loaded. */
     bool enforceExtensions_{true};
 
+    // Cached ROM and tune metadata
+    ProjectIndex index_;
+
     std::string name_;
 
     // Logs
@@ -105,6 +173,32 @@ private:
     // Generates the next available id based on the name
     std::filesystem::path generateRomPath(std::string name);
     std::filesystem::path generateTunePath(std::string name);
+
+    // Reads a ROM without touching the caches
+    RomPtr readRom(const std::string & filename) const;
+
+    // Returns a cached or loaded ROM, or a tune still in use. Must hold
+    // cacheMutex_.
+    RomPtr findRom(const std::string & filename);
+    TunePtr findTune(const std::string & filename);
+
+    // Caches a ROM, or tracks a loaded tune. Returns the one already
+    // loaded, if any. Must hold cacheMutex_.
+    RomPtr cacheRom(const std::string & filename, RomPtr rom);
+    TunePtr cacheTune(const std::string & filename, TunePtr tune);
+
+    // Loads ROMs into the cache on the global JobPool
+    void prefetch(std::vector<std::string> filenames);
+
+    // Prefetches the bases of the tunes in the index
+    void prefetchBases();
+
+    // Persists the index. Failures are ignored as the index is rebuilt
+    // when missing.
+    void saveIndex() noexcept;
+
+    // Prunes blocks, keeping all of them if a tune cannot be read
+    void prunePendingBlocks() noexcept;
 };
 using ProjectPtr = std::shared_ptr<Project>;
 
@@ -0,0 +1,66 @@
+#ifndef LT_PROJECTFILE_H
+#define LT_PROJECTFILE_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+
+#include "../os/mappedfile.h"
+#include "../serialize/serialize.h"
+#include "../serialize/sources.h"
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/array.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/utility.hpp>
+#include <cereal/types/vector.hpp>
+
+namespace lt
+{
+
+/* Reads a ROM or tune file. Files starting with `magic` are read with
+ * lt::Deserializer straight from a mapping of the file; others were
+ * written with cereal by earlier versions. */
+class ProjectFileReader
+{
+public:
+    ProjectFileReader(const std::filesystem::path & path, const std::array<char, 4> & magic, std::uint32_t version)
+        : map_(path)
+    {
+        if (FileHeader::matches(map_.data(), map_.size(), magic))
+        {
+            FileHeader header;
+            native_.emplace(map_.data(), map_.size());
+            (*native_)(header);
+            if (header.version > version)
+                throw std::runtime_error("'" + path.string() + "' was written by a newer version");
+            return;
+        }
+
+        stream_.open(path, std::ios::binary | std::ios::in);
+        if (!stream_.is_open())
+            throw std::runtime_error("failed to open '" + path.string() + "'");
+        legacy_.emplace(stream_);
+    }
+
+    template <typename... T> void operator()(T &... values)
+    {
+        if (native_)
+            (*native_)(values...);
+        else
+            (*legacy_)(values...);
+    }
+
+private:
+    os::MappedFile map_;
+    std::optional<Deserializer<MemorySource>> native_;
+    std::ifstream stream_;
+    std::optional<cereal::BinaryInputArchive> legacy_;
+};
+
+} // namespace lt
+
+#endif // LT_PROJECTFILE_H
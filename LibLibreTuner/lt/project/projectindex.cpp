@@ -0,0 +1,239 @@
+#include "projectindex.h"
+
+#include <fstream>
+#include <system_error>
+#include <type_traits>
+#include <unordered_set>
+
+#include "../serialize/sinks.h"
+#include "projectfile.h"
+
+namespace fs = std::filesystem;
+
+namespace lt
+{
+
+namespace
+{
+template <typename MetaData> MetaData readMetaData(const fs::path & path, const std::array<char, 4> & magic,
+                                                   std::uint32_t version)
+{
+    MetaData md;
+    try
+    {
+        ProjectFileReader archive(path, magic, version);
+        archive(md);
+    }
+    catch (const std::exception &)
+    {
+        md = MetaData{};
+    }
+    return md;
+}
+} // namespace
+
+ProjectIndex::ProjectIndex(fs::path path, fs::path romsDir, fs::path tunesDir, bool enforceExtensions)
+    : path_(std::move(path)), enforceExtensions_(enforceExtensions),
+      roms_{std::move(romsDir), Rom::extension, Rom::magic, Rom::fileVersion, {}},
+      tunes_{std::move(tunesDir), Tune::extension, Tune::magic, Tune::fileVersion, {}}
+{
+}
+
+template <class Archive, typename MetaData>
+void ProjectIndex::saveEntries(Archive & archive, const Directory<MetaData> & dir)
+{
+    archive(static_cast<std::uint64_t>(dir.entries.size()));
+    for (const auto & [filename, entry] : dir.entries)
+    {
+        archive(filename, entry.mtime, entry.size, entry.meta);
+        // Set from the file's version when read, which the index does not keep
+        if constexpr (std::is_same_v<MetaData, Tune::MetaData>)
+            archive(entry.meta.formatVersion);
+    }
+}
+
+template <class Archive, typename MetaData>
+void ProjectIndex::loadEntries(Archive & archive, Directory<MetaData> & dir)
+{
+    std::uint64_t count;
+    archive(count);
+    if (count > archive.source().remaining())
+        throw std::runtime_error("corrupt project index");
+
+    for (std::uint64_t i = 0; i < count; ++i)
+    {
+        std::string filename;
+        Entry<MetaData> entry;
+        archive(filename, entry.mtime, entry.size, entry.meta);
+        if constexpr (std::is_same_v<MetaData, Tune::MetaData>)
+            archive(entry.meta.formatVersion);
+        dir.entries.emplace(std::move(filename), std::move(entry));
+    }
+}
+
+void ProjectIndex::load()
+{
+    roms_.entries.clear();
+    tunes_.entries.clear();
+    dirty_ = false;
+
+    if (!fs::is_regular_file(path_))
+        return;
+
+    try
+    {
+        os::MappedFile map(path_);
+        if (!FileHeader::matches(map.data(), map.size(), magic))
+            throw std::runtime_error("not a project index");
+
+        Deserializer<MemorySource> archive(map.data(), map.size());
+        FileHeader header;
+        archive(header);
+        if (header.version != fileVersion)
+            throw std::runtime_error("outdated project index");
+
+        loadEntries(archive, roms_);
+        loadEntries(archive, tunes_);
+    }
+    catch (const std::exception &)
+    {
+        // The index is only a cache; rebuild it
+        roms_.entries.clear();
+        tunes_.entries.clear();
+        dirty_ = true;
+    }
+}
+
+void ProjectIndex::save()
+{
+    if (!dirty_)
+        return;
+
+    // Replace the index in one step so a crash cannot leave it truncated
+    fs::path temp = path_;
+    temp += ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("failed to open project index '" + temp.string() + "' for writing");
+
+        Serializer<StreamSink> archive(file);
+        archive(FileHeader{magic, fileVersion});
+        saveEntries(archive, roms_);
+        saveEntries(archive, tunes_);
+    }
+    fs::rename(temp, path_);
+    dirty_ = false;
+}
+
+template <typename MetaData> IndexChanges ProjectIndex::refresh(Directory<MetaData> & dir)
+{
+    IndexChanges changes;
+    std::unordered_set<std::string> present;
+
+    std::error_code ec;
+    fs::directory_iterator it(dir.path, ec);
+    if (!ec)
+    {
+        for (const auto & file : it)
+        {
+            if (!file.is_regular_file(ec) ||
+                (enforceExtensions_ && file.path().extension() != dir.extension))
+                continue;
+
+            // The directory listing usually carries these; nothing is opened
+            auto mtime = static_cast<std::int64_t>(file.last_write_time(ec).time_since_epoch().count());
+            if (ec)
+                continue;
+            auto size = static_cast<std::uint64_t>(file.file_size(ec));
+            if (ec)
+                continue;
+
+            std::string filename = file.path().filename().string();
+            present.emplace(filename);
+
+            auto existing = dir.entries.find(filename);
+            if (existing != dir.entries.end() && existing->second.mtime == mtime &&
+                existing->second.size == size)
+                continue;
+
+            (existing == dir.entries.end() ? changes.added : changes.modified).emplace_back(file.path());
+            dir.entries[filename] =
+                Entry<MetaData>{mtime, size, readMetaData<MetaData>(file.path(), dir.magic, dir.version)};
+        }
+    }
+
+    for (auto entry = dir.entries.begin(); entry != dir.entries.end();)
+    {
+        if (present.count(entry->first) == 0)
+        {
+            changes.removed.emplace_back(dir.path / entry->first);
+            entry = dir.entries.erase(entry);
+        }
+        else
+            ++entry;
+    }
+
+    if (!changes.empty())
+        dirty_ = true;
+    return changes;
+}
+
+template <typename MetaData> void ProjectIndex::update(Directory<MetaData> & dir, const std::string & filename)
+{
+    fs::path path = dir.path / filename;
+    std::error_code ec;
+    auto mtime = fs::last_write_time(path, ec);
+    auto size = ec ? 0 : fs::file_size(path, ec);
+    if (ec)
+    {
+        if (dir.entries.erase(filename) != 0)
+            dirty_ = true;
+        return;
+    }
+
+    dir.entries[filename] = Entry<MetaData>{static_cast<std::int64_t>(mtime.time_since_epoch().count()),
+                                            static_cast<std::uint64_t>(size),
+                                            readMetaData<MetaData>(path, dir.magic, dir.version)};
+    dirty_ = true;
+}
+
+IndexChanges ProjectIndex::refreshRoms() { return refresh(roms_); }
+
+IndexChanges ProjectIndex::refreshTunes() { return refresh(tunes_); }
+
+void ProjectIndex::updateRom(const std::string & filename) { update(roms_, filename); }
+
+void ProjectIndex::updateTune(const std::string & filename) { update(tunes_, filename); }
+
+std::vector<Rom::MetaData> ProjectIndex::roms() const { return roms(std::string()); }
+
+std::vector<Rom::MetaData> ProjectIndex::roms(const std::string & platform, const std::string & model) const
+{
+    std::vector<Rom::MetaData> result;
+    for (const auto & [filename, entry] : roms_.entries)
+    {
+        if ((!platform.empty() && entry.meta.platform != platform) || (!model.empty() && entry.meta.model != model))
+            continue;
+        result.emplace_back(entry.meta);
+        result.back().path = roms_.path / filename;
+    }
+    return result;
+}
+
+std::vector<Tune::MetaData> ProjectIndex::tunes() const { return tunesOf(std::string()); }
+
+std::vector<Tune::MetaData> ProjectIndex::tunesOf(const std::string & base) const
+{
+    std::vector<Tune::MetaData> result;
+    for (const auto & [filename, entry] : tunes_.entries)
+    {
+        if (!base.empty() && entry.meta.base != base)
+            continue;
+        result.emplace_back(entry.meta);
+        result.back().path = tunes_.path / filename;
+    }
+    return result;
+}
+
+} // namespace lt
@@ -0,0 +1,104 @@
+#ifndef LT_PROJECTINDEX_H
+#define LT_PROJECTINDEX_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../rom/rom.h"
+
+namespace lt
+{
+
+// Files added, modified or removed by a refresh of a ProjectIndex
+struct IndexChanges
+{
+    std::vector<std::filesystem::path> added;
+    std::vector<std::filesystem::path> modified;
+    std::vector<std::filesystem::path> removed;
+
+    inline bool empty() const noexcept { return added.empty() && modified.empty() && removed.empty(); }
+};
+
+/* Cache of ROM and tune metadata keyed by file name, modification time and
+ * size. A refresh lists the directory and only reads files whose time or
+ * size changed, so queries never touch unchanged data files. The cache is
+ * persisted to `path` and is discarded if it cannot be read. */
+class ProjectIndex
+{
+public:
+    static constexpr std::array<char, 4> magic{'L', 'T', 'P', 'I'};
+    static constexpr std::uint32_t fileVersion = 1;
+
+    ProjectIndex(std::filesystem::path path, std::filesystem::path romsDir, std::filesystem::path tunesDir,
+                 bool enforceExtensions = true);
+
+    /* Loads the index file. A missing, outdated or corrupt file leaves the
+     * index empty; the next refresh rebuilds it. */
+    void load();
+
+    // Writes the index file if it changed. Throws if it cannot be written.
+    void save();
+
+    /* Brings the entries in line with the ROM or tune directory. Files whose
+     * metadata cannot be read are kept with empty metadata, as
+     * Project::queryRoms() always did, and are not read again until they
+     * change. */
+    IndexChanges refreshRoms();
+    IndexChanges refreshTunes();
+
+    // Updates or removes a single entry, e.g. after the file was saved or deleted
+    void updateRom(const std::string & filename);
+    void updateTune(const std::string & filename);
+
+    // Metadata of all entries, ordered by file name
+    std::vector<Rom::MetaData> roms() const;
+    std::vector<Tune::MetaData> tunes() const;
+
+    // ROMs of `platform` and `model`. Empty strings match anything.
+    std::vector<Rom::MetaData> roms(const std::string & platform, const std::string & model = std::string()) const;
+
+    // Tunes based on the ROM with file name `base`. An empty string matches anything.
+    std::vector<Tune::MetaData> tunesOf(const std::string & base) const;
+
+    inline const std::filesystem::path & path() const noexcept { return path_; }
+
+private:
+    template <typename MetaData> struct Entry
+    {
+        std::int64_t mtime{0};
+        std::uint64_t size{0};
+        MetaData meta;
+    };
+
+    template <typename MetaData> struct Directory
+    {
+        std::filesystem::path path;
+        const char * extension;
+        std::array<char, 4> magic;
+        std::uint32_t version;
+        // Sorted so listings are stable
+        std::map<std::string, Entry<MetaData>> entries;
+    };
+
+    std::filesystem::path path_;
+    bool enforceExtensions_;
+    // True if the entries differ from the index file
+    bool dirty_{false};
+
+    Directory<Rom::MetaData> roms_;
+    Directory<Tune::MetaData> tunes_;
+
+    template <typename MetaData> IndexChanges refresh(Directory<MetaData> & dir);
+    template <typename MetaData> void update(Directory<MetaData> & dir, const std::string & filename);
+
+    template <class Archive, typename MetaData> static void saveEntries(Archive & archive, const Directory<MetaData> & dir);
+    template <class Archive, typename MetaData> static void loadEntries(Archive & archive, Directory<MetaData> & dir);
+};
+
+} // namespace lt
+
+#endif // LT_PROJECTINDEX_H
@@ -0,0 +1,124 @@
+#include "romimport.h"
+
+#include <limits>
+#include <stdexcept>
+
+#include "../definition/model.h"
+#include "../os/mappedfile.h"
+#include "../support/parallel.h"
+
+namespace fs = std::filesystem;
+
+namespace lt
+{
+
+namespace
+{
+// Returns true if every checksum in range of the data matches its target
+bool checksumsValid(const Checksums & checksums, const uint8_t * data, std::size_t size)
+{
+    for (std::size_t i = 0; i < checksums.size(); ++i)
+    {
+        const Checksum & checksum = checksums[i];
+        if (static_cast<std::size_t>(checksum.offset()) + static_cast<std::size_t>(checksum.size()) > size)
+            return false;
+        if (checksum.compute(data, static_cast<int>(size), nullptr) != checksum.target())
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+RomImport::RomImport(ProjectPtr project, const Platforms & platforms, PlatformPtr platform)
+    : project_(std::move(project)), platforms_(platforms), platform_(std::move(platform))
+{
+}
+
+RomImport::~RomImport()
+{
+    if (job_)
+    {
+        job_->cancel();
+        job_->wait();
+    }
+}
+
+JobPtr RomImport::start(std::vector<fs::path> paths, std::string name, JobPool & pool)
+{
+    if (job_)
+        throw std::runtime_error("import already started");
+
+    paths_ = std::move(paths);
+    name_ = std::move(name);
+    results_.resize(paths_.size());
+
+    // The job is connected before it runs so no update is lost
+    job_ = std::make_shared<Job>();
+    jobProgress_ = job_->onProgress([this](double progress) { progressEvent_(progress); });
+    job_->runOn(pool, [this, &pool](JobControl control) {
+        try
+        {
+            // One file per task; files take long enough that stealing
+            // single files balances best
+            parallelFor(
+                pool, 0, paths_.size(), [this](std::size_t index) { importFile(index); }, 1, &control);
+        }
+        catch (...)
+        {
+            // Failed files are reported through their results
+        }
+        finishedEvent_();
+    });
+    return job_;
+}
+
+void RomImport::importFile(std::size_t index)
+{
+    ImportResult & result = results_[index];
+    result.source = paths_[index];
+
+    try
+    {
+        stageEvent_(index, ImportStage::Read);
+        os::MappedFile map(result.source);
+        const uint8_t * data = map.data();
+        const std::size_t size = map.size();
+        if (size == 0)
+            throw std::runtime_error("the file is empty");
+        if (size > static_cast<std::size_t>(std::numeric_limits<int>::max()))
+            throw std::runtime_error("the file is too large to be a ROM");
+
+        stageEvent_(index, ImportStage::Hash);
+        result.digest = Sha256::hash(data, size);
+        {
+            std::lock_guard lock(digestsMutex_);
+            auto [first, inserted] = digests_.emplace(result.digest, index);
+            if (!inserted)
+                result.duplicateOf = paths_[first->second];
+        }
+
+        if (result.duplicateOf.empty())
+        {
+            stageEvent_(index, ImportStage::Identify);
+            result.model = platform_ ? platform_->identify(data, size) : platforms_.identify(data, size);
+            if (!result.model)
+                throw std::runtime_error("failed to identify model from ROM data");
+
+            stageEvent_(index, ImportStage::Checksum);
+            result.checksumsValid = checksumsValid(result.model->checksums, data, size);
+
+            stageEvent_(index, ImportStage::Write);
+            std::string name = paths_.size() == 1 && !name_.empty() ? name_ : result.source.stem().string();
+            result.rom = project_->addRom(name, result.model, MemoryBuffer(data, data + size));
+        }
+    }
+    catch (const std::exception & err)
+    {
+        result.error = err.what();
+    }
+
+    stageEvent_(index, ImportStage::Done);
+    resultEvent_(result);
+}
+
+} // namespace lt
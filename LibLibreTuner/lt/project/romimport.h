@@ -0,0 +1,131 @@
+#ifndef LT_ROMIMPORT_H
+#define LT_ROMIMPORT_H
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../definition/platform.h"
+#include "../support/event.h"
+#include "../support/hash.h"
+#include "../support/job.h"
+#include "project.h"
+
+namespace lt
+{
+
+enum class ImportStage
+{
+    Read,
+    Hash,
+    Identify,
+    Checksum,
+    Write,
+    Done,
+};
+
+struct ImportResult
+{
+    // File the ROM was imported from
+    std::filesystem::path source;
+    // Saved ROM. Null if the import failed or the file is a duplicate.
+    RomPtr rom;
+    ModelPtr model;
+    Digest digest{};
+    // False if any checksum of the model does not match. The ROM is
+    // imported anyway.
+    bool checksumsValid{false};
+    // Set if another file of the import has the same contents and was
+    // imported instead
+    std::filesystem::path duplicateOf;
+    // Set if the import failed
+    std::string error;
+
+    inline bool ok() const noexcept { return error.empty(); }
+};
+
+/* Imports raw ROM dumps into a project. Every file is mapped, hashed,
+ * identified, has its checksums validated and is saved as a ROM. Files
+ * go through these stages in parallel on a JobPool, so a large import
+ * keeps every worker busy while the caller stays responsive. Events are
+ * dispatched from worker threads. */
+class RomImport
+{
+public:
+    using StageEvent = Event<std::size_t, ImportStage>;
+    using ResultEvent = Event<const ImportResult &>;
+    using FinishedEvent = Event<>;
+    using ProgressEvent = Event<double>;
+
+    /* `platform` restricts identification to one platform. If null, the
+     * models of all platforms are tried. */
+    RomImport(ProjectPtr project, const Platforms & platforms, PlatformPtr platform = PlatformPtr());
+
+    // Cancels the import and waits for it to stop
+    ~RomImport();
+
+    RomImport(const RomImport &) = delete;
+    RomImport & operator=(const RomImport &) = delete;
+
+    /* Starts importing `paths`. ROMs are named after the file names, or
+     * `name` if only one file is imported. The job reports progress and
+     * can be canceled. May be called once. */
+    JobPtr start(std::vector<std::filesystem::path> paths, std::string name = std::string(),
+                 JobPool & pool = JobPool::global());
+
+    // Returns the results, in the order of the paths. Call once finished.
+    inline const std::vector<ImportResult> & results() const noexcept { return results_; }
+
+    // Called when file `index` enters a stage
+    template <typename Func> StageEvent::ConnectionPtr onStage(Func && f) noexcept
+    {
+        return stageEvent_.connect(std::forward<Func>(f));
+    }
+
+    // Called when a file finished importing
+    template <typename Func> ResultEvent::ConnectionPtr onResult(Func && f) noexcept
+    {
+        return resultEvent_.connect(std::forward<Func>(f));
+    }
+
+    /* Called from worker threads with the progress of the import (0.0 -
+     * 1.0). Connect before start() to receive every update. */
+    template <typename Func> ProgressEvent::ConnectionPtr onProgress(Func && f) noexcept
+    {
+        return progressEvent_.connect(std::forward<Func>(f));
+    }
+
+    // Called when every file finished or the import was canceled
+    template <typename Func> FinishedEvent::ConnectionPtr onFinished(Func && f) noexcept
+    {
+        return finishedEvent_.connect(std::forward<Func>(f));
+    }
+
+private:
+    ProjectPtr project_;
+    const Platforms & platforms_;
+    PlatformPtr platform_;
+    JobPtr job_;
+
+    std::vector<std::filesystem::path> paths_;
+    std::string name_;
+    std::vector<ImportResult> results_;
+
+    // Index of the first file seen with each digest
+    std::mutex digestsMutex_;
+    std::map<Digest, std::size_t> digests_;
+
+    StageEvent stageEvent_;
+    ResultEvent resultEvent_;
+    FinishedEvent finishedEvent_;
+    ProgressEvent progressEvent_;
+    Event<double>::ConnectionPtr jobProgress_;
+
+    void importFile(std::size_t index);
+};
+
+} // namespace lt
+
+#endif // LT_ROMIMPORT_H
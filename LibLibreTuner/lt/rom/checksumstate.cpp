@@ -0,0 +1,175 @@
+#include "checksumstate.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace lt
+{
+
+ChecksumState::ChecksumState(const Checksums & checksums, MemoryBuffer & buffer)
+    : checksums_(checksums), buffer_(buffer), values_(checksums.size()), stale_(checksums.size(), true),
+      inRange_(checksums.size())
+{
+    for (std::size_t i = 0; i < count(); ++i)
+        inRange_[i] = checksums_[i].offset() + checksums_[i].size() <= buffer_.size();
+    validity_ = valid();
+    buffer_.setObserver(this);
+}
+
+ChecksumState::~ChecksumState() { buffer_.setObserver(nullptr); }
+
+uint32_t ChecksumState::compute(std::size_t index) const
+{
+    return checksums_[index].compute(buffer_.data(), buffer_.size(), nullptr);
+}
+
+bool ChecksumState::affects(std::size_t index, int offset, int size) const
+{
+    const Checksum & checksum = checksums_[index];
+    return inRange_[index] && !stale_[index] && offset < checksum.offset() + checksum.size() &&
+           offset + size > checksum.offset();
+}
+
+uint32_t ChecksumState::value(std::size_t index) const
+{
+    if (!inRange_[index])
+        return 0;
+    if (stale_[index])
+    {
+        values_[index] = compute(index);
+        stale_[index] = false;
+    }
+    return values_[index];
+}
+
+bool ChecksumState::valid(std::size_t index) const
+{
+    return inRange_[index] && value(index) == checksums_[index].target();
+}
+
+bool ChecksumState::valid() const
+{
+    for (std::size_t i = 0; i < count(); ++i)
+    {
+        if (!valid(i))
+            return false;
+    }
+    return true;
+}
+
+std::optional<bool> ChecksumState::knownValidity() const noexcept
+{
+    bool known = true;
+    for (std::size_t i = 0; i < count(); ++i)
+    {
+        if (!inRange_[i])
+            return false;
+        if (stale_[i])
+            known = false;
+        else if (values_[i] != checksums_[i].target())
+            return false;
+    }
+    if (!known)
+        return std::nullopt;
+    return true;
+}
+
+bool ChecksumState::refresh()
+{
+    bool valid = this->valid();
+    setValidity(valid);
+    return valid;
+}
+
+void ChecksumState::setValidity(std::optional<bool> validity)
+{
+    if (validity == validity_)
+        return;
+    validity_ = validity;
+    validityEvent_(validity);
+}
+
+bool ChecksumState::verify() const
+{
+    for (std::size_t i = 0; i < count(); ++i)
+    {
+        if (inRange_[i] && value(i) != compute(i))
+            return false;
+    }
+    return true;
+}
+
+void ChecksumState::beforeWrite(int offset, int size)
+{
+    for (std::size_t i = 0; i < count(); ++i)
+    {
+        const Checksum & checksum = checksums_[i];
+        if (!affects(i, offset, size))
+            continue;
+
+        if (checksum.additive())
+            values_[i] =
+                (values_[i] - checksum.partialSum(buffer_.data(), buffer_.size(), offset, size)) & checksum.mask();
+        else
+            stale_[i] = true;
+    }
+}
+
+void ChecksumState::afterWrite(int offset, int size)
+{
+    for (std::size_t i = 0; i < count(); ++i)
+    {
+        const Checksum & checksum = checksums_[i];
+        if (!checksum.additive() || !affects(i, offset, size))
+            continue;
+
+        values_[i] =
+            (values_[i] + checksum.partialSum(buffer_.data(), buffer_.size(), offset, size)) & checksum.mask();
+    }
+
+    setValidity(knownValidity());
+}
+
+void ChecksumState::correct(uint8_t * data, int size) const
+{
+    if (size != buffer_.size())
+        throw std::runtime_error("checksum correction data does not match the tune size");
+
+    // Running values of `data`, which diverge from values_ as corrections
+    // are written
+    std::vector<uint32_t> values(count());
+    for (std::size_t i = 0; i < count(); ++i)
+        values[i] = value(i);
+
+    std::vector<uint32_t> before(count());
+    for (std::size_t i = 0; i < count(); ++i)
+    {
+        const Checksum & checksum = checksums_[i];
+        auto [offset, length] = checksum.correctionRange();
+
+        // A correction may land inside the region of another checksum
+        for (std::size_t j = 0; j < count(); ++j)
+        {
+            if (j != i && checksums_[j].additive())
+                before[j] = checksums_[j].partialSum(data, size, offset, length);
+        }
+
+        if (checksum.additive())
+        {
+            assert(values[i] == checksum.compute(data, size, nullptr));
+            checksum.correctFrom(data, size, values[i]);
+        }
+        else
+            checksum.correct(data, size);
+        values[i] = checksum.target();
+
+        for (std::size_t j = 0; j < count(); ++j)
+        {
+            if (j != i && checksums_[j].additive())
+                values[j] = (values[j] + checksums_[j].partialSum(data, size, offset, length) - before[j]) &
+                            checksums_[j].mask();
+        }
+    }
+}
+
+} // namespace lt
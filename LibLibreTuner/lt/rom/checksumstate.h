@@ -0,0 +1,94 @@
+#ifndef LT_CHECKSUMSTATE_H
+#define LT_CHECKSUMSTATE_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "../buffer/memorybuffer.h"
+#include "../definition/checksum.h"
+#include "../support/event.h"
+
+namespace lt
+{
+
+/* Running checksum values of a buffer. While attached, the values are kept
+ * up to date as the buffer is written: additive checksums are adjusted in
+ * O(changed bytes), others are recomputed the next time they are needed.
+ * Writes never recompute a checksum, so validity can be unknown until
+ * refresh() or valid() is called. */
+class ChecksumState : public WriteObserver
+{
+public:
+    using ValidityEvent = Event<std::optional<bool>>;
+    using ValidityConnectionPtr = ValidityEvent::ConnectionPtr;
+
+    // Computes the initial values and attaches to `buffer`
+    ChecksumState(const Checksums & checksums, MemoryBuffer & buffer);
+    ~ChecksumState() override;
+
+    ChecksumState(const ChecksumState &) = delete;
+    ChecksumState & operator=(const ChecksumState &) = delete;
+
+    inline std::size_t count() const noexcept { return checksums_.size(); }
+
+    // Returns the current value of a checksum, or 0 if its region exceeds
+    // the buffer
+    uint32_t value(std::size_t index) const;
+
+    // Returns true if the checksum matches its target
+    bool valid(std::size_t index) const;
+
+    // Returns true if all checksums match their targets
+    bool valid() const;
+
+    /* Returns the validity without recomputing stale checksums: false if a
+     * current checksum does not match, empty if it depends on a stale one. */
+    std::optional<bool> knownValidity() const noexcept;
+
+    /* Recomputes stale checksums and notifies if the validity changed.
+     * Returns valid(). */
+    bool refresh();
+
+    /* Corrects the checksums of `data`, which must hold the same contents
+     * as the attached buffer. */
+    void correct(uint8_t * data, int size) const;
+
+    /* Recomputes every checksum from scratch and returns true if all
+     * running values agree. */
+    bool verify() const;
+
+    /* Called when the known validity changes. Empty means a stale checksum
+     * must be recomputed with refresh(); this is never done by the write. */
+    template <typename Func>
+    inline ValidityConnectionPtr onValidityChange(Func && func) noexcept
+    {
+        return validityEvent_.connect(std::forward<Func>(func));
+    }
+
+    void beforeWrite(int offset, int size) override;
+    void afterWrite(int offset, int size) override;
+
+private:
+    const Checksums & checksums_;
+    MemoryBuffer & buffer_;
+
+    mutable std::vector<uint32_t> values_;
+    // Non-additive checksums invalidated by a write
+    mutable std::vector<bool> stale_;
+    // False for checksums whose region exceeds the buffer. These are never
+    // valid and are not tracked.
+    std::vector<bool> inRange_;
+    std::optional<bool> validity_;
+
+    ValidityEvent validityEvent_;
+
+    uint32_t compute(std::size_t index) const;
+    // Returns true if a write to [offset, offset + size) affects checksum `index`
+    bool affects(std::size_t index, int offset, int size) const;
+    void setValidity(std::optional<bool> validity);
+};
+
+} // namespace lt
+
+#endif // LT_CHECKSUMSTATE_H
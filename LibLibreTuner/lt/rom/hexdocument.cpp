@@ -0,0 +1,131 @@
+#include "hexdocument.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lt
+{
+
+namespace
+{
+RegionIndex regionsOf(const Rom & rom)
+{
+    return rom.model() ? RegionIndex(*rom.model()) : RegionIndex();
+}
+} // namespace
+
+HexDocument::HexDocument(const TunePtr & tune)
+{
+    if (!tune)
+        return;
+
+    const RomPtr & base = tune->base();
+    const uint8_t * data = tune->size() == 0 ? nullptr : &*tune->cbegin();
+    *this = HexDocument(tune, data, tune->size(), base ? base->data() : nullptr,
+                        base ? static_cast<std::size_t>(base->size()) : 0,
+                        base ? regionsOf(*base) : RegionIndex());
+}
+
+HexDocument::HexDocument(const RomPtr & rom)
+{
+    if (!rom)
+        return;
+
+    *this = HexDocument(rom, rom->data(), static_cast<std::size_t>(rom->size()), nullptr, 0, regionsOf(*rom));
+}
+
+HexDocument::HexDocument(std::shared_ptr<const void> owner, const uint8_t * data, std::size_t size,
+                         const uint8_t * base, std::size_t baseSize, RegionIndex regions)
+    : owner_(std::move(owner)), data_(data), size_(size), base_(base), baseSize_(baseSize),
+      regions_(std::move(regions)), pageDiffs_(pageCount()), pageDiffed_(pageCount(), false)
+{
+}
+
+std::span<const uint8_t> HexDocument::page(std::size_t index) const
+{
+    if (index >= pageCount())
+        throw std::out_of_range("page " + std::to_string(index) + " out of range");
+    return read(index * pageSize, pageSize);
+}
+
+std::span<const uint8_t> HexDocument::read(std::size_t offset, std::size_t length) const
+{
+    if (offset >= size_)
+        return std::span<const uint8_t>();
+    return std::span<const uint8_t>(data_ + offset, std::min(length, size_ - offset));
+}
+
+const std::vector<ByteRange> & HexDocument::pageDiff(std::size_t index) const
+{
+    if (index >= pageCount())
+        throw std::out_of_range("page " + std::to_string(index) + " out of range");
+    if (pageDiffed_[index] || base_ == nullptr)
+        return pageDiffs_[index];
+
+    std::size_t begin = index * pageSize;
+    std::size_t end = std::min(size_, begin + pageSize);
+    std::size_t compared = std::clamp(baseSize_, begin, end);
+
+    std::vector<ByteRange> & ranges = pageDiffs_[index];
+    ranges = diffRanges(data_ + begin, base_ + begin, compared - begin, begin);
+    if (compared < end)
+    {
+        if (!ranges.empty() && ranges.back().end == compared)
+            ranges.back().end = end;
+        else
+            ranges.push_back(ByteRange{compared, end});
+    }
+    pageDiffed_[index] = true;
+    return ranges;
+}
+
+std::vector<ByteRange> HexDocument::diff(std::size_t begin, std::size_t end) const
+{
+    std::vector<ByteRange> result;
+    end = std::min(end, size_);
+    if (begin >= end || base_ == nullptr)
+        return result;
+
+    for (std::size_t index = begin / pageSize; index * pageSize < end; ++index)
+    {
+        for (const ByteRange & range : pageDiff(index))
+        {
+            if (range.end <= begin || range.begin >= end)
+                continue;
+
+            ByteRange clipped{std::max(range.begin, begin), std::min(range.end, end)};
+            // Ranges may continue across pages
+            if (!result.empty() && result.back().end == clipped.begin)
+                result.back().end = clipped.end;
+            else
+                result.push_back(clipped);
+        }
+    }
+    return result;
+}
+
+bool HexDocument::differs(std::size_t offset) const
+{
+    if (offset >= size_ || base_ == nullptr)
+        return false;
+
+    const std::vector<ByteRange> & ranges = pageDiff(offset / pageSize);
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), offset,
+                               [](std::size_t offset, const ByteRange & range) { return offset < range.end; });
+    return it != ranges.end() && it->begin <= offset;
+}
+
+void HexDocument::invalidate(std::size_t offset, std::size_t length)
+{
+    if (length == 0 || offset >= size_)
+        return;
+
+    std::size_t last = (std::min(size_, offset + length) - 1) / pageSize;
+    for (std::size_t index = offset / pageSize; index <= last; ++index)
+    {
+        pageDiffed_[index] = false;
+        pageDiffs_[index].clear();
+    }
+}
+
+} // namespace lt
@@ -0,0 +1,78 @@
+#ifndef LT_HEXDOCUMENT_H
+#define LT_HEXDOCUMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "../buffer/bufferdiff.h"
+#include "../definition/regionindex.h"
+#include "rom.h"
+
+namespace lt
+{
+
+/* Read-only document for hex views over ROM or tune data. The data is
+ * never copied; pages are spans into the buffer. Table and axis regions
+ * are indexed once, and differences against the base ROM are computed per
+ * page the first time the page is asked for, so opening and navigating a
+ * large image costs nothing up front. Not thread-safe. */
+class HexDocument
+{
+public:
+    static constexpr std::size_t pageSize = 4096;
+
+    HexDocument() = default;
+
+    // Document over the data of a tune, compared against its base ROM
+    explicit HexDocument(const TunePtr & tune);
+
+    // Document over the data of a ROM. Nothing differs.
+    explicit HexDocument(const RomPtr & rom);
+
+    /* Document over `size` bytes of `data`, compared against `baseSize`
+     * bytes of `base` if it is not null. `owner` keeps both alive. Bytes past
+     * the end of the base differ. */
+    HexDocument(std::shared_ptr<const void> owner, const uint8_t * data, std::size_t size, const uint8_t * base,
+                std::size_t baseSize, RegionIndex regions = RegionIndex());
+
+    inline std::size_t size() const noexcept { return size_; }
+    inline std::size_t pageCount() const noexcept { return (size_ + pageSize - 1) / pageSize; }
+    inline bool hasBase() const noexcept { return base_ != nullptr; }
+
+    inline const RegionIndex & regions() const noexcept { return regions_; }
+
+    // Returns page `index`. The last page may be short.
+    std::span<const uint8_t> page(std::size_t index) const;
+
+    // Returns up to `length` bytes at `offset`; fewer at the end of the data
+    std::span<const uint8_t> read(std::size_t offset, std::size_t length) const;
+
+    // Ranges of page `index` that differ from the base
+    const std::vector<ByteRange> & pageDiff(std::size_t index) const;
+
+    // Ranges overlapping [begin, end) that differ from the base, clipped to it
+    std::vector<ByteRange> diff(std::size_t begin, std::size_t end) const;
+
+    bool differs(std::size_t offset) const;
+
+    // Forgets the differences of the pages touching a range after it was written
+    void invalidate(std::size_t offset, std::size_t length);
+
+private:
+    std::shared_ptr<const void> owner_;
+    const uint8_t * data_{nullptr};
+    std::size_t size_{0};
+    const uint8_t * base_{nullptr};
+    std::size_t baseSize_{0};
+    RegionIndex regions_;
+
+    mutable std::vector<std::vector<ByteRange>> pageDiffs_;
+    mutable std::vector<bool> pageDiffed_;
+};
+
+} // namespace lt
+
+#endif // LT_HEXDOCUMENT_H
@@ -21,17 +21,50 @@
 
 #include "definition/platform.h"
 
-#include <cereal/archives/binary.hpp>
-#include <cereal/types/string.hpp>
-#include <cereal/types/vector.hpp>
+#include "serialize/serialize.h"
+#include "serialize/sinks.h"
 
 #include <cassert>
 #include <fstream>
+#include <optional>
 
 namespace fs = std::filesystem;
 
 namespace lt
 {
+namespace
+{
+/* Writes `path` through a temporary file renamed over it, so a failure or
+ * crash never leaves it truncated. */
+template <typename Func> void writeReplacing(const fs::path & path, const char * kind, Func && write)
+{
+    fs::path temp = path;
+    temp += ".tmp";
+    try
+    {
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::out | std::ios::trunc);
+            if (!file.is_open())
+                throw std::runtime_error(std::string("failed to open ") + kind + " file '" + temp.string() +
+                                         "' for writing");
+
+            Serializer<StreamSink> archive(file);
+            write(archive);
+            file.flush();
+            if (!file)
+                throw std::runtime_error(std::string("failed to write ") + kind + " file '" + temp.string() + "'");
+        }
+        fs::rename(temp, path);
+    }
+    catch (...)
+    {
+        std::error_code ec;
+        fs::remove(temp, ec);
+        throw;
+    }
+}
+} // namespace
+
 namespace detail
 {
 EntriesPtr<double> createEntries(Endianness endianness, DataType dataType, const View & view)
@@ -179,12 +212,20 @@ void Tune::save() const
     if (path_.empty())
         throw std::runtime_error("attempt to save ROM without a path");
 
-    std::ofstream file(path_, std::ios::binary | std::ios::out);
-    if (!file.is_open())
-        throw std::runtime_error("failed to open tune file '" + path_.string() + "' for writing");
-
-    cereal::BinaryOutputArchive archive(file);
-    archive(metadata(), data_);
+    // Store the blocks before touching the tune file, which must survive
+    // a failing block store
+    std::optional<BlockDelta> delta;
+    if (blocks_ && base_->size() == data_.size())
+        delta = blocks_->storeDelta(base_->digest(), base_->data(), data_.data(), data_.size());
+
+    MetaData md = metadata();
+    writeReplacing(path_, "tune", [&](Serializer<StreamSink> & archive) {
+        archive(FileHeader{magic, fileVersion}, md);
+        if (delta)
+            archive(Storage::Delta, *delta);
+        else
+            archive(Storage::Full, data_);
+    });
 }
 
 Tune::Tune(RomPtr rom) : Tune(rom, MemoryBuffer(rom->cbegin(), rom->cend())) {}
@@ -196,6 +237,17 @@ Tune::Tune(RomPtr rom, MemoryBuffer && data) : base_(std::move(rom)), data_(std:
     if (base_->size() != size())
         throw std::runtime_error("The base ROM and tune data size do not match (" + std::to_string(base_->size()) +
                                  " vs " + std::to_string(size()) + "). The tune or base ROM is corrupt.");
+
+    checksums_ = std::make_unique<ChecksumState>(base_->model()->checksums, data_);
+}
+
+void Tune::setBase(const RomPtr & rom)
+{
+    assert(rom);
+    base_ = rom;
+    // The checksums belong to the model, which may have changed
+    checksums_.reset();
+    checksums_ = std::make_unique<ChecksumState>(base_->model()->checksums, data_);
 }
 
 Rom::MetaData Rom::metadata() const noexcept
@@ -217,16 +269,10 @@ void Rom::save() const
     if (path_.empty())
         throw std::runtime_error("attempt to save ROM without a path");
 
-    std::ofstream file(path_, std::ios::binary | std::ios::out);
-    if (!file.is_open())
-        throw std::runtime_error("failed to open ROM file '" + path_.string() + "' for writing");
-
-    cereal::BinaryOutputArchive archive(file);
-    archive(metadata(), data_);
+    MetaData md = metadata();
+    writeReplacing(path_, "ROM", [&](Serializer<StreamSink> & archive) {
+        archive(FileHeader{magic, fileVersion}, md, data_);
+    });
 }
 
 } // namespace lt
-
-// Declare cereal versions out of scope
-CEREAL_CLASS_VERSION(lt::Rom::MetaData, 1)
-CEREAL_CLASS_VERSION(lt::Tune::MetaData, 1)
\ No newline at end of file
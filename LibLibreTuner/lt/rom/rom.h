@@ -19,6 +19,7 @@
 #ifndef ROM_H
 #define ROM_H
 
+#include <array>
 #include <filesystem>
 #include <memory>
 #include <string>
@@ -28,6 +29,9 @@
 #include "../definition/model.h"
 #include "../definition/platform.h"
 #include "../buffer/memorybuffer.h"
+#include "../project/blockstore.h"
+#include "../support/hash.h"
+#include "checksumstate.h"
 #include "table.h"
 
 namespace lt
@@ -37,8 +41,15 @@ class Rom
 {
 public:
     static constexpr auto extension = ".ltr";
+    // File header written by save(). Files without it were written with
+    // cereal.
+    static constexpr std::array<char, 4> magic{'L', 'T', 'R', 'M'};
+    static constexpr std::uint32_t fileVersion = 1;
 
-    explicit Rom(ModelPtr model = ModelPtr()) : model_(std::move(model)) {}
+    explicit Rom(ModelPtr model = ModelPtr())
+        : model_(std::move(model)), digest_(Sha256::hash(data_.data(), data_.size()))
+    {
+    }
 
     inline const std::string & name() const noexcept { return name_; }
     inline const ModelPtr & model() const noexcept { return model_; }
@@ -70,8 +81,12 @@ public:
         return data_.cend();
     }
 
-    // Sets the ROM data
-    void setData(MemoryBuffer && data) { data_ = std::move(data); }
+    // Sets the ROM data and computes its digest
+    void setData(MemoryBuffer && data)
+    {
+        data_ = std::move(data);
+        digest_ = Sha256::hash(data_.data(), data_.size());
+    }
     View view(int offset, int size) { return data_.view(offset, size); }
     View view() { return data_.view(); }
 
@@ -84,6 +99,8 @@ public:
         // Path is set after loading
         std::filesystem::path path;
 
+        static constexpr std::uint32_t serialVersion = 1;
+
         template <class Archive>
         void serialize(Archive & archive, std::uint32_t const /*version*/)
         {
@@ -94,6 +111,9 @@ public:
     // Constructs ROM metadata
     MetaData metadata() const noexcept;
 
+    // Returns the SHA-256 digest of the ROM data as of the last setData()
+    const Digest & digest() const noexcept { return digest_; }
+
     // Saves rom to `path_`
     void save() const;
 
@@ -104,6 +124,8 @@ private:
     std::filesystem::path path_;
 
     MemoryBuffer data_;
+    // Computed eagerly so that worker threads can share the ROM
+    Digest digest_;
 };
 using RomPtr = std::shared_ptr<Rom>;
 using WeakRomPtr = std::weak_ptr<Rom>;
@@ -117,10 +139,25 @@ public:
     using const_iterator = MemoryBuffer::const_iterator;
 
     static constexpr auto extension = ".ltt";
+    static constexpr std::array<char, 4> magic{'L', 'T', 'T', 'N'};
+    static constexpr std::uint32_t fileVersion = 1;
+
+    // Layout of the tune data following the metadata
+    enum class Storage : uint8_t
+    {
+        // Complete copy of the data
+        Full = 0,
+        // BlockDelta against the base ROM
+        Delta = 1,
+    };
 
     explicit Tune(RomPtr rom);
     explicit Tune(RomPtr rom, MemoryBuffer && data);
 
+    // The checksum state observes data_, so the tune cannot be relocated
+    Tune(const Tune &) = delete;
+    Tune & operator=(const Tune &) = delete;
+
     inline const std::string & name() const noexcept { return name_; }
     inline const RomPtr & base() const noexcept { return base_; }
     inline const std::filesystem::path & path() const noexcept { return path_; }
@@ -132,9 +169,14 @@ public:
     void clearDirty() noexcept;
 
     void setName(const std::string & name) { name_ = name; }
-    void setBase(const RomPtr & rom) { base_ = rom; }
+    void setBase(const RomPtr & rom);
     void setPath(std::filesystem::path path) { path_ = std::move(path); }
 
+    /* Sets the block store used by save(). If a store is set, only the
+     * blocks that differ from the base ROM are written. Otherwise, the
+     * full data is stored in the tune file. */
+    void setBlockStore(BlockStorePtr blocks) { blocks_ = std::move(blocks); }
+
     // Gets table by id. Returns nullptr if the table does not exist
     // If `create` is true and the table has not been initialized, creates
     // the table from the ROM data and definitions.
@@ -150,17 +192,38 @@ public:
         return base_->endianness();
     }
 
+    /* Running checksums of the tune data. Kept up to date as tables are
+     * edited, so validity can be checked without rescanning the data. */
+    inline ChecksumState & checksums() noexcept { return *checksums_; }
+    inline const ChecksumState & checksums() const noexcept { return *checksums_; }
+
+    // Returns true if all checksums of the tune data are valid
+    inline bool checksumsValid() const { return checksums_->valid(); }
+
+    // Called with (offset, size) after tune data was written, e.g. by a
+    // table edit
+    template <typename Func> MemoryBuffer::WriteEvent::ConnectionPtr onDataWritten(Func && func) noexcept
+    {
+        return data_.onWrite(std::forward<Func>(func));
+    }
+
     struct MetaData
     {
         std::string name;
         // Base ROM id
         std::string base;
         std::filesystem::path path;
+        // Version of the file format. Version 1 files always store the
+        // full data with no Storage tag.
+        std::uint32_t formatVersion{0};
+
+        static constexpr std::uint32_t serialVersion = 2;
 
         template <class Archive>
-        void serialize(Archive & archive, std::uint32_t const /*version*/)
+        void serialize(Archive & archive, std::uint32_t const version)
         {
             archive(name, base);
+            formatVersion = version;
         }
     };
 
@@ -183,10 +246,12 @@ private:
     TableMap tables_;
 
     MemoryBuffer data_;
+    std::unique_ptr<ChecksumState> checksums_;
 
     std::unordered_map<std::string, AxisPtr> axes_;
 
     std::filesystem::path path_;
+    BlockStorePtr blocks_;
 };
 using TunePtr = std::shared_ptr<Tune>;
 using WeakTunePtr = std::weak_ptr<Tune>;
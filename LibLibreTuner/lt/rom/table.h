@@ -1,11 +1,14 @@
 #ifndef LIBRETUNER_TABLE_H
 #define LIBRETUNER_TABLE_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <memory>
 #include <vector>
 
 #include "../buffer/view.h"
+#include "../support/event.h"
 #include "../support/types.h"
 #include "../support/util.hpp"
 #include "unit.h"
@@ -22,6 +25,13 @@ public:
     virtual void set(int index, PresentedType value) = 0;
     virtual int size() const noexcept = 0;
 
+    // Reads `count` entries starting at `index` into `out`
+    virtual void getRange(int index, int count, PresentedType * out) const
+    {
+        for (int i = 0; i < count; ++i)
+            out[i] = get(index + i);
+    }
+
     virtual ~Entries() = default;
 };
 
@@ -40,6 +50,23 @@ public:
     void set(int index, PresentedType value) { view_.set<T, endianness>(static_cast<T>(value), index * sizeof(T)); }
     int size() const noexcept { return view_.size() / sizeof(T); }
 
+    void getRange(int index, int count, PresentedType * out) const override
+    {
+        if (index < 0 || count < 0 || index + count > size())
+            throw std::runtime_error("entries range out of bounds");
+        if (count == 0)
+            return;
+
+        // Decode straight from the buffer rather than checking every entry
+        const uint8_t * data = &*view_.cbegin() + index * sizeof(T);
+        for (int i = 0; i < count; ++i)
+        {
+            T value;
+            std::memcpy(&value, data + i * sizeof(T), sizeof(T));
+            out[i] = static_cast<PresentedType>(endian::convert<T, endianness, endian::current>(value));
+        }
+    }
+
 private:
     View view_;
 };
@@ -169,11 +196,18 @@ template <typename T> struct Bounds
     bool within(T t) const noexcept { return t >= minimum && t <= maximum; }
 };
 
+// Rectangle of table cells
+struct CellRange
+{
+    int row, column, height, width;
+};
+
 template <typename PresentedType> class BasicTable
 {
 public:
     using AxisType = BasicAxis<PresentedType>;
     using AxisTypePtr = std::shared_ptr<AxisType>;
+    using ChangedEvent = Event<CellRange>;
 
     /* Creates a one-dimensional index from a two-dimensional point.
      * Calculated by multiplying the row and width and adding the
@@ -210,6 +244,28 @@ public:
         return unit_->convert(entry);
     }
 
+    /* Decodes `count` entries starting at the row-major index `first` into
+     * `out`. Handles scale and unit conversion. Throws an exception if the
+     * range is out-of-bounds. Much faster than calling get() per cell. */
+    void getRange(int first, int count, PresentedType * out) const
+    {
+        entries_->getRange(first, count, out);
+        present(out, count);
+    }
+
+    /* Same as getRange() for the base entries. Fills `out` with zeros if
+     * there are no base entries. */
+    void getBaseRange(int first, int count, PresentedType * out) const
+    {
+        if (!baseEntries_)
+        {
+            std::fill(out, out + count, PresentedType{});
+            return;
+        }
+        baseEntries_->getRange(first, count, out);
+        present(out, count);
+    }
+
     /* Resets cell to base cell if one exists. Returns true if cell was reset. */
     bool reset(int row, int column)
     {
@@ -218,6 +274,7 @@ public:
 
         int idx = index(row, column);
         entries_->set(idx, baseEntries_->get(idx));
+        changed_(CellRange{row, column, 1, 1});
         return true;
     }
 
@@ -230,8 +287,20 @@ public:
             entry = unit_->convert(entry);
         entries_->set(index(row, column), static_cast<PresentedType>(entry));
         dirty_ = true;
+        changed_(CellRange{row, column, 1, 1});
+    }
+
+    /* Called with the cells changed by set() and reset(), on the thread
+     * that changed them. */
+    template <typename Func> typename ChangedEvent::ConnectionPtr onChanged(Func && f) noexcept
+    {
+        return changed_.connect(std::forward<Func>(f));
     }
 
+    // Notifies listeners of a change made to the data without set()
+    void notifyChanged(CellRange range) const { changed_(range); }
+    void notifyChanged() const { changed_(CellRange{0, 0, height_, width_}); }
+
     // Getters
     inline const std::string & name() const noexcept { return name_; }
     inline const std::string & description() const noexcept { return description_; }
@@ -253,6 +322,9 @@ public:
     // Returns true if the value is within the entry bounds
     inline bool inBounds(PresentedType value) const noexcept { return bounds_.within(value); }
 
+    // Returns true if the table has base entries to compare against
+    inline bool hasBase() const noexcept { return static_cast<bool>(baseEntries_); }
+
     /* Returns true if the table contains a single cell
      * (width = height = 1) */
     inline bool isScalar() const noexcept { return width_ == 1 && height_ == 1; }
@@ -272,6 +344,18 @@ private:
     double scale_;
     bool dirty_{false};
     std::unique_ptr<UnitGroup> unit_;
+    ChangedEvent changed_;
+
+    // Applies scale and unit conversion to decoded entries
+    void present(PresentedType * values, int count) const
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            values[i] = static_cast<PresentedType>(values[i] * scale_);
+            if (unit_)
+                values[i] = unit_->convert(values[i]);
+        }
+    }
 
     BasicTable(std::string name, std::string description, Bounds<PresentedType> bounds,
                EntriesPtr<PresentedType> && entries, EntriesPtr<PresentedType> && baseEntries, int width, int height,
@@ -1 +0,0 @@
-#include "byteorder.h"
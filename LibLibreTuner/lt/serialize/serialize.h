@@ -1,122 +1,203 @@
 #ifndef LIBRETUNER_SERIALIZER_H
-#define LIBRETUNER_BYTEORDER_H
+#define LIBRETUNER_SERIALIZER_H
 
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
-#include "../support/types.h"
+#include "../support/endianness.h"
 
 namespace lt
 {
 
-// Arithmetic type serialization
-template <typename T, typename S,
-          typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-void save(S & s, T t)
+/* Binary serialization. Types are serialized through the same member
+ * functions cereal uses, `serialize(Archive &)` or, for versioned types,
+ * `serialize(Archive &, std::uint32_t version)`, so a type works with both.
+ * The version written for a versioned type is its `serialVersion` member,
+ * or 0. It is written before every instance.
+ *
+ * Arithmetic types and enums are stored in the archive byte order. Sizes
+ * are stored as uint64. Vectors and arrays of arithmetic types are copied
+ * in bulk, and only swapped if the archive and host byte orders differ. */
+namespace serial
 {
-    T swapped = endian::convert<T, endian::current, S::Endian>(t);
-    s.write(reinterpret_cast<const uint8_t *>(std::addressof(swapped)),
-            sizeof(T));
-}
+template <typename T, typename A, typename = void> struct HasSerialize : std::false_type
+{
+};
+template <typename T, typename A>
+struct HasSerialize<T, A, std::void_t<decltype(std::declval<T &>().serialize(std::declval<A &>()))>>
+    : std::true_type
+{
+};
 
-template <typename T, typename S, typename Allocator>
-void save(S & s, const std::vector<T, Allocator> & vec)
+template <typename T, typename A, typename = void> struct HasVersionedSerialize : std::false_type
 {
-    s(vec.size());
-    s.serialize(vec.data(), vec.size());
-}
+};
+template <typename T, typename A>
+struct HasVersionedSerialize<
+    T, A, std::void_t<decltype(std::declval<T &>().serialize(std::declval<A &>(), std::uint32_t{}))>>
+    : std::true_type
+{
+};
 
-template <typename A> void archive()
+template <typename T, typename = void> struct Version : std::integral_constant<std::uint32_t, 0>
 {
-    // Archive stub - never called
-}
+};
+template <typename T>
+struct Version<T, std::void_t<decltype(T::serialVersion)>> : std::integral_constant<std::uint32_t, T::serialVersion>
+{
+};
+
+// Types copied as raw bytes
+template <typename T> constexpr bool isBulk = std::is_arithmetic_v<T> || std::is_enum_v<T>;
 
-// Arithmetic type deserialization
-template <typename T, typename D,
-          typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-T load(D & d, T & t)
+template <typename T> struct IsVector : std::false_type
+{
+};
+template <typename T, typename A> struct IsVector<std::vector<T, A>> : std::true_type
 {
-    d.read(reinterpret_cast<const uint8_t *>(std::addressof(t)), sizeof(T));
-    t = endian::convert<T, D::Endian, endian::current>(t);
+};
+
+template <typename T> struct IsArray : std::false_type
+{
+};
+template <typename T, std::size_t N> struct IsArray<std::array<T, N>> : std::true_type
+{
+};
+
+template <typename T> struct IsPair : std::false_type
+{
+};
+template <typename A, typename B> struct IsPair<std::pair<A, B>> : std::true_type
+{
+};
+
+template <typename T> constexpr bool dependentFalse = false;
+
+template <typename T> inline T byteSwap(T value) noexcept
+{
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (std::size_t i = 0; i < sizeof(T) / 2; ++i)
+        std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
 }
 
-// Vector type deserialization
-template <typename T, typename D> void load(D & d, std::vector<T> & out)
+// True if values of T must be swapped between the host and `endianness`
+template <typename T, Endianness endianness>
+constexpr bool needsSwap = sizeof(T) > 1 && endianness != endian::current;
+} // namespace serial
+
+// Start of files written with Serializer
+struct FileHeader
 {
-    std::size_t size;
-    d(size);
-    if (size > D::MaxRead)
-    {
-        throw std::runtime_error("Size exceeded maximum read");
-    }
+    std::array<char, 4> magic{};
+    std::uint32_t version{0};
 
-    out.reserve(size);
-    for (std::size_t i = 0; i < size; ++i)
+    template <class Archive> void serialize(Archive & archive) { archive(magic, version); }
+
+    // Returns true if `data` starts with `magic`
+    static bool matches(const uint8_t * data, std::size_t size, const std::array<char, 4> & magic) noexcept
     {
-        T t;
-        d(t);
-        out.emplace_back(std::move(t));
+        return size >= 8 && std::memcmp(data, magic.data(), magic.size()) == 0;
     }
-}
+};
 
-template <typename Sink, Endianness endianness = Endianness::Little>
-class Serializer
+template <typename Sink, Endianness endianness = Endianness::Little> class Serializer
 {
 public:
     static constexpr Endianness Endian = endianness;
 
-    template <typename... Args>
-    Serializer(Args &&... args) : sink(std::forward<Args>(args)...)
-    {
-    }
+    template <typename... Args> explicit Serializer(Args &&... args) : sink_(std::forward<Args>(args)...) {}
 
-    // Serializer for types with external save()
-    template <typename T, typename = decltype(save(
-                              std::declval<Serializer<Sink, endianness> &>(),
-                              std::declval<T>()))>
-    inline void operator()(const T & t)
-    {
-        save(*this, t);
-    }
+    template <typename... T> inline void operator()(const T &... values) { (save(values), ...); }
 
-    // For types that expose an external archive()
-    template <typename T, typename = decltype(archive(
-                              std::declval<Serializer<Sink, endianness> &>(),
-                              std::declval<T>()))>
-    inline void archive(const T & t)
+    // Writes `count` values without a size
+    template <typename T> void writeSpan(const T * data, std::size_t count)
     {
-        archive(*this, t);
+        static_assert(serial::isBulk<T>, "only arithmetic types and enums can be written in bulk");
+        if constexpr (!serial::needsSwap<T, endianness>)
+        {
+            sink_.write(reinterpret_cast<const uint8_t *>(data), count * sizeof(T));
+        }
+        else
+        {
+            // Swap in chunks to keep the writes large
+            T chunk[256];
+            while (count > 0)
+            {
+                std::size_t n = std::min<std::size_t>(count, std::size(chunk));
+                for (std::size_t i = 0; i < n; ++i)
+                    chunk[i] = serial::byteSwap(data[i]);
+                sink_.write(reinterpret_cast<const uint8_t *>(chunk), n * sizeof(T));
+                data += n;
+                count -= n;
+            }
+        }
     }
 
-    // Generic array serialization
-    template <typename T> void serialize(const T * array, std::size_t length)
+    // Serialize raw bytes
+    inline void write(const uint8_t * d, std::size_t length) { sink_.write(d, length); }
+
+    inline Sink & sink() noexcept { return sink_; }
+
+private:
+    Sink sink_;
+
+    template <typename T> void save(const T & value)
     {
-        serialize(static_cast<uint32_t>(length));
-        std::for_each(array, &array[length],
-                      [this](const T & t) { serialize(t); });
+        if constexpr (serial::isBulk<T>)
+            writeSpan(&value, 1);
+        else if constexpr (std::is_same_v<T, std::string>)
+        {
+            saveSize(value.size());
+            write(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+        }
+        else if constexpr (serial::IsVector<T>::value)
+        {
+            saveSize(value.size());
+            saveRange(value.data(), value.size());
+        }
+        else if constexpr (serial::IsArray<T>::value)
+            saveRange(value.data(), value.size());
+        else if constexpr (serial::IsPair<T>::value)
+        {
+            save(value.first);
+            save(value.second);
+        }
+        else if constexpr (serial::HasVersionedSerialize<T, Serializer>::value)
+        {
+            constexpr std::uint32_t version = serial::Version<T>::value;
+            save(version);
+            // serialize() only reads when saving
+            const_cast<T &>(value).serialize(*this, version);
+        }
+        else if constexpr (serial::HasSerialize<T, Serializer>::value)
+            const_cast<T &>(value).serialize(*this);
+        else
+            static_assert(serial::dependentFalse<T>, "type cannot be serialized");
     }
 
-    // Serialize raw bytes
-    inline void write(const uint8_t * d, std::size_t length)
+    template <typename T> void saveRange(const T * data, std::size_t count)
     {
-        sink.write(d, length);
+        if constexpr (serial::isBulk<T>)
+            writeSpan(data, count);
+        else
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                save(data[i]);
+        }
     }
 
-private:
-    Sink sink;
-};
-
-template <class A, class T> struct has_external_load
-{
-    template <class AA, class TT>
-    static auto test(int)
-        -> decltype(archive(std::declval<AA &>(), std::declval<TT &>()),
-                    std::true_type());
-    static std::false_type test(...);
-
-    static const bool value =
-        std::is_same_v<decltype(test<A, T>(0)), std::true_type()>;
+    inline void saveSize(std::size_t size) { save(static_cast<std::uint64_t>(size)); }
 };
 
 template <typename Source, Endianness endianness = Endianness::Little,
@@ -127,39 +208,124 @@ public:
     static constexpr Endianness Endian = endianness;
     static constexpr std::size_t MaxRead = max_read;
 
-    template <typename... Args>
-    Deserializer(Args &&... args) : source(std::forward<Args>(args)...)
+    template <typename... Args> explicit Deserializer(Args &&... args) : source_(std::forward<Args>(args)...) {}
+
+    template <typename... T> inline void operator()(T &... values) { (load(values), ...); }
+
+    // Reads `count` values written by Serializer::writeSpan()
+    template <typename T> void readSpan(T * data, std::size_t count)
     {
+        static_assert(serial::isBulk<T>, "only arithmetic types and enums can be read in bulk");
+        source_.read(reinterpret_cast<uint8_t *>(data), count * sizeof(T));
+        if constexpr (serial::needsSwap<T, endianness>)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                data[i] = serial::byteSwap(data[i]);
+        }
     }
 
-    // Deserializer for types that define and external load()
-    template <typename T,
-              typename = decltype(
-                  load(std::declval<Deserializer<Source, endianness> &>(),
-                       std::declval<T>()))>
-    inline void operator()(T & t)
+    /* Returns `count` values pointing into the source without copying, for
+     * sources that hold their data in memory. Throws if the data is not
+     * aligned for T. */
+    template <typename T> std::span<const T> view(std::size_t count)
     {
-        load(*this, t);
+        static_assert(serial::isBulk<T> && !serial::needsSwap<T, endianness>,
+                      "only values in host byte order can be viewed");
+        const uint8_t * data = source_.view(count * sizeof(T));
+        if (reinterpret_cast<std::uintptr_t>(data) % alignof(T) != 0)
+            throw std::runtime_error("serialized data is not aligned");
+        return std::span<const T>(reinterpret_cast<const T *>(data), count);
     }
 
-    // For types that expose an external archive()
-    template <typename T,
-              typename = decltype(archive(
-                  std::declval<Deserializer<Source, endianness, max_read> &>(),
-                  std::declval<T &>()))>
-    inline void archive(T const & t)
+    // Reads a size written for a vector or string. Use with view().
+    std::size_t readSize(std::size_t elementSize = 1)
     {
-        archive(*this, t);
+        std::uint64_t size;
+        load(size);
+        if (size > max_read)
+            throw std::runtime_error("Size exceeded maximum read");
+        // Catch corrupt sizes before allocating
+        if constexpr (hasRemaining)
+        {
+            if (size > source_.remaining() / std::max<std::size_t>(elementSize, 1))
+                throw std::runtime_error("serialized size exceeds the remaining data");
+        }
+        return static_cast<std::size_t>(size);
     }
 
     // Read raw bytes
-    inline void read(uint8_t * d, std::size_t length)
-    {
-        source.read(d, length);
-    }
+    inline void read(uint8_t * d, std::size_t length) { source_.read(d, length); }
+
+    inline Source & source() noexcept { return source_; }
 
 private:
-    Source source;
+    Source source_;
+
+    template <typename S, typename = void> struct HasRemaining : std::false_type
+    {
+    };
+    template <typename S>
+    struct HasRemaining<S, std::void_t<decltype(std::declval<const S &>().remaining())>> : std::true_type
+    {
+    };
+    static constexpr bool hasRemaining = HasRemaining<Source>::value;
+
+    template <typename T> void load(T & value)
+    {
+        if constexpr (serial::isBulk<T>)
+            readSpan(&value, 1);
+        else if constexpr (std::is_same_v<T, std::string>)
+        {
+            value.resize(readSize());
+            read(reinterpret_cast<uint8_t *>(value.data()), value.size());
+        }
+        else if constexpr (serial::IsVector<T>::value)
+        {
+            using V = typename T::value_type;
+            std::size_t size = readSize(serial::isBulk<V> ? sizeof(V) : 1);
+            value.clear();
+            if constexpr (serial::isBulk<V>)
+            {
+                value.resize(size);
+                readSpan(value.data(), size);
+            }
+            else
+            {
+                value.reserve(size);
+                for (std::size_t i = 0; i < size; ++i)
+                {
+                    V element;
+                    load(element);
+                    value.emplace_back(std::move(element));
+                }
+            }
+        }
+        else if constexpr (serial::IsArray<T>::value)
+        {
+            if constexpr (serial::isBulk<typename T::value_type>)
+                readSpan(value.data(), value.size());
+            else
+            {
+                for (auto & element : value)
+                    load(element);
+            }
+        }
+        else if constexpr (serial::IsPair<T>::value)
+        {
+            load(value.first);
+            load(value.second);
+        }
+        else if constexpr (serial::HasVersionedSerialize<T, Deserializer>::value)
+        {
+            std::uint32_t version;
+            load(version);
+            value.serialize(*this, version);
+        }
+        else if constexpr (serial::HasSerialize<T, Deserializer>::value)
+            value.serialize(*this);
+        else
+            static_assert(serial::dependentFalse<T>, "type cannot be deserialized");
+    }
 };
 
 } // namespace lt
@@ -1,6 +1,9 @@
 #ifndef LT_SINKS_H
 #define LT_SINKS_H
 
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
 #include <vector>
 
 namespace lt
@@ -11,13 +14,26 @@ template <class Vector> class VectorSink
 public:
     VectorSink(Vector & vector) : vector_(vector) {}
 
-    void write(const uint8_t * d, int length)
+    void write(const uint8_t * d, std::size_t length) { vector_.insert(vector_.end(), d, d + length); }
+
+private:
+    Vector & vector_;
+};
+
+// Writes to a stream. Throws if the stream fails.
+class StreamSink
+{
+public:
+    StreamSink(std::ostream & stream) : stream_(stream) {}
+
+    void write(const uint8_t * d, std::size_t length)
     {
-        vector_.insert(vector_.end(), d, d + length);
+        if (!stream_.write(reinterpret_cast<const char *>(d), static_cast<std::streamsize>(length)))
+            throw std::runtime_error("failed to write to stream");
     }
 
 private:
-    Vector & vector_;
+    std::ostream & stream_;
 };
 
 } // namespace lt
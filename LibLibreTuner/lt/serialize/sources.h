@@ -2,34 +2,49 @@
 #define LT_SOURCES_H
 
 #include <cstdint>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace lt
 {
 
-template <class Vector> class VectorSource
+/* Reads from memory that outlives the source, such as a mapped file.
+ * Supports zero-copy views. */
+class MemorySource
 {
 public:
-    VectorSource(const Vector & vector) : vector_(vector), it_(vector_.begin())
-    {
-    }
+    MemorySource(const uint8_t * data, std::size_t size) : data_(data), end_(data + size) {}
+
+    void read(uint8_t * d, std::size_t length) { std::memcpy(d, view(length), length); }
 
-    void read(uint8_t * d, int length)
+    // Returns the next `length` bytes without copying and skips them
+    const uint8_t * view(std::size_t length)
     {
-        if (std::distance(it_, vector_.end()) < length)
+        if (remaining() < length)
         {
-            throw std::runtime_error("Cannot deserialize " +
-                                     std::to_string(length) +
-                                     " bytes from vector; reaches EOF");
+            throw std::runtime_error("Cannot deserialize " + std::to_string(length) + " bytes; reaches EOF");
         }
-        std::copy(it_, it_ + length, d);
-        std::advance(it_, length);
+        const uint8_t * d = data_;
+        data_ += length;
+        return d;
     }
 
+    inline std::size_t remaining() const noexcept { return static_cast<std::size_t>(end_ - data_); }
+
 private:
-    const Vector & vector_;
-    typename Vector::const_iterator it_;
+    const uint8_t * data_;
+    const uint8_t * end_;
+};
+
+template <class Vector> class VectorSource : public MemorySource
+{
+public:
+    VectorSource(const Vector & vector)
+        : MemorySource(reinterpret_cast<const uint8_t *>(vector.data()), vector.size() * sizeof(vector[0]))
+    {
+    }
 };
 
 } // namespace lt
@@ -19,8 +19,11 @@ void SessionScanner::scan(network::Uds & protocol, uint8_t minimum,
         uint8_t sessionByte = static_cast<uint8_t>(session);
         try
         {
-            network::UdsPacket res = protocol.requestRaw(
-                network::UdsPacket(network::UDS_REQ_SESSION, &sessionByte, 1));
+            // Unsupported sessions are answered with a negative response;
+            // silent ones time out adaptively instead of taking the full
+            // transport timeout
+            network::UdsPacket res =
+                protocol.query(network::UDS_REQ_SESSION, &sessionByte, 1);
             if (!res.negative())
             {
                 callSuccess(static_cast<uint8_t>(session));
@@ -0,0 +1,100 @@
+#ifndef LT_BOUNDEDQUEUE_H
+#define LT_BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace lt
+{
+
+/* Fixed-capacity lock-free queue for any number of producers and consumers
+ * (Vyukov's bounded MPMC queue). Each cell carries a sequence number that
+ * tells producers and consumers whose turn it is, so neither side ever
+ * blocks or takes a lock. `capacity` is rounded up to a power of two. */
+template <typename T> class BoundedQueue
+{
+public:
+    explicit BoundedQueue(std::size_t capacity)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (std::size_t i = 0; i < size; ++i)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue & operator=(const BoundedQueue &) = delete;
+
+    // Returns false if the queue is full
+    bool push(const T & value) noexcept
+    {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell * cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = tail_.load(std::memory_order_relaxed);
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false if the queue is empty
+    bool pop(T & value) noexcept
+    {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        Cell * cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = head_.load(std::memory_order_relaxed);
+        }
+        value = cell->value;
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline std::size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_{0};
+    // Separate cache lines so producers and consumers do not contend
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::atomic<std::size_t> head_{0};
+};
+
+} // namespace lt
+
+#endif // LT_BOUNDEDQUEUE_H
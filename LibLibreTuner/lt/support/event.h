@@ -1,95 +1,176 @@
 #ifndef LT_EVENT_H
 #define LT_EVENT_H
 
-#include <forward_list>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "smallfunction.h"
 
 namespace lt
 {
 
+// Runs a callback on another thread, e.g. by posting it to an event loop
+using EventExecutor = std::function<void(std::function<void()>)>;
+
 template <typename... Args> class EventState;
 
+// Subscriber shared by a connection and the subscriber lists containing it
+template <typename... Args> struct EventSlot
+{
+    SmallFunction<void(Args...)> callback;
+    std::atomic<bool> connected{true};
+};
+
+/* Handle of a connected callback. The callback is disconnected when the
+ * handle is destroyed. */
 template <typename... Args> class EventConnection
 {
 public:
-    using Func = std::function<void(Args...)>;
     using State = EventState<Args...>;
+    using Slot = EventSlot<Args...>;
 
-    template <typename F>
-    EventConnection(F && func, std::weak_ptr<State> && state)
-        : callback_(std::forward<F>(func)), state_(std::move(state))
+    EventConnection(std::shared_ptr<Slot> slot, std::weak_ptr<State> state)
+        : slot_(std::move(slot)), state_(std::move(state))
     {
     }
 
-    // Disconnects from the event
+    ~EventConnection() { disconnect(); }
+
+    EventConnection(const EventConnection &) = delete;
+    EventConnection & operator=(const EventConnection &) = delete;
+
+    /* Disconnects from the event. A dispatch already running on another
+     * thread may still call the callback once. */
     void disconnect() noexcept
     {
-        /*if (auto state = state_.lock()) {
-            state->disconnect(this);
-        };*/
+        if (!slot_->connected.exchange(false))
+            return;
+        if (auto state = state_.lock())
+            state->remove(slot_.get());
         state_.reset();
     }
 
-    template <typename... A> void operator()(A &&... args) const
-    {
-        callback_(std::forward<A>(args)...);
-    }
+    inline bool connected() const noexcept { return slot_->connected; }
+
+    template <typename... A> void operator()(A &&... args) const { slot_->callback(std::forward<A>(args)...); }
 
 private:
-    Func callback_;
+    std::shared_ptr<Slot> slot_;
     std::weak_ptr<State> state_;
 };
 
+/* Subscribers of an event. Dispatching reads an immutable subscriber list
+ * that connecting and disconnecting replace as a whole, so events can be
+ * dispatched from any thread without locking while others connect.
+ * Replaced lists are freed by the first writer that sees no dispatch in
+ * progress. */
 template <typename... Args> class EventState
 {
 public:
-    using Connection = EventConnection<Args...>;
+    using Slot = EventSlot<Args...>;
+    using SlotPtr = std::shared_ptr<Slot>;
+    using Slots = std::vector<SlotPtr>;
+
+    EventState() = default;
+    EventState(const EventState &) = delete;
+    EventState & operator=(const EventState &) = delete;
+
+    ~EventState()
+    {
+        delete slots_.load();
+        for (const Slots * slots : retired_)
+            delete slots;
+    }
 
     template <typename... A> void dispatch(A &&... args) const
     {
-        for (const std::weak_ptr<Connection> & connPtr : connections_)
+        // Registering as a reader before loading the list keeps it from
+        // being freed during dispatch
+        struct Reader
+        {
+            std::atomic<uint32_t> & readers;
+            explicit Reader(std::atomic<uint32_t> & r) : readers(r) { readers.fetch_add(1); }
+            ~Reader() { readers.fetch_sub(1, std::memory_order_release); }
+        } reader(readers_);
+
+        const Slots * slots = slots_.load();
+        if (slots == nullptr)
+            return;
+        for (const SlotPtr & slot : *slots)
         {
-            if (auto conn = connPtr.lock())
-            {
-                (*conn)(std::forward<A>(args)...);
-            }
+            if (slot->connected.load(std::memory_order_relaxed))
+                slot->callback(args...);
         }
     }
 
-    // Removes expired connections
-    void removeExpired() noexcept
+    // Adds a slot to the dispatch list
+    void add(SlotPtr slot)
     {
-        connections_.remove_if([](auto & conn) { return conn.expired(); });
+        std::lock_guard lock(writeMutex_);
+        const Slots * current = slots_.load(std::memory_order_relaxed);
+        auto next = current ? std::make_unique<Slots>(*current) : std::make_unique<Slots>();
+        next->emplace_back(std::move(slot));
+        replace(next.release());
     }
 
-    // Adds a connection to the dispatch list
-    void add(std::weak_ptr<Connection> conn) noexcept
+    // Removes a slot from the dispatch list
+    void remove(const Slot * slot) noexcept
     {
-        connections_.emplace_front(std::move(conn));
-    }
+        std::lock_guard lock(writeMutex_);
+        const Slots * current = slots_.load(std::memory_order_relaxed);
+        if (current == nullptr)
+            return;
 
-    // Disconnects a connection
-    void disconnect(Connection * connection) noexcept
-    {
-        connections_.remove_if([connection](auto & c) {
-            if (auto s = c.lock())
-            {
-                return s.get() == connection;
-            }
-            return true; // connection has expired
-        });
+        Slots * next = nullptr;
+        if (current->size() > 1)
+        {
+            next = new Slots;
+            next->reserve(current->size() - 1);
+            std::copy_if(current->begin(), current->end(), std::back_inserter(*next),
+                         [slot](const SlotPtr & s) { return s.get() != slot; });
+        }
+        replace(next);
     }
 
+    inline bool empty() const noexcept { return slots_.load(std::memory_order_relaxed) == nullptr; }
+
 private:
-    std::forward_list<std::weak_ptr<Connection>> connections_;
+    // Null if empty
+    std::atomic<const Slots *> slots_{nullptr};
+    // Dispatches in progress
+    mutable std::atomic<uint32_t> readers_{0};
+
+    // Serializes writers
+    std::mutex writeMutex_;
+    // Replaced lists that may still be in use
+    std::vector<const Slots *> retired_;
+
+    void replace(const Slots * next) noexcept
+    {
+        if (const Slots * old = slots_.exchange(next))
+            retired_.emplace_back(old);
+        // Readers registered after this load see the new list
+        if (readers_.load() != 0)
+            return;
+        for (const Slots * slots : retired_)
+            delete slots;
+        retired_.clear();
+    }
 };
 
 template <typename... Args> class Event
 {
 public:
     using State = EventState<Args...>;
-    using Connection = typename State::Connection;
+    using Slot = typename State::Slot;
+    using Connection = EventConnection<Args...>;
     using ConnectionPtr = std::shared_ptr<Connection>;
 
     Event() : state_(std::make_shared<State>()) {}
@@ -97,19 +178,41 @@ public:
     // Creates a new connection with a callback
     template <typename Func> ConnectionPtr connect(Func && f) noexcept
     {
-        ConnectionPtr conn =
-            std::make_shared<Connection>(std::forward<Func>(f), state_);
-        state_->add(conn);
-        return conn;
+        auto slot = std::make_shared<Slot>();
+        slot->callback = std::forward<Func>(f);
+        return attach(std::move(slot));
     }
 
-    template <typename... A> void operator()(A &&... args)
+    /* Creates a connection whose callback runs through `executor` instead
+     * of on the dispatching thread. Arguments are copied. */
+    template <typename Func> ConnectionPtr connect(Func && f, EventExecutor executor) noexcept
     {
-        state_->dispatch(std::forward<A>(args)...);
+        auto slot = std::make_shared<Slot>();
+        auto func = std::make_shared<std::decay_t<Func>>(std::forward<Func>(f));
+        slot->callback = [weak = std::weak_ptr<Slot>(slot), func, executor = std::move(executor)](Args... args) {
+            executor([weak, func, values = std::make_tuple(std::decay_t<Args>(args)...)]() mutable {
+                // Skip if disconnected while queued
+                auto slot = weak.lock();
+                if (slot && slot->connected)
+                    std::apply(*func, values);
+            });
+        };
+        return attach(std::move(slot));
     }
 
+    template <typename... A> void operator()(A &&... args) const { state_->dispatch(std::forward<A>(args)...); }
+
+    // Returns true if no callbacks are connected
+    inline bool empty() const noexcept { return state_->empty(); }
+
 private:
     std::shared_ptr<State> state_;
+
+    ConnectionPtr attach(std::shared_ptr<Slot> slot)
+    {
+        state_->add(slot);
+        return std::make_shared<Connection>(std::move(slot), state_);
+    }
 };
 
 } // namespace lt
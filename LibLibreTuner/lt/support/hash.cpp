@@ -0,0 +1,177 @@
+#include "hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace lt
+{
+
+namespace
+{
+constexpr std::array<uint32_t, 64> roundConstants = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+} // namespace
+
+void Sha256::reset() noexcept
+{
+    state_ = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    blockSize_ = 0;
+    length_ = 0;
+}
+
+void Sha256::transform(const uint8_t * block) noexcept
+{
+    std::array<uint32_t, 64> w;
+    for (int i = 0; i < 16; ++i)
+    {
+        w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) | (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+               (static_cast<uint32_t>(block[i * 4 + 2]) << 8) | static_cast<uint32_t>(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; ++i)
+    {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+
+    for (int i = 0; i < 64; ++i)
+    {
+        uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + roundConstants[i] + w[i];
+        uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+}
+
+void Sha256::update(const uint8_t * data, std::size_t size) noexcept
+{
+    length_ += size;
+
+    // Fill a partial block first
+    if (blockSize_ != 0)
+    {
+        std::size_t toCopy = std::min(size, block_.size() - blockSize_);
+        std::memcpy(block_.data() + blockSize_, data, toCopy);
+        blockSize_ += toCopy;
+        data += toCopy;
+        size -= toCopy;
+
+        if (blockSize_ != block_.size())
+            return;
+        transform(block_.data());
+        blockSize_ = 0;
+    }
+
+    // Hash whole blocks straight from the input
+    for (; size >= block_.size(); size -= block_.size(), data += block_.size())
+        transform(data);
+
+    // data may be null when size is 0
+    std::copy_n(data, size, block_.data());
+    blockSize_ = size;
+}
+
+Digest Sha256::finish() noexcept
+{
+    uint64_t bits = length_ * 8;
+
+    // Padding: a single 1 bit, zeros, then the 64-bit big endian length
+    block_[blockSize_++] = 0x80;
+    if (blockSize_ > 56)
+    {
+        std::fill(block_.begin() + blockSize_, block_.end(), 0);
+        transform(block_.data());
+        blockSize_ = 0;
+    }
+    std::fill(block_.begin() + blockSize_, block_.begin() + 56, 0);
+    for (int i = 0; i < 8; ++i)
+        block_[63 - i] = static_cast<uint8_t>(bits >> (i * 8));
+    transform(block_.data());
+
+    Digest digest;
+    for (int i = 0; i < 8; ++i)
+    {
+        digest[i * 4] = static_cast<uint8_t>(state_[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state_[i]);
+    }
+    return digest;
+}
+
+Digest Sha256::hash(const uint8_t * data, std::size_t size) noexcept
+{
+    Sha256 hasher;
+    hasher.update(data, size);
+    return hasher.finish();
+}
+
+std::string toHex(const Digest & digest)
+{
+    constexpr char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(digest.size() * 2);
+    for (uint8_t byte : digest)
+    {
+        hex += digits[byte >> 4];
+        hex += digits[byte & 0xF];
+    }
+    return hex;
+}
+
+Digest digestFromHex(const std::string & hex)
+{
+    if (hex.size() != Digest().size() * 2)
+        throw std::runtime_error("invalid digest length: " + hex);
+
+    auto nibble = [&hex](char c) -> uint8_t {
+        if (c >= '0' && c <= '9')
+            return static_cast<uint8_t>(c - '0');
+        if (c >= 'a' && c <= 'f')
+            return static_cast<uint8_t>(c - 'a' + 10);
+        if (c >= 'A' && c <= 'F')
+            return static_cast<uint8_t>(c - 'A' + 10);
+        throw std::runtime_error("invalid character in digest: " + hex);
+    };
+
+    Digest digest;
+    for (std::size_t i = 0; i < digest.size(); ++i)
+        digest[i] = static_cast<uint8_t>((nibble(hex[i * 2]) << 4) | nibble(hex[i * 2 + 1]));
+    return digest;
+}
+
+} // namespace lt
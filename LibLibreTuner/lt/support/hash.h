@@ -0,0 +1,51 @@
+#ifndef LT_HASH_H
+#define LT_HASH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lt
+{
+
+// SHA-256 digest
+using Digest = std::array<uint8_t, 32>;
+
+/* Incremental SHA-256. Used to address content (ROM data, tune blocks)
+ * where a collision would silently corrupt data. */
+class Sha256
+{
+public:
+    Sha256() { reset(); }
+
+    void reset() noexcept;
+
+    // Hashes `size` bytes of `data`
+    void update(const uint8_t * data, std::size_t size) noexcept;
+
+    // Finishes the hash and returns the digest. The hasher must be
+    // reset() before it can be used again.
+    Digest finish() noexcept;
+
+    // Hashes a single buffer
+    static Digest hash(const uint8_t * data, std::size_t size) noexcept;
+
+private:
+    std::array<uint32_t, 8> state_;
+    std::array<uint8_t, 64> block_;
+    std::size_t blockSize_{0};
+    uint64_t length_{0};
+
+    void transform(const uint8_t * block) noexcept;
+};
+
+// Returns the lowercase hexadecimal representation of a digest
+std::string toHex(const Digest & digest);
+
+// Parses a digest from a hexadecimal string. Throws if the string is invalid.
+Digest digestFromHex(const std::string & hex);
+
+} // namespace lt
+
+#endif // LT_HASH_H
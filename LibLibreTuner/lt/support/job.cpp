@@ -4,13 +4,192 @@
 
 #include "job.h"
 
+#include <algorithm>
+
 namespace lt
 {
 
+namespace
+{
+// Pool and worker index of the current thread
+thread_local const JobPool * workerPool = nullptr;
+thread_local int workerIndex = -1;
+} // namespace
+
+bool Job::canceled() const noexcept
+{
+    for (const Job * job = this; job != nullptr; job = job->parent_.get())
+    {
+        if (job->canceled_)
+            return true;
+    }
+    return false;
+}
+
+void Job::wait()
+{
+    std::unique_lock lock(mutex_);
+    finished_.wait(lock, [this]() { return !running_; });
+}
+
+void Job::addProgress(double delta) noexcept
+{
+    double progress = progress_.fetch_add(delta) + delta;
+    eventProgress_(progress);
+    if (parent_)
+        parent_->addProgress(delta * weight_);
+}
+
+void Job::finish(std::exception_ptr error) noexcept
+{
+    {
+        std::lock_guard lock(mutex_);
+        error_ = std::move(error);
+        running_ = false;
+    }
+    finished_.notify_all();
+}
+
 void JobControl::setProgress(double progress) noexcept
 {
-    job_->progress_ = progress;
+    double old = job_->progress_.exchange(progress);
     job_->eventProgress_(progress);
+    if (job_->parent_)
+        job_->parent_->addProgress((progress - old) * job_->weight_);
+}
+
+JobControl JobControl::subtask(double weight) const
+{
+    auto child = std::make_shared<Job>(job_->priority_);
+    child->parent_ = job_;
+    child->weight_ = weight;
+    return JobControl(std::move(child));
+}
+
+JobPool::JobPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 0; i < threads; ++i)
+        queues_.emplace_back(std::make_unique<TaskQueue>());
+    for (unsigned i = 0; i < threads; ++i)
+        workers_.emplace_back([this, i]() { work(static_cast<int>(i)); });
+}
+
+JobPool::~JobPool()
+{
+    {
+        std::lock_guard lock(sleepMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread & worker : workers_)
+        worker.join();
+}
+
+JobPool & JobPool::global()
+{
+    static JobPool pool;
+    return pool;
+}
+
+int JobPool::currentWorker() const noexcept
+{
+    return workerPool == this ? workerIndex : -1;
+}
+
+void JobPool::submit(Task task, JobPriority priority)
+{
+    int worker = currentWorker();
+    TaskQueue & queue = worker >= 0 ? *queues_[worker] : shared_;
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.tasks[static_cast<int>(priority)].emplace_back(std::move(task));
+    }
+    queued_.fetch_add(1);
+
+    // A worker going to sleep either sees the task or is woken. Locking the
+    // mutex waits for it to start waiting.
+    if (sleeping_.load() != 0)
+    {
+        {
+            std::lock_guard lock(sleepMutex_);
+        }
+        wake_.notify_one();
+    }
+}
+
+bool JobPool::pop(int worker, Task & task)
+{
+    auto take = [&task](TaskQueue & queue, int priority, bool back) {
+        std::lock_guard lock(queue.mutex);
+        std::deque<Task> & tasks = queue.tasks[priority];
+        if (tasks.empty())
+            return false;
+        if (back)
+        {
+            task = std::move(tasks.back());
+            tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        return true;
+    };
+
+    const int count = static_cast<int>(queues_.size());
+    for (int priority = 0; priority < 2; ++priority)
+    {
+        // Newest own task first; it is most likely still in cache
+        if (worker >= 0 && take(*queues_[worker], priority, true))
+            return true;
+        if (take(shared_, priority, false))
+            return true;
+        // Steal the oldest task of another worker, which tends to be the
+        // largest piece of work left
+        for (int i = 1; i <= count; ++i)
+        {
+            int victim = (std::max(worker, 0) + i) % count;
+            if (victim != worker && take(*queues_[victim], priority, false))
+                return true;
+        }
+    }
+    return false;
+}
+
+void JobPool::work(int worker)
+{
+    workerPool = this;
+    workerIndex = worker;
+
+    Task task;
+    while (true)
+    {
+        if (pop(worker, task))
+        {
+            queued_.fetch_sub(1);
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                // Tasks report their own errors
+            }
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex_);
+        if (stopping_ && queued_.load() == 0)
+            return;
+        sleeping_.fetch_add(1);
+        wake_.wait(lock, [this]() { return stopping_ || queued_.load() != 0; });
+        sleeping_.fetch_sub(1);
+    }
 }
 
-} // namespace lt
\ No newline at end of file
+} // namespace lt
@@ -1,7 +1,14 @@
 #ifndef LT_JOB_H
 #define LT_JOB_H
 
-#include <future>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 
@@ -11,15 +18,39 @@ namespace lt
 {
 
 class JobControl;
+class JobPool;
+
+// Interactive tasks run before any queued background task
+enum class JobPriority
+{
+    Interactive,
+    Background,
+};
 
 class Job : public std::enable_shared_from_this<Job>
 {
 public:
     friend JobControl;
 
+    Job() = default;
+    explicit Job(JobPriority priority) : priority_(priority) {}
+
+    /* Runs `f(JobControl, args...)` on the global pool. Throws if the job
+     * is already running. */
     template <typename F, class... Args> void run(F && f, Args &&... args);
 
+    // Runs on `pool` instead of the global pool
+    template <typename F, class... Args> void runOn(JobPool & pool, F && f, Args &&... args);
+
     inline bool running() const noexcept { return running_; }
+    inline JobPriority priority() const noexcept { return priority_; }
+
+    // Blocks until the job finishes
+    void wait();
+
+    /* Exception that ended the last run, or null if it returned normally.
+     * Read after wait(). */
+    inline std::exception_ptr error() const noexcept { return error_; }
 
     inline void cancel() noexcept
     {
@@ -27,6 +58,9 @@ public:
         eventCanceled_();
     }
 
+    // True if the job or any parent was canceled
+    bool canceled() const noexcept;
+
     template <typename F> Event<>::ConnectionPtr onCanceled(F && f) noexcept
     {
         return eventCanceled_.connect(std::forward<F>(f));
@@ -43,13 +77,25 @@ public:
     inline double progress() const noexcept { return progress_; }
 
 private:
-    std::thread thread_;
+    JobPriority priority_{JobPriority::Background};
     std::atomic<bool> running_{false};
     std::atomic<bool> canceled_{false};
     Event<> eventCanceled_;
     Event<double> eventProgress_;
 
-    double progress_{0};
+    std::atomic<double> progress_{0};
+
+    // Subtasks add `weight_` times their progress to the parent
+    std::shared_ptr<Job> parent_;
+    double weight_{0};
+
+    std::mutex mutex_;
+    std::condition_variable finished_;
+    // Set by finish() under mutex_
+    std::exception_ptr error_;
+
+    void addProgress(double delta) noexcept;
+    void finish(std::exception_ptr error = nullptr) noexcept;
 };
 
 using JobPtr = std::shared_ptr<Job>;
@@ -61,34 +107,107 @@ public:
 
     JobControl(const JobControl &) = delete;
     JobControl & operator=(const JobControl &) = delete;
+    JobControl(JobControl &&) = default;
 
-    inline bool canceled() const noexcept { return job_->canceled_; }
+    inline bool canceled() const noexcept { return job_->canceled(); }
 
     void setProgress(double progress) noexcept;
 
+    /* Creates a control for a part of this job worth `weight` of its
+     * progress (0.0 - 1.0). Subtasks may report progress concurrently and
+     * are canceled with the job. */
+    JobControl subtask(double weight) const;
+
+    inline const JobPtr & job() const noexcept { return job_; }
+
 private:
     JobPtr job_;
 };
 
+/* Work-stealing thread pool. Every worker owns a deque per priority; tasks
+ * submitted from a worker are pushed to its own deque and popped LIFO,
+ * idle workers steal the oldest task from other workers. Tasks submitted
+ * from other threads go to a shared queue. */
 class JobPool
 {
 public:
+    using Task = std::function<void()>;
+
+    // Starts `threads` workers, or one per hardware thread if zero
+    explicit JobPool(unsigned threads = 0);
+    // Finishes queued tasks and stops the workers
+    ~JobPool();
+
+    JobPool(const JobPool &) = delete;
+    JobPool & operator=(const JobPool &) = delete;
+
+    // Pool shared by the library
+    static JobPool & global();
+
+    void submit(Task task, JobPriority priority = JobPriority::Background);
+
+    // Creates a job running `f(JobControl)` on this pool
+    template <typename F> JobPtr run(F && f, JobPriority priority = JobPriority::Background)
+    {
+        auto job = std::make_shared<Job>(priority);
+        job->runOn(*this, std::forward<F>(f));
+        return job;
+    }
+
+    inline unsigned size() const noexcept { return static_cast<unsigned>(workers_.size()); }
+
 private:
-    std::vector<JobPtr> jobs_;
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks[2];
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    // Tasks submitted from outside the pool
+    TaskQueue shared_;
+    std::vector<std::thread> workers_;
+
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    std::atomic<std::size_t> queued_{0};
+    std::atomic<unsigned> sleeping_{0};
+    bool stopping_{false};
+
+    // Index of the worker of this pool running on this thread, or -1
+    int currentWorker() const noexcept;
+
+    bool pop(int worker, Task & task);
+    void work(int worker);
 };
 
 template <typename F, class... Args> void Job::run(F && f, Args &&... args)
 {
-    if (running_)
+    runOn(JobPool::global(), std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template <typename F, class... Args> void Job::runOn(JobPool & pool, F && f, Args &&... args)
+{
+    if (running_.exchange(true))
     {
         throw std::runtime_error("run() called on active job");
     }
-    std::packaged_task task(std::forward<F>(f));
-    running_ = true;
-    thread_ = std::thread([&, task{std::move(task)}] {
-        task(JobControl(shared_from_this()), std::forward<Args>(args)...);
-        running_ = false;
-    });
+    pool.submit(
+        [self = shared_from_this(), f = std::forward<F>(f), ... args = std::forward<Args>(args)]() mutable {
+            std::exception_ptr error;
+            try
+            {
+                if (!self->canceled())
+                    f(JobControl(self), std::move(args)...);
+            }
+            catch (...)
+            {
+                // Kept for error(); a worker thread cannot propagate it
+                error = std::current_exception();
+            }
+            self->finish(error);
+        },
+        priority_);
 }
 
 } // namespace lt
@@ -0,0 +1,137 @@
+#ifndef LT_LRUCACHE_H
+#define LT_LRUCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace lt
+{
+
+struct CacheStats
+{
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t evictions{0};
+    // Bytes and entries currently held
+    std::size_t bytes{0};
+    std::size_t entries{0};
+};
+
+/* Least recently used cache bounded by the total size of its values rather
+ * than their count. Inserting evicts the least recently used entries until
+ * the total fits `budget`. Not thread-safe. */
+template <typename Key, typename Value, typename Hash = std::hash<Key>> class LruCache
+{
+public:
+    explicit LruCache(std::size_t budget) : budget_(budget) {}
+
+    // Returns the value and marks it most recently used, or a default Value
+    Value get(const Key & key)
+    {
+        auto it = map_.find(key);
+        if (it == map_.end())
+        {
+            ++stats_.misses;
+            return Value();
+        }
+        ++stats_.hits;
+        order_.splice(order_.begin(), order_, it->second);
+        return it->second->value;
+    }
+
+    // Returns true if `key` is cached. Does not change the order or counters.
+    inline bool contains(const Key & key) const { return map_.count(key) != 0; }
+
+    /* Inserts or replaces a value of `bytes` bytes. A value larger than the
+     * budget is not kept. */
+    void put(const Key & key, Value value, std::size_t bytes)
+    {
+        erase(key);
+        if (bytes > budget_)
+            return;
+
+        order_.push_front(Node{key, std::move(value), bytes});
+        map_.emplace(key, order_.begin());
+        stats_.bytes += bytes;
+        trim();
+    }
+
+    // Removes a value. Returns true if it was cached.
+    bool erase(const Key & key)
+    {
+        auto it = map_.find(key);
+        if (it == map_.end())
+            return false;
+        stats_.bytes -= it->second->bytes;
+        order_.erase(it->second);
+        map_.erase(it);
+        return true;
+    }
+
+    void clear()
+    {
+        order_.clear();
+        map_.clear();
+        stats_.bytes = 0;
+    }
+
+    // Sets the budget, evicting entries if it shrank
+    void setBudget(std::size_t budget)
+    {
+        budget_ = budget;
+        trim();
+    }
+
+    inline std::size_t budget() const noexcept { return budget_; }
+
+    inline CacheStats stats() const noexcept
+    {
+        CacheStats stats = stats_;
+        stats.entries = map_.size();
+        return stats;
+    }
+
+    // Counts a hit for a value that was found outside the cache
+    inline void countHit() noexcept { ++stats_.hits; }
+
+    inline void resetStats() noexcept
+    {
+        stats_.hits = 0;
+        stats_.misses = 0;
+        stats_.evictions = 0;
+    }
+
+private:
+    struct Node
+    {
+        Key key;
+        Value value;
+        std::size_t bytes;
+    };
+
+    // Most recently used first
+    std::list<Node> order_;
+    std::unordered_map<Key, typename std::list<Node>::iterator, Hash> map_;
+    std::size_t budget_;
+    CacheStats stats_;
+
+    void trim()
+    {
+        while (stats_.bytes > budget_)
+        {
+            const Node & node = order_.back();
+            stats_.bytes -= node.bytes;
+            map_.erase(node.key);
+            order_.pop_back();
+            ++stats_.evictions;
+        }
+    }
+};
+
+} // namespace lt
+
+#endif // LT_LRUCACHE_H
@@ -0,0 +1,167 @@
+#ifndef LT_PARALLEL_H
+#define LT_PARALLEL_H
+
+#include "job.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace lt
+{
+
+namespace detail
+{
+/* Hands out and counts the chunks of a parallel operation. Pool tasks and
+ * the waiting thread claim chunks from the same counter, so the waiting
+ * thread only ever runs chunks of its own group. */
+class ChunkGroup
+{
+public:
+    explicit ChunkGroup(std::size_t chunks) : chunks_(chunks), remaining_(chunks) {}
+
+    // Returns the next chunk that nobody started, if any
+    std::optional<std::size_t> claim() noexcept
+    {
+        std::size_t chunk = next_.fetch_add(1);
+        if (chunk >= chunks_)
+            return std::nullopt;
+        return chunk;
+    }
+
+    void done(std::exception_ptr error = nullptr)
+    {
+        std::lock_guard lock(mutex_);
+        if (error && !error_)
+            error_ = error;
+        if (--remaining_ == 0)
+            finished_.notify_all();
+    }
+
+    /* Runs unclaimed chunks with `run` on the calling thread, then blocks
+     * until the chunks running on other threads finished. Rethrows the
+     * first error. */
+    template <typename Run> void wait(Run && run)
+    {
+        while (std::optional<std::size_t> chunk = claim())
+            run(*chunk);
+
+        std::unique_lock lock(mutex_);
+        finished_.wait(lock, [this]() { return remaining_ == 0; });
+        if (error_)
+            std::rethrow_exception(error_);
+    }
+
+private:
+    const std::size_t chunks_;
+    std::atomic<std::size_t> next_{0};
+    std::mutex mutex_;
+    std::condition_variable finished_;
+    std::size_t remaining_;
+    std::exception_ptr error_;
+};
+
+// Chunk size giving each worker a few chunks to balance uneven work
+inline std::size_t chunkSize(const JobPool & pool, std::size_t count, std::size_t grain)
+{
+    if (grain != 0)
+        return grain;
+    return std::max<std::size_t>(1, count / (static_cast<std::size_t>(pool.size()) * 4 + 1));
+}
+} // namespace detail
+
+/* Calls `f(i)` for every i in [begin, end) on `pool`. The calling thread
+ * runs chunks that no worker picked up yet, so this may be called from a
+ * pool task. The first exception thrown by `f` is rethrown. If `control` is set,
+ * progress is reported to it and chunks are skipped once it is canceled. */
+template <typename F>
+void parallelFor(JobPool & pool, std::size_t begin, std::size_t end, F && f, std::size_t grain = 0,
+                 JobControl * control = nullptr,
+                 JobPriority priority = JobPriority::Background)
+{
+    if (begin >= end)
+        return;
+    const std::size_t count = end - begin;
+    const std::size_t chunk = detail::chunkSize(pool, count, grain);
+    const std::size_t chunks = (count + chunk - 1) / chunk;
+
+    // Tasks whose chunk the caller claimed may run after this returns, so
+    // they share ownership of the group
+    auto group = std::make_shared<detail::ChunkGroup>(chunks);
+    std::atomic<std::size_t> completed{0};
+    auto runChunk = [&](std::size_t c) {
+        std::size_t first = begin + c * chunk;
+        std::size_t last = std::min(end, first + chunk);
+        try
+        {
+            // Canceled operations skip the chunks that did not start
+            if (control == nullptr || !control->canceled())
+            {
+                for (std::size_t i = first; i < last; ++i)
+                    f(i);
+            }
+        }
+        catch (...)
+        {
+            group->done(std::current_exception());
+            return;
+        }
+        if (control != nullptr)
+        {
+            std::size_t done = completed.fetch_add(last - first) + (last - first);
+            control->setProgress(static_cast<double>(done) / static_cast<double>(count));
+        }
+        group->done();
+    };
+
+    for (std::size_t c = 0; c < chunks; ++c)
+    {
+        // A claimed chunk keeps the caller waiting, so `runChunk` outlives it
+        pool.submit(
+            [group, &runChunk]() {
+                if (std::optional<std::size_t> claimed = group->claim())
+                    runChunk(*claimed);
+            },
+            priority);
+    }
+    group->wait(runChunk);
+}
+
+/* Maps every i in [begin, end) with `map(i)` and folds the results into
+ * `init` with `reduce(T, T)`, in parallel on `pool`. `reduce` must be
+ * associative; chunks are combined in index order. */
+template <typename T, typename Map, typename Reduce>
+T mapReduce(JobPool & pool, std::size_t begin, std::size_t end, T init, Map && map, Reduce && reduce,
+            std::size_t grain = 0)
+{
+    if (begin >= end)
+        return init;
+    const std::size_t chunk = detail::chunkSize(pool, end - begin, grain);
+    const std::size_t chunks = (end - begin + chunk - 1) / chunk;
+
+    std::vector<std::optional<T>> partial(chunks);
+    parallelFor(
+        pool, 0, chunks,
+        [&](std::size_t c) {
+            std::size_t first = begin + c * chunk;
+            std::size_t last = std::min(end, first + chunk);
+            T value = map(first);
+            for (std::size_t i = first + 1; i < last; ++i)
+                value = reduce(std::move(value), map(i));
+            partial[c] = std::move(value);
+        },
+        1);
+
+    for (std::optional<T> & value : partial)
+        init = reduce(std::move(init), std::move(*value));
+    return init;
+}
+
+} // namespace lt
+
+#endif // LT_PARALLEL_H
@@ -0,0 +1,117 @@
+#ifndef LT_SMALLFUNCTION_H
+#define LT_SMALLFUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace lt
+{
+
+template <typename Signature, std::size_t Capacity = 48> class SmallFunction;
+
+/* Move-only std::function replacement that stores callables of up to
+ * `Capacity` bytes inline instead of allocating. Larger callables are
+ * stored on the heap. */
+template <typename R, typename... Args, std::size_t Capacity> class SmallFunction<R(Args...), Capacity>
+{
+public:
+    SmallFunction() noexcept = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, SmallFunction> &&
+                                                      std::is_invocable_r_v<R, std::decay_t<F> &, Args...>>>
+    SmallFunction(F && f)
+    {
+        using T = std::decay_t<F>;
+        if constexpr (fitsInline<T>)
+        {
+            new (storage_) T(std::forward<F>(f));
+            ops_ = &inlineOps<T>;
+        }
+        else
+        {
+            *reinterpret_cast<T **>(storage_) = new T(std::forward<F>(f));
+            ops_ = &heapOps<T>;
+        }
+    }
+
+    SmallFunction(SmallFunction && other) noexcept : ops_(other.ops_)
+    {
+        if (ops_ != nullptr)
+        {
+            ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    SmallFunction & operator=(SmallFunction && other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.ops_ != nullptr)
+            {
+                other.ops_->move(storage_, other.storage_);
+                ops_ = std::exchange(other.ops_, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    SmallFunction(const SmallFunction &) = delete;
+    SmallFunction & operator=(const SmallFunction &) = delete;
+
+    ~SmallFunction() { reset(); }
+
+    void reset() noexcept
+    {
+        if (ops_ != nullptr)
+        {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    // Must not be empty
+    R operator()(Args... args) const { return ops_->invoke(storage_, std::forward<Args>(args)...); }
+
+private:
+    struct Ops
+    {
+        R (*invoke)(void *, Args &&...);
+        // Move constructs into `to` and destroys `from`
+        void (*move)(void * to, void * from) noexcept;
+        void (*destroy)(void *) noexcept;
+    };
+
+    template <typename T>
+    static constexpr bool fitsInline = sizeof(T) <= Capacity && alignof(T) <= alignof(std::max_align_t) &&
+                                       std::is_nothrow_move_constructible_v<T>;
+
+    template <typename T>
+    static constexpr Ops inlineOps{
+        [](void * f, Args &&... args) -> R { return (*static_cast<T *>(f))(std::forward<Args>(args)...); },
+        [](void * to, void * from) noexcept {
+            new (to) T(std::move(*static_cast<T *>(from)));
+            static_cast<T *>(from)->~T();
+        },
+        [](void * f) noexcept { static_cast<T *>(f)->~T(); },
+    };
+
+    template <typename T>
+    static constexpr Ops heapOps{
+        [](void * f, Args &&... args) -> R { return (**static_cast<T **>(f))(std::forward<Args>(args)...); },
+        [](void * to, void * from) noexcept { *static_cast<T **>(to) = *static_cast<T **>(from); },
+        [](void * f) noexcept { delete *static_cast<T **>(f); },
+    };
+
+    alignas(std::max_align_t) mutable unsigned char storage_[Capacity];
+    const Ops * ops_{nullptr};
+};
+
+} // namespace lt
+
+#endif // LT_SMALLFUNCTION_H
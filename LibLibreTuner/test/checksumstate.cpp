@@ -0,0 +1,74 @@
+#include <lt/buffer/memorybuffer.h>
+#include <lt/definition/checksum.h>
+#include <lt/rom/checksumstate.h>
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace lt;
+
+namespace
+{
+// Buffer and checksums kept alive together, as in a tune
+struct Fixture
+{
+    MemoryBuffer buffer;
+    Checksums checksums;
+};
+
+std::unique_ptr<Fixture> makeFixture(std::mt19937 & rng, int size)
+{
+    auto fixture = std::make_unique<Fixture>();
+    std::vector<uint8_t> data(size);
+    for (uint8_t & byte : data)
+        byte = static_cast<uint8_t>(rng());
+    fixture->buffer = MemoryBuffer(std::move(data));
+
+    for (int i = 0; i < 2; ++i)
+    {
+        int offset = static_cast<int>(rng() % 1024) * 4;
+        int length = static_cast<int>(rng() % 256 + 2) * 4;
+        fixture->checksums.add(std::make_unique<ChecksumBasic>(offset, length, rng()));
+    }
+    int offset = static_cast<int>(rng() % 2048);
+    fixture->checksums.add(std::make_unique<ChecksumCrc>(offset, static_cast<int>(rng() % 1024 + 4), rng(),
+                                                         CrcParameters::crc32));
+    return fixture;
+}
+} // namespace
+
+// The running values of a ChecksumState must match a full recomputation
+// after any sequence of writes
+int main()
+{
+    std::mt19937 rng(1);
+    for (int iteration = 0; iteration < 100; ++iteration)
+    {
+        const int size = 8192;
+        auto fixture = makeFixture(rng, size);
+        ChecksumState state(fixture->checksums, fixture->buffer);
+
+        for (int write = 0; write < 200; ++write)
+        {
+            uint8_t data[16];
+            for (uint8_t & byte : data)
+                byte = static_cast<uint8_t>(rng());
+            int offset = static_cast<int>(rng() % (size - sizeof(data)));
+            fixture->buffer.write(offset, data, static_cast<int>(rng() % sizeof(data)));
+
+            // Query some writes so stale values are recomputed in between
+            if (write % 5 == 0)
+                state.valid();
+
+            if (!state.verify())
+            {
+                std::cerr << "running checksum diverged in iteration " << iteration << " after write " << write
+                          << '\n';
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
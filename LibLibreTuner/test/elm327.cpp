@@ -0,0 +1,133 @@
+#include "elm327emulator.h"
+
+#include <lt/network/command/elm327.h>
+#include <lt/network/isotp/isotpelm.h>
+#include <lt/network/uds/isotpuds.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace lt::network;
+
+namespace
+{
+void check(bool condition, const std::string & message)
+{
+    if (!condition)
+        throw std::runtime_error(message);
+}
+
+struct Connection
+{
+    std::unique_ptr<Elm327Emulator> emulator;
+    std::unique_ptr<IsoTpUds> uds;
+};
+
+Connection connect(Elm327EmulatorOptions options, const std::shared_ptr<MemoryEcu> & ecu)
+{
+    Connection connection;
+    connection.emulator = std::make_unique<Elm327Emulator>(options);
+    connection.emulator->addEcu(ecu);
+    connection.emulator->start();
+
+    serial::Settings settings;
+    settings.baudrate = 0;
+    auto device = std::make_shared<Elm327>(connection.emulator->port(), settings);
+    device->open();
+    check(device->chip() == (options.stn ? ElmChip::Stn : ElmChip::Elm327), "wrong chip detected");
+
+    connection.uds = std::make_unique<IsoTpUds>(std::make_unique<IsoTpElm>(device));
+    return connection;
+}
+
+// Reads memory in blocks, which span many frames each
+void testReadMemory(bool stn)
+{
+    auto ecu = std::make_shared<MemoryEcu>();
+    std::vector<uint8_t> memory(0x2000);
+    for (std::size_t i = 0; i < memory.size(); ++i)
+        memory[i] = static_cast<uint8_t>(i * 7);
+    ecu->setMemory(memory);
+    ecu->setPendingResponses(1);
+
+    Elm327EmulatorOptions options;
+    options.stn = stn;
+    Connection connection = connect(options, ecu);
+
+    for (uint32_t address = 0; address < memory.size(); address += 0x100)
+    {
+        std::vector<uint8_t> block = connection.uds->requestReadMemoryAddress(address, 0x100);
+        check(std::equal(block.begin(), block.end(), memory.begin() + address, memory.begin() + address + 0x100) &&
+                  block.size() == 0x100,
+              "memory read at " + std::to_string(address) + " does not match");
+    }
+}
+
+// Reads at different addresses share a response count hint
+void testMemoryHints(bool stn)
+{
+    auto ecu = std::make_shared<MemoryEcu>();
+    ecu->setMemory(std::vector<uint8_t>(0x1000, 0x5A));
+
+    Elm327EmulatorOptions options;
+    options.stn = stn;
+    Connection connection = connect(options, ecu);
+
+    const std::size_t reads = 0x1000 / 0x20;
+    for (uint32_t address = 0; address < 0x1000; address += 0x20)
+        check(connection.uds->requestReadMemoryAddress(address, 0x20).size() == 0x20, "memory read truncated");
+    // Only the first read goes without a hint
+    check(connection.emulator->countedRequests() == reads - 1, "memory reads were not hinted");
+}
+
+// Response count hints must not truncate requests of the same service with
+// longer responses, or responses that grew since the hint was learned
+void testResponseHints(bool stn)
+{
+    auto ecu = std::make_shared<MemoryEcu>();
+    ecu->setIdentifier(0xF101, std::vector<uint8_t>(2, 1));
+    ecu->setIdentifier(0xF190, std::vector<uint8_t>(17, 'V'));
+    ecu->setIdentifier(0xF102, std::vector<uint8_t>(3, 2));
+
+    Elm327EmulatorOptions options;
+    options.stn = stn;
+    Connection connection = connect(options, ecu);
+    IsoTpUds & uds = *connection.uds;
+
+    // Responses include the identifier
+    for (int i = 0; i < 3; ++i)
+    {
+        check(uds.readDataByIdentifier(0xF101).size() == 4, "single frame identifier truncated");
+        check(uds.readDataByIdentifier(0xF190).size() == 19, "multi-frame identifier truncated");
+    }
+
+    check(uds.readDataByIdentifier(0xF102).size() == 5, "identifier truncated");
+    ecu->setIdentifier(0xF102, std::vector<uint8_t>(40, 3));
+    check(uds.readDataByIdentifier(0xF102).size() == 42, "grown identifier truncated");
+    check(uds.readDataByIdentifier(0xF102).size() == 42, "grown identifier truncated after retry");
+}
+} // namespace
+
+// Drives Elm327 and IsoTpElm against an emulated adapter
+int main()
+{
+    try
+    {
+        for (bool stn : {false, true})
+        {
+            testReadMemory(stn);
+            testMemoryHints(stn);
+            testResponseHints(stn);
+        }
+    }
+    catch (const std::exception & e)
+    {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
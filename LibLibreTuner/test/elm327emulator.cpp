@@ -0,0 +1,583 @@
+#include "elm327emulator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#endif
+
+namespace lt::network
+{
+
+namespace
+{
+constexpr char hexDigits[] = "0123456789ABCDEF";
+
+void appendHexByte(std::string & out, uint8_t byte)
+{
+    out += hexDigits[byte >> 4];
+    out += hexDigits[byte & 0xF];
+}
+
+// Parses `text` as a hex number. Returns false if it contains other characters.
+bool parseHex(const std::string & text, uint32_t & value)
+{
+    if (text.empty() || text.size() > 8)
+        return false;
+    value = 0;
+    for (char c : text)
+    {
+        if (!std::isxdigit(static_cast<unsigned char>(c)))
+            return false;
+        value = (value << 4) | static_cast<uint32_t>(std::isdigit(static_cast<unsigned char>(c)) ? c - '0' : c - 'A' + 10);
+    }
+    return true;
+}
+
+bool parseHexBytes(const std::string & text, std::vector<uint8_t> & bytes)
+{
+    if (text.size() % 2 != 0)
+        return false;
+    bytes.clear();
+    for (std::size_t i = 0; i < text.size(); i += 2)
+    {
+        uint32_t byte;
+        if (!parseHex(text.substr(i, 2), byte))
+            return false;
+        bytes.push_back(static_cast<uint8_t>(byte));
+    }
+    return true;
+}
+
+std::vector<uint8_t> negative(uint8_t sid, uint8_t code) { return {0x7F, sid, code}; }
+} // namespace
+
+void MemoryEcu::setMemory(std::vector<uint8_t> memory, uint32_t base)
+{
+    std::lock_guard lock(mutex_);
+    memory_ = std::move(memory);
+    base_ = base;
+}
+
+void MemoryEcu::setIdentifier(uint16_t id, std::vector<uint8_t> data)
+{
+    std::lock_guard lock(mutex_);
+    identifiers_[id] = std::move(data);
+}
+
+std::vector<std::vector<uint8_t>> MemoryEcu::respond(const std::vector<uint8_t> & request)
+{
+    std::lock_guard lock(mutex_);
+    if (request.empty())
+        return {};
+
+    const uint8_t sid = request[0];
+    switch (sid)
+    {
+    case 0x10: // DiagnosticSessionControl
+        if (request.size() != 2)
+            return {negative(sid, 0x13)};
+        // P2 = 50ms, P2* = 5000ms
+        return {{0x50, request[1], 0x00, 0x32, 0x01, 0xF4}};
+    case 0x27: // SecurityAccess
+        if (request.size() < 2)
+            return {negative(sid, 0x13)};
+        if (request[1] % 2 == 1)
+            return {{0x67, request[1], 0x12, 0x34, 0x56}};
+        return {{0x67, request[1]}};
+    case 0x3E: // TesterPresent
+        return {{0x7E, 0x00}};
+    case 0x22: // ReadDataByIdentifier
+    {
+        if (request.size() != 3)
+            return {negative(sid, 0x13)};
+        auto it = identifiers_.find(static_cast<uint16_t>((request[1] << 8) | request[2]));
+        if (it == identifiers_.end())
+            return {negative(sid, 0x31)};
+        std::vector<uint8_t> response{0x62, request[1], request[2]};
+        response.insert(response.end(), it->second.begin(), it->second.end());
+        return {response};
+    }
+    case 0x23: // ReadMemoryByAddress
+    {
+        if (request.size() != 7)
+            return {negative(sid, 0x13)};
+        uint32_t address = (static_cast<uint32_t>(request[1]) << 24) | (static_cast<uint32_t>(request[2]) << 16) |
+                           (static_cast<uint32_t>(request[3]) << 8) | request[4];
+        uint32_t length = (static_cast<uint32_t>(request[5]) << 8) | request[6];
+        if (address < base_ || address - base_ + length > memory_.size())
+            return {negative(sid, 0x31)};
+
+        std::vector<std::vector<uint8_t>> responses(pending_, negative(sid, 0x78));
+        std::vector<uint8_t> response{0x63};
+        auto begin = memory_.begin() + (address - base_);
+        response.insert(response.end(), begin, begin + length);
+        responses.emplace_back(std::move(response));
+        return responses;
+    }
+    default:
+        // serviceNotSupported
+        return {negative(sid, 0x11)};
+    }
+}
+
+#ifdef __linux__
+
+Elm327Emulator::Elm327Emulator(Elm327EmulatorOptions options) : options_(std::move(options)) {}
+
+Elm327Emulator::~Elm327Emulator() { stop(); }
+
+void Elm327Emulator::addEcu(VirtualEcuPtr ecu)
+{
+    if (running_)
+        throw std::runtime_error("ECUs must be added before the emulator is started");
+    ecus_.emplace_back(std::move(ecu));
+}
+
+void Elm327Emulator::start()
+{
+    if (running_)
+        return;
+
+    master_ = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_ == -1 || grantpt(master_) != 0 || unlockpt(master_) != 0)
+    {
+        stop();
+        throw std::runtime_error(std::string("failed to create pseudo-terminal: ") + std::strerror(errno));
+    }
+    port_ = ptsname(master_);
+
+    // Raw mode, so nothing is translated before the client configures the
+    // terminal
+    slave_ = ::open(port_.c_str(), O_RDWR | O_NOCTTY);
+    if (slave_ == -1)
+    {
+        stop();
+        throw std::runtime_error(std::string("failed to open pseudo-terminal: ") + std::strerror(errno));
+    }
+    termios settings{};
+    tcgetattr(slave_, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(slave_, TCSANOW, &settings);
+
+    reset();
+    running_ = true;
+    thread_ = std::thread([this]() { run(); });
+}
+
+void Elm327Emulator::stop()
+{
+    running_ = false;
+    if (thread_.joinable())
+        thread_.join();
+    if (slave_ != -1)
+        ::close(slave_);
+    if (master_ != -1)
+        ::close(master_);
+    slave_ = master_ = -1;
+}
+
+void Elm327Emulator::reset()
+{
+    echo_ = true;
+    linefeeds_ = true;
+    spaces_ = true;
+    headers_ = false;
+    header_ = 0x7DF;
+    receiveAddress_ = 0;
+    timeout_ = 0x32;
+    adaptiveTiming_ = 1;
+}
+
+void Elm327Emulator::run()
+{
+    std::string input;
+    char buffer[256];
+
+    while (running_)
+    {
+        pollfd fd{master_, POLLIN, 0};
+        if (poll(&fd, 1, 50) <= 0)
+            continue;
+
+        ssize_t amount = ::read(master_, buffer, sizeof(buffer));
+        if (amount <= 0)
+            continue;
+
+        for (ssize_t i = 0; i < amount; ++i)
+        {
+            char c = buffer[i];
+            if (c == '\n')
+                continue;
+            if (c != '\r')
+            {
+                input += c;
+                continue;
+            }
+
+            // The command crossed the UART before it could be processed
+            throttle(input.size() + 1);
+
+            std::string response;
+            if (echo_)
+            {
+                response += input;
+                endLine(response);
+            }
+
+            // An empty line repeats the last command
+            std::string command = input.empty() ? lastCommand_ : input;
+            input.clear();
+
+            std::this_thread::sleep_for(options_.latency);
+            response += process(command);
+            endLine(response);
+            response += '>';
+            write(response);
+
+            lastCommand_ = command;
+            ++commands_;
+        }
+    }
+}
+
+void Elm327Emulator::endLine(std::string & out) const
+{
+    out += '\r';
+    if (linefeeds_)
+        out += '\n';
+}
+
+std::string Elm327Emulator::process(const std::string & raw)
+{
+    // Commands are case insensitive and spaces are ignored
+    std::string command;
+    for (char c : raw)
+    {
+        if (c != ' ')
+            command += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+
+    auto line = [this](std::string text) {
+        endLine(text);
+        return text;
+    };
+
+    if (command.compare(0, 2, "AT") == 0)
+        return line(processAt(command.substr(2)));
+
+    if (command.compare(0, 2, "ST") == 0)
+    {
+        if (options_.stn && command == "STI")
+            return line("STN1110 v4.2.0");
+        if (options_.stn && command.compare(0, 4, "STPX") == 0)
+        {
+            // e.g. STPX H:7E0, D:0123, R:1
+            std::vector<uint8_t> data;
+            int expectedFrames = 0;
+            std::size_t pos = 4;
+            while (pos < command.size())
+            {
+                std::size_t end = command.find(',', pos);
+                if (end == std::string::npos)
+                    end = command.size();
+                std::string param = command.substr(pos, end - pos);
+                pos = end + 1;
+
+                uint32_t value;
+                if (param.compare(0, 2, "D:") == 0 && parseHexBytes(param.substr(2), data))
+                    continue;
+                if (param.compare(0, 2, "H:") == 0 && parseHex(param.substr(2), value))
+                {
+                    header_ = value;
+                    continue;
+                }
+                if (param.compare(0, 2, "R:") == 0 && !param.substr(2).empty() &&
+                    std::all_of(param.begin() + 2, param.end(), [](char c) { return std::isdigit(c); }))
+                {
+                    expectedFrames = std::stoi(param.substr(2));
+                    continue;
+                }
+                return line("?");
+            }
+            if (data.empty() || data.size() > 0xFFF)
+                return line("?");
+            return transmit(data, expectedFrames);
+        }
+        return line("?");
+    }
+
+    // Hex request with an optional trailing response count
+    int expectedFrames = 0;
+    if (command.size() % 2 == 1)
+    {
+        uint32_t count;
+        if (!parseHex(command.substr(command.size() - 1), count) || count == 0)
+            return line("?");
+        expectedFrames = static_cast<int>(count);
+        command.pop_back();
+    }
+
+    std::vector<uint8_t> data;
+    // Plain requests are limited to a single frame
+    if (!parseHexBytes(command, data) || data.empty() || data.size() > 7)
+        return line("?");
+    return transmit(data, expectedFrames);
+}
+
+std::string Elm327Emulator::processAt(const std::string & command)
+{
+    auto flag = [&command](const char * name, bool & value) {
+        std::size_t length = std::strlen(name);
+        if (command.size() != length + 1 || command.compare(0, length, name) != 0 ||
+            (command[length] != '0' && command[length] != '1'))
+            return false;
+        value = command[length] == '1';
+        return true;
+    };
+
+    bool ignored;
+    uint32_t value;
+    if (command == "Z")
+    {
+        reset();
+        return options_.version;
+    }
+    if (command == "I")
+        return options_.version;
+    if (command == "D")
+    {
+        reset();
+        return "OK";
+    }
+    if (flag("E", echo_) || flag("L", linefeeds_) || flag("S", spaces_) || flag("H", headers_) ||
+        flag("CAF", ignored))
+        return "OK";
+    if (command.compare(0, 2, "AT") == 0 && command.size() == 3 && command[2] >= '0' && command[2] <= '2')
+    {
+        adaptiveTiming_ = static_cast<uint8_t>(command[2] - '0');
+        return "OK";
+    }
+    if ((command.compare(0, 2, "SP") == 0 || command.compare(0, 2, "TP") == 0) && command.size() >= 3)
+        return "OK";
+    if (command.compare(0, 2, "SH") == 0 && parseHex(command.substr(2), value))
+    {
+        header_ = value;
+        return "OK";
+    }
+    if (command.compare(0, 3, "CRA") == 0)
+    {
+        if (command.size() == 3)
+            receiveAddress_ = 0;
+        else if (parseHex(command.substr(3), value))
+            receiveAddress_ = value;
+        else
+            return "?";
+        return "OK";
+    }
+    if (command.compare(0, 4, "FCSH") == 0 && parseHex(command.substr(4), value))
+        return "OK";
+    if (command.compare(0, 2, "ST") == 0 && command.size() == 4 && parseHex(command.substr(2), value))
+    {
+        timeout_ = static_cast<uint8_t>(value);
+        return "OK";
+    }
+    return "?";
+}
+
+void Elm327Emulator::formatMessage(std::string & out, uint32_t id, const std::vector<uint8_t> & message,
+                                   int & frames, int maxFrames)
+{
+    auto full = [&]() { return maxFrames != 0 && frames >= maxFrames; };
+    auto headerText = [&](std::string & line) {
+        if (!headers_)
+            return;
+        line += hexDigits[(id >> 8) & 0xF];
+        line += hexDigits[(id >> 4) & 0xF];
+        line += hexDigits[id & 0xF];
+        if (spaces_)
+            line += ' ';
+    };
+    auto bytes = [&](std::string & line, const uint8_t * data, std::size_t size) {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            if (i != 0 && spaces_)
+                line += ' ';
+            appendHexByte(line, data[i]);
+        }
+    };
+
+    if (full())
+        return;
+
+    if (message.size() <= 7)
+    {
+        // Single frame
+        std::string line;
+        headerText(line);
+        if (headers_)
+        {
+            appendHexByte(line, static_cast<uint8_t>(message.size()));
+            if (spaces_)
+                line += ' ';
+        }
+        bytes(line, message.data(), message.size());
+        out += line;
+        endLine(out);
+        ++frames;
+        return;
+    }
+
+    // Multi-frame message. Without headers the adapter prints the length
+    // and indexes each line; with headers it prints the raw frames.
+    if (!headers_)
+    {
+        out += hexDigits[(message.size() >> 8) & 0xF];
+        out += hexDigits[(message.size() >> 4) & 0xF];
+        out += hexDigits[message.size() & 0xF];
+        endLine(out);
+    }
+
+    std::size_t offset = 0;
+    for (int index = 0; offset < message.size() && !full(); ++index)
+    {
+        const std::size_t capacity = index == 0 ? 6 : 7;
+        // The last frame is padded
+        uint8_t frame[7];
+        std::fill(std::begin(frame), std::end(frame), 0x55);
+        std::size_t size = std::min(capacity, message.size() - offset);
+        std::memcpy(frame, message.data() + offset, size);
+        offset += size;
+
+        std::string line;
+        headerText(line);
+        if (headers_)
+        {
+            uint8_t pci[2];
+            std::size_t pciSize = 1;
+            if (index == 0)
+            {
+                pci[0] = static_cast<uint8_t>(0x10 | ((message.size() >> 8) & 0xF));
+                pci[1] = static_cast<uint8_t>(message.size() & 0xFF);
+                pciSize = 2;
+            }
+            else
+                pci[0] = static_cast<uint8_t>(0x20 | (index & 0xF));
+            bytes(line, pci, pciSize);
+            if (spaces_)
+                line += ' ';
+        }
+        else
+        {
+            line += hexDigits[index & 0xF];
+            line += ':';
+            if (spaces_)
+                line += ' ';
+        }
+        bytes(line, frame, capacity);
+        out += line;
+        endLine(out);
+        ++frames;
+    }
+}
+
+std::string Elm327Emulator::transmit(const std::vector<uint8_t> & request, int expectedFrames)
+{
+    if (expectedFrames != 0)
+        ++countedRequests_;
+
+    std::string out;
+    int frames = 0;
+    for (const VirtualEcuPtr & ecu : ecus_)
+    {
+        // 0x7DF is the functional (broadcast) address
+        if (header_ != ecu->requestId() && header_ != 0x7DF)
+            continue;
+        if (receiveAddress_ != 0 && receiveAddress_ != ecu->responseId())
+            continue;
+
+        for (const std::vector<uint8_t> & message : ecu->respond(request))
+            formatMessage(out, ecu->responseId(), message, frames, expectedFrames);
+    }
+
+    // Without a response count, the adapter waits until no more responses
+    // arrive. Adaptive timing shortens the wait.
+    if (options_.simulateTimeout && (expectedFrames == 0 || frames < expectedFrames))
+    {
+        auto wait = std::chrono::microseconds(static_cast<int64_t>(timeout_) * 4096);
+        if (adaptiveTiming_ != 0)
+            wait /= adaptiveTiming_ * 2;
+        std::this_thread::sleep_for(wait);
+    }
+
+    if (frames == 0)
+    {
+        out = "NO DATA";
+        endLine(out);
+    }
+    return out;
+}
+
+void Elm327Emulator::throttle(std::size_t bytes) const
+{
+    if (options_.baudrate == 0)
+        return;
+    // 8N1: 10 bits per byte
+    std::this_thread::sleep_for(std::chrono::microseconds(bytes * 10 * 1000000 / options_.baudrate));
+}
+
+void Elm327Emulator::write(const std::string & data)
+{
+    // Pace the output in small chunks so the reader sees data arrive at
+    // the simulated rate
+    constexpr std::size_t chunk = 32;
+    auto next = std::chrono::steady_clock::now();
+    for (std::size_t offset = 0; offset < data.size(); offset += chunk)
+    {
+        std::size_t size = std::min(chunk, data.size() - offset);
+        if (options_.baudrate != 0)
+        {
+            next += std::chrono::microseconds(size * 10 * 1000000 / options_.baudrate);
+            std::this_thread::sleep_until(next);
+        }
+
+        std::size_t written = 0;
+        while (written < size)
+        {
+            ssize_t amount = ::write(master_, data.data() + offset + written, size - written);
+            if (amount <= 0)
+            {
+                if (amount == -1 && errno == EINTR)
+                    continue;
+                return;
+            }
+            written += static_cast<std::size_t>(amount);
+        }
+    }
+}
+
+#else
+
+Elm327Emulator::Elm327Emulator(Elm327EmulatorOptions options) : options_(std::move(options)) {}
+
+Elm327Emulator::~Elm327Emulator() = default;
+
+void Elm327Emulator::addEcu(VirtualEcuPtr ecu) { ecus_.emplace_back(std::move(ecu)); }
+
+void Elm327Emulator::start() { throw std::runtime_error("the ELM327 emulator requires pseudo-terminals"); }
+
+void Elm327Emulator::stop() {}
+
+#endif
+
+} // namespace lt::network
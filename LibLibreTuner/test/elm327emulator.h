@@ -0,0 +1,163 @@
+#ifndef LT_ELM327EMULATOR_H
+#define LT_ELM327EMULATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace lt::network
+{
+
+/* ECU behind an emulated adapter. Receives complete ISO-TP requests sent to
+ * `requestId` and answers from `responseId`. */
+class VirtualEcu
+{
+public:
+    explicit VirtualEcu(uint32_t requestId = 0x7E0, uint32_t responseId = 0x7E8)
+        : requestId_(requestId), responseId_(responseId)
+    {
+    }
+    virtual ~VirtualEcu() = default;
+
+    inline uint32_t requestId() const noexcept { return requestId_; }
+    inline uint32_t responseId() const noexcept { return responseId_; }
+
+    /* Returns the messages sent in response to `request`, in order. An
+     * empty vector means the ECU does not respond. Called from the
+     * emulator thread. */
+    virtual std::vector<std::vector<uint8_t>> respond(const std::vector<uint8_t> & request) = 0;
+
+private:
+    uint32_t requestId_;
+    uint32_t responseId_;
+};
+using VirtualEcuPtr = std::shared_ptr<VirtualEcu>;
+
+/* Virtual ECU implementing the UDS services used for downloading and
+ * logging: DiagnosticSessionControl, SecurityAccess (any key is accepted),
+ * TesterPresent, ReadDataByIdentifier and ReadMemoryByAddress (4 byte
+ * address, 2 byte length) over a memory image. */
+class MemoryEcu : public VirtualEcu
+{
+public:
+    using VirtualEcu::VirtualEcu;
+
+    // Sets the memory image. `base` is the address of the first byte.
+    void setMemory(std::vector<uint8_t> memory, uint32_t base = 0);
+
+    void setIdentifier(uint16_t id, std::vector<uint8_t> data);
+
+    /* Number of "response pending" (0x78) responses sent before each
+     * ReadMemoryByAddress response */
+    inline void setPendingResponses(int count) noexcept { pending_ = count; }
+
+    std::vector<std::vector<uint8_t>> respond(const std::vector<uint8_t> & request) override;
+
+private:
+    std::mutex mutex_;
+    std::vector<uint8_t> memory_;
+    uint32_t base_{0};
+    std::unordered_map<uint16_t, std::vector<uint8_t>> identifiers_;
+    int pending_{0};
+};
+
+struct Elm327EmulatorOptions
+{
+    // Simulated UART baudrate (8N1). 0 disables throttling.
+    uint32_t baudrate{0};
+    // Processing delay before every response
+    std::chrono::microseconds latency{0};
+    /* Wait for further responses after the last one, as the adapter does
+     * when a request does not end with a response count. The wait is the
+     * AT ST timeout, shortened by adaptive timing. */
+    bool simulateTimeout{true};
+    // Respond to ST commands like an STN chip
+    bool stn{false};
+    std::string version{"ELM327 v1.5"};
+};
+
+/* Emulates an ELM327 (or STN) adapter on a pseudo-terminal so the serial
+ * stack can be tested without hardware. Open `port()` with Elm327 like a
+ * real adapter. Supports the AT commands used by Elm327/IsoTpElm, hex
+ * requests with an optional response count, STPX and the multi-line
+ * "0:"/"1:" response format. */
+class Elm327Emulator
+{
+public:
+    explicit Elm327Emulator(Elm327EmulatorOptions options = Elm327EmulatorOptions{});
+    ~Elm327Emulator();
+
+    Elm327Emulator(const Elm327Emulator &) = delete;
+    Elm327Emulator & operator=(const Elm327Emulator &) = delete;
+
+    // Adds an ECU. Must be called before start().
+    void addEcu(VirtualEcuPtr ecu);
+
+    // Creates the pseudo-terminal and starts the emulator thread. Throws
+    // if the terminal cannot be created.
+    void start();
+
+    void stop();
+
+    // Path of the terminal to open. Empty until started.
+    inline const std::string & port() const noexcept { return port_; }
+
+    // Number of commands processed
+    inline std::size_t commands() const noexcept { return commands_; }
+
+    // Number of requests sent with a response count
+    inline std::size_t countedRequests() const noexcept { return countedRequests_; }
+
+private:
+    Elm327EmulatorOptions options_;
+    std::vector<VirtualEcuPtr> ecus_;
+
+    int master_{-1};
+    // Kept open so the terminal survives clients closing it
+    int slave_{-1};
+    std::string port_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<std::size_t> commands_{0};
+    std::atomic<std::size_t> countedRequests_{0};
+
+    // Adapter state
+    bool echo_{true};
+    bool linefeeds_{true};
+    bool spaces_{true};
+    bool headers_{false};
+    uint32_t header_{0x7DF};
+    // 0 accepts every response
+    uint32_t receiveAddress_{0};
+    uint8_t timeout_{0x32};
+    uint8_t adaptiveTiming_{1};
+    std::string lastCommand_;
+
+    void reset();
+    void run();
+
+    // Processes a single command and returns the text to send back,
+    // excluding echo and prompt
+    std::string process(const std::string & command);
+    std::string processAt(const std::string & command);
+    std::string transmit(const std::vector<uint8_t> & request, int expectedFrames);
+
+    void formatMessage(std::string & out, uint32_t id, const std::vector<uint8_t> & message, int & frames,
+                       int maxFrames);
+    void endLine(std::string & out) const;
+
+    // Writes to the terminal, throttled to the simulated baudrate
+    void write(const std::string & data);
+    // Sleeps for the time `bytes` take at the simulated baudrate
+    void throttle(std::size_t bytes) const;
+};
+
+} // namespace lt::network
+
+#endif // LT_ELM327EMULATOR_H
@@ -1,6 +1,8 @@
 #include "projects.h"
 
 #include <QFileIconProvider>
+
+#include <unordered_set>
 #include <logger.h>
 #include <uiutil.h>
 
@@ -98,6 +100,8 @@ public:
         return QVariant();
     }
 
+    const std::filesystem::path & path() const noexcept { return md_.path; }
+
 private:
     lt::Rom::MetaData md_;
 };
@@ -130,6 +134,8 @@ public:
         return QVariant();
     }
 
+    const std::filesystem::path & path() const noexcept { return md_.path; }
+
 private:
     lt::Tune::MetaData md_;
 };
@@ -373,60 +379,99 @@ void Projects::romsDirectoryChanged(const QString & path)
 void Projects::refreshRoms(const QModelIndex & index)
 {
     auto project = index.data(Qt::UserRole).value<lt::ProjectPtr>();
-    auto romsItem = reinterpret_cast<RomsItem *>(index.internalPointer());
-
-    // Found the correct project, reset roms
-    if (!romsItem->children.empty())
-    {
-        beginRemoveRows(index, 0, romsItem->children.size() - 1);
-        qDeleteAll(romsItem->children);
-        romsItem->children.clear();
-        endRemoveRows();
-    }
 
-    // Get all ROM metadatal
+    // Only changed files are read; the rest comes from the project index
     catchWarning([&](){
-        auto roms = project->queryRoms();
-        if (!roms.empty())
+        lt::IndexChanges changes = project->refreshRoms();
+        if (!changes.empty() || index.model()->rowCount(index) == 0)
         {
-            beginInsertRows(index, 0, roms.size() - 1);
-            for (const auto & rom : roms)
-            {
-                new RomItem(rom, romsItem);
-            }
-            endInsertRows();
+            applyChanges<RomItem>(index, changes, project->index().roms());
         }
     }, tr("Error querying ROM metadata"));
 }
 
-// A copy of the above method (gross, but it's quicker than abstracting it).
 void Projects::refreshTunes(const QModelIndex & index)
 {
     auto project = index.data(Qt::UserRole).value<lt::ProjectPtr>();
-    auto tunesItem = reinterpret_cast<TunesItem *>(index.internalPointer());
 
-    // Found the correct project, reset roms
-    if (!tunesItem->children.empty())
-    {
-        beginRemoveRows(index, 0, tunesItem->children.size() - 1);
-        qDeleteAll(tunesItem->children);
-        tunesItem->children.clear();
-        endRemoveRows();
-    }
-
-    // Get all tune metadata
     catchWarning([&](){
-        auto tunes = project->queryTunes();
-        if (!tunes.empty())
+        lt::IndexChanges changes = project->refreshTunes();
+        if (!changes.empty() || index.model()->rowCount(index) == 0)
         {
-            beginInsertRows(index, 0, tunes.size() - 1);
-            for (const auto & tune : tunes)
+            applyChanges<TuneItem>(index, changes, project->index().tunes());
+        }
+    }, tr("Error querying tune metadata"));
+}
+
+template <typename Item, typename MetaData>
+void Projects::applyChanges(const QModelIndex & index,
+                            const lt::IndexChanges & changes,
+                            const std::vector<MetaData> & metadata)
+{
+    auto * parentItem = static_cast<TreeItem *>(index.internalPointer());
+
+    // A new project starts with the entries of the saved index, which
+    // refreshing does not report
+    if (parentItem->children.empty())
+    {
+        if (!metadata.empty())
+        {
+            beginInsertRows(index, 0, metadata.size() - 1);
+            for (const auto & md : metadata)
             {
-                new TuneItem(tune, tunesItem);
+                new Item(md, parentItem);
             }
             endInsertRows();
         }
-    }, tr("Error querying tune metadata"));
+        return;
+    }
+
+    // Remove rows of removed and modified files
+    std::unordered_set<std::string> stale;
+    for (const auto & path : changes.removed)
+    {
+        stale.emplace(path.string());
+    }
+    for (const auto & path : changes.modified)
+    {
+        stale.emplace(path.string());
+    }
+
+    for (int row = parentItem->children.size() - 1; row >= 0; --row)
+    {
+        auto * item = static_cast<Item *>(parentItem->children[row]);
+        if (stale.count(item->path().string()) == 0)
+        {
+            continue;
+        }
+        beginRemoveRows(index, row, row);
+        parentItem->children.removeAt(row);
+        delete item;
+        endRemoveRows();
+    }
+
+    // Insert rows of added and modified files
+    std::unordered_set<std::string> fresh;
+    for (const auto & path : changes.added)
+    {
+        fresh.emplace(path.string());
+    }
+    for (const auto & path : changes.modified)
+    {
+        fresh.emplace(path.string());
+    }
+
+    for (const auto & md : metadata)
+    {
+        if (fresh.count(md.path.string()) == 0)
+        {
+            continue;
+        }
+        int row = parentItem->children.size();
+        beginInsertRows(index, row, row);
+        new Item(md, parentItem);
+        endInsertRows();
+    }
 }
 
 void Projects::tunesDirectoryChanged(const QString & path)
@@ -46,6 +46,14 @@ private:
     void refreshRoms(const QModelIndex & index);
     void refreshTunes(const QModelIndex & index);
 
+    /* Removes the rows of removed and modified files under `index` and
+     * appends rows for added and modified files from `metadata`. Fills
+     * the rows from `metadata` if there are none. */
+    template <typename Item, typename MetaData>
+    void applyChanges(const QModelIndex & index,
+                      const lt::IndexChanges & changes,
+                      const std::vector<MetaData> & metadata);
+
 private slots:
     void romsDirectoryChanged(const QString & path);
     void tunesDirectoryChanged(const QString & path);
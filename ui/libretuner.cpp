@@ -99,7 +99,7 @@ LibreTuner::LibreTuner(int & argc, char * argv[])
     }
 
     catchCritical(
-        [&]() { platforms_.loadDirectory(definitionPath); },
+        [&]() { platforms_.loadDirectory(definitionPath, rootPath_ / "definitions.ltdc"); },
         "Error loading definitions");
 
     links_.setPath(rootPath_ / "links.lts");
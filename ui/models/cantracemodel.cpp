@@ -0,0 +1,153 @@
+#include "cantracemodel.h"
+
+#include <QFont>
+
+#include <algorithm>
+#include <limits>
+
+void CanTraceModel::setTrace(const std::filesystem::path & path)
+{
+    auto trace = std::make_unique<lt::network::CanTraceReader>(path);
+    auto index = std::make_unique<lt::network::CanTraceIndex>(*trace);
+
+    beginResetModel();
+    index_ = std::move(index);
+    trace_ = std::move(trace);
+    rows_.reset();
+    endResetModel();
+}
+
+void CanTraceModel::clear()
+{
+    beginResetModel();
+    index_.reset();
+    trace_.reset();
+    rows_.reset();
+    endResetModel();
+}
+
+void CanTraceModel::setFilter(const lt::network::CanTraceFilter & filter)
+{
+    if (!index_)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> rows = index_->filter(filter);
+    beginResetModel();
+    rows_ = std::move(rows);
+    endResetModel();
+}
+
+void CanTraceModel::clearFilter()
+{
+    beginResetModel();
+    rows_.reset();
+    endResetModel();
+}
+
+std::size_t CanTraceModel::record(int row) const noexcept
+{
+    return rows_ ? (*rows_)[row] : static_cast<std::size_t>(row);
+}
+
+int CanTraceModel::find(uint64_t timestamp) const noexcept
+{
+    if (!index_)
+    {
+        return 0;
+    }
+
+    std::size_t first = index_->find(timestamp);
+    if (rows_)
+    {
+        first = std::lower_bound(rows_->begin(), rows_->end(), static_cast<uint32_t>(first)) - rows_->begin();
+    }
+    return static_cast<int>(first);
+}
+
+int CanTraceModel::rowCount(const QModelIndex & parent) const
+{
+    if (parent.isValid() || !trace_)
+    {
+        return 0;
+    }
+    std::size_t rows = rows_ ? rows_->size() : trace_->size();
+    return static_cast<int>(std::min<std::size_t>(rows, std::numeric_limits<int>::max()));
+}
+
+int CanTraceModel::columnCount(const QModelIndex & /*parent*/) const { return 5; }
+
+QVariant CanTraceModel::data(const QModelIndex & index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= rowCount(QModelIndex()))
+    {
+        return QVariant();
+    }
+
+    if (role == Qt::FontRole && index.column() >= 2)
+    {
+        return QFont("monospace");
+    }
+    if (role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+
+    // Decode only the visible record
+    lt::network::CanTraceRecord record = (*trace_)[this->record(index.row())];
+
+    switch (index.column())
+    {
+    case 0:
+        // Time relative to the start of the trace
+        return QString::number(static_cast<double>(record.timestamp - trace_->timestamp(0)) / 1e9, 'f', 6);
+    case 1:
+        return record.direction == lt::network::CanMessageDirection::Outbound ? tr("Tx") : tr("Rx");
+    case 2:
+        return QString::number(record.message.id(), 16).toUpper();
+    case 3:
+        return record.message.length();
+    case 4: {
+        QString bytes;
+        for (uint8_t i = 0; i < record.message.length(); ++i)
+        {
+            if (i != 0)
+            {
+                bytes += ' ';
+            }
+            bytes += QString::number(record.message[i], 16).rightJustified(2, '0').toUpper();
+        }
+        return bytes;
+    }
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+QVariant CanTraceModel::headerData(int section, Qt::Orientation orientation,
+                                   int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+    {
+        return QVariant();
+    }
+
+    switch (section)
+    {
+    case 0:
+        return tr("Time");
+    case 1:
+        return tr("Direction");
+    case 2:
+        return tr("ID");
+    case 3:
+        return tr("Length");
+    case 4:
+        return tr("Data");
+    default:
+        break;
+    }
+    return QVariant();
+}
@@ -0,0 +1,54 @@
+#ifndef CANTRACEMODEL_H
+#define CANTRACEMODEL_H
+
+#include "lt/network/can/cantraceindex.h"
+
+#include <QAbstractTableModel>
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+/* Table of the frames of a binary CAN trace. Rows are decoded from the
+ * mapped file only when the view asks for them, so captures with millions
+ * of frames scroll without loading the whole trace. */
+class CanTraceModel : public QAbstractTableModel
+{
+public:
+    CanTraceModel() = default;
+
+    // Opens a trace and builds its index. Throws if it cannot be read.
+    void setTrace(const std::filesystem::path & path);
+    void clear();
+
+    // Shows only the frames matching `filter`
+    void setFilter(const lt::network::CanTraceFilter & filter);
+    void clearFilter();
+
+    // Index of the trace; null if no trace is open
+    inline const lt::network::CanTraceIndex * index() const noexcept { return index_.get(); }
+
+    // Trace record shown in `row`
+    std::size_t record(int row) const noexcept;
+
+    // First row at or after `timestamp`
+    int find(uint64_t timestamp) const noexcept;
+
+private:
+    std::unique_ptr<lt::network::CanTraceReader> trace_;
+    // References trace_
+    std::unique_ptr<lt::network::CanTraceIndex> index_;
+    // Records shown when filtered
+    std::optional<std::vector<uint32_t>> rows_;
+
+    // QAbstractItemModel interface
+public:
+    virtual int rowCount(const QModelIndex & parent) const override;
+    virtual int columnCount(const QModelIndex & parent) const override;
+    virtual QVariant data(const QModelIndex & index, int role) const override;
+    virtual QVariant headerData(int section, Qt::Orientation orientation,
+                                int role) const override;
+};
+
+#endif // CANTRACEMODEL_H
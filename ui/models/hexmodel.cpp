@@ -0,0 +1,142 @@
+#include "hexmodel.h"
+
+#include <QColor>
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+// Text of every byte value, built once
+const std::array<QString, 256> & byteText()
+{
+    static const std::array<QString, 256> text = []() {
+        std::array<QString, 256> text;
+        for (int i = 0; i < 256; ++i)
+            text[i] = QStringLiteral("%1").arg(i, 2, 16, QLatin1Char('0')).toUpper();
+        return text;
+    }();
+    return text;
+}
+
+QString regionText(const lt::Region & region)
+{
+    QString kind = region.kind == lt::RegionKind::Table ? QObject::tr("Table") : QObject::tr("Axis");
+    return kind + ": " + QString::fromStdString(region.name.empty() ? region.id : region.name);
+}
+} // namespace
+
+void HexModel::setDocument(lt::HexDocument document)
+{
+    beginResetModel();
+    document_ = std::move(document);
+    endResetModel();
+}
+
+void HexModel::invalidate(std::size_t offset, std::size_t length)
+{
+    if (length == 0 || offset >= document_.size())
+        return;
+
+    document_.invalidate(offset, length);
+    // Differences are tracked per page, so whole pages may change
+    constexpr std::size_t pageSize = lt::HexDocument::pageSize;
+    std::size_t begin = offset / pageSize * pageSize;
+    std::size_t end = std::min(document_.size(), (offset + length + pageSize - 1) / pageSize * pageSize);
+    emit dataChanged(index(static_cast<int>(begin / bytesPerRow), 0),
+                     index(static_cast<int>((end - 1) / bytesPerRow), asciiColumn));
+}
+
+int HexModel::rowCount(const QModelIndex & parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return static_cast<int>((document_.size() + bytesPerRow - 1) / bytesPerRow);
+}
+
+int HexModel::columnCount(const QModelIndex & parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return bytesPerRow + 1;
+}
+
+QVariant HexModel::data(const QModelIndex & index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    std::size_t offset = static_cast<std::size_t>(index.row()) * bytesPerRow;
+    if (index.column() == asciiColumn)
+        return asciiData(offset, role);
+
+    offset += static_cast<std::size_t>(index.column());
+    if (offset >= document_.size())
+        return QVariant();
+    return byteData(offset, role);
+}
+
+QVariant HexModel::byteData(std::size_t offset, int role) const
+{
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return byteText()[document_.read(offset, 1)[0]];
+    case Qt::BackgroundColorRole:
+        if (document_.differs(offset))
+            return QColor(255, 170, 170);
+        if (const lt::Region * region = document_.regions().find(offset))
+            return region->kind == lt::RegionKind::Table ? QColor(205, 225, 255) : QColor(210, 245, 210);
+        return QVariant();
+    case Qt::ForegroundRole:
+        if (document_.differs(offset) || document_.regions().find(offset) != nullptr)
+            return QColor(0, 0, 0);
+        return QVariant();
+    case Qt::ToolTipRole:
+    {
+        QString tip = "0x" + QStringLiteral("%1").arg(offset, 8, 16, QLatin1Char('0')).toUpper();
+        if (const lt::Region * region = document_.regions().find(offset))
+            tip += "\n" + regionText(*region);
+        if (document_.differs(offset))
+            tip += "\n" + QObject::tr("Modified");
+        return tip;
+    }
+    default:
+        return QVariant();
+    }
+}
+
+QVariant HexModel::asciiData(std::size_t offset, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    QString text;
+    for (uint8_t byte : document_.read(offset, bytesPerRow))
+        text += byte >= 0x20 && byte < 0x7F ? QChar(byte) : QChar('.');
+    return text;
+}
+
+QVariant HexModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    if (orientation == Qt::Vertical)
+        return QStringLiteral("%1").arg(static_cast<qulonglong>(section) * bytesPerRow, 8, 16, QLatin1Char('0')).toUpper();
+
+    if (section == asciiColumn)
+        return tr("ASCII");
+    return byteText()[section];
+}
+
+Qt::ItemFlags HexModel::flags(const QModelIndex & index) const
+{
+    if (index.isValid())
+    {
+        return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemNeverHasChildren;
+    }
+    return Qt::NoItemFlags;
+}
@@ -0,0 +1,39 @@
+#ifndef HEXMODEL_H
+#define HEXMODEL_H
+
+#include "lt/rom/hexdocument.h"
+#include <QAbstractTableModel>
+
+/* Rows of 16 bytes of a HexDocument plus their ASCII text. Bytes are read
+ * from the document as rows are painted, so only visible rows cost
+ * anything. Bytes that differ from the base ROM and bytes inside tables
+ * and axes are highlighted. */
+class HexModel : public QAbstractTableModel
+{
+public:
+    static constexpr int bytesPerRow = 16;
+    static constexpr int asciiColumn = bytesPerRow;
+
+    HexModel() = default;
+
+    void setDocument(lt::HexDocument document);
+    inline const lt::HexDocument & document() const noexcept { return document_; }
+
+    // Recomputes the differences of a range after it was written
+    void invalidate(std::size_t offset, std::size_t length);
+
+    virtual int rowCount(const QModelIndex & parent) const override;
+    virtual int columnCount(const QModelIndex & parent) const override;
+    virtual QVariant data(const QModelIndex & index, int role) const override;
+    virtual QVariant headerData(int section, Qt::Orientation orientation,
+                                int role) const override;
+    virtual Qt::ItemFlags flags(const QModelIndex & index) const override;
+
+private:
+    lt::HexDocument document_;
+
+    QVariant byteData(std::size_t offset, int role) const;
+    QVariant asciiData(std::size_t offset, int role) const;
+};
+
+#endif
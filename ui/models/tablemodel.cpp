@@ -1,22 +1,109 @@
 #include "tablemodel.h"
 
-#include <QColor>
+#include <QFont>
+#include <QLocale>
+#include <QThread>
 
+#include <algorithm>
 #include <cmath>
 
+namespace
+{
+QVector<QString> axisHeaders(const lt::AxisPtr & axis, int count)
+{
+    QVector<QString> headers;
+    if (!axis)
+        return headers;
+
+    headers.reserve(count);
+    for (int i = 0; i < count; ++i)
+        headers.append(QString::number(std::floor(axis->index(i) * 100.0) / 100.0));
+    return headers;
+}
+} // namespace
+
 void TableModel::setTable(lt::Table * table) noexcept
 {
     beginResetModel();
+    changedConnection_.reset();
+    // Drops changes of the previous table still queued
+    ++generation_;
     table_ = table;
+    cells_.clear();
+    columnHeaders_.clear();
+    rowHeaders_.clear();
+    width_ = 0;
+    height_ = 0;
+
+    if (table_ != nullptr)
+    {
+        width_ = table_->width();
+        height_ = table_->height();
+        cells_.resize(static_cast<std::size_t>(width_) * height_);
+        columnHeaders_ = axisHeaders(table_->xAxis(), width_);
+        rowHeaders_ = axisHeaders(table_->yAxis(), height_);
+        updateCells(lt::CellRange{0, 0, height_, width_});
+
+        changedConnection_ = table_->onChanged(
+            [this, generation = generation_](lt::CellRange range) { tableChanged(range, generation); });
+    }
     endResetModel();
 }
 
+void TableModel::updateCells(const lt::CellRange & range)
+{
+    const double minimum = table_->minimum();
+    const double span = table_->maximum() - minimum;
+    const bool hasBase = table_->hasBase();
+    const QLocale locale;
+
+    std::vector<double> values(range.width);
+    std::vector<double> base(range.width);
+    for (int row = range.row; row < range.row + range.height; ++row)
+    {
+        const int first = row * width_ + range.column;
+        table_->getRange(first, range.width, values.data());
+        table_->getBaseRange(first, range.width, base.data());
+
+        for (int i = 0; i < range.width; ++i)
+        {
+            Cell & cell = cells_[first + i];
+            cell.value = values[i];
+            cell.base = base[i];
+            cell.modified = hasBase && values[i] != base[i];
+            cell.text = locale.toString(values[i]);
+
+            double ratio = span == 0.0 ? 0.0 : std::clamp((values[i] - minimum) / span, 0.0, 1.0);
+            cell.background = QColor::fromHsvF((1.0 - ratio) * (1.0 / 3.0), 1.0, 1.0);
+        }
+    }
+}
+
+void TableModel::tableChanged(const lt::CellRange & range, uint64_t generation)
+{
+    // Tables may be changed from other threads
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(
+            this, [this, range, generation]() { tableChanged(range, generation); }, Qt::QueuedConnection);
+        return;
+    }
+
+    // The table may have been replaced while the call was queued
+    if (generation != generation_ || table_ == nullptr || range.width <= 0 || range.height <= 0)
+        return;
+
+    updateCells(range);
+    emit dataChanged(index(range.row, range.column),
+                     index(range.row + range.height - 1, range.column + range.width - 1));
+}
+
 int TableModel::rowCount(const QModelIndex & parent) const
 {
     if (table_ == nullptr || parent.isValid())
         return 0;
 
-    return table_->height();
+    return height_;
 }
 
 int TableModel::columnCount(const QModelIndex & parent) const
@@ -24,7 +111,7 @@ int TableModel::columnCount(const QModelIndex & parent) const
     if (table_ == nullptr || parent.isValid())
         return 0;
 
-    return table_->width();
+    return width_;
 }
 
 QVariant TableModel::data(const QModelIndex & index, int role) const
@@ -32,38 +119,44 @@ QVariant TableModel::data(const QModelIndex & index, int role) const
     if (table_ == nullptr || !index.isValid())
         return QVariant();
 
-    if (role != Qt::UserRole && role != Qt::DisplayRole && role != Qt::BackgroundColorRole &&
-        role != Qt::ForegroundRole)
-        return QVariant();
-
-    if (index.row() < 0 || index.row() >= table_->height() || index.column() < 0 || index.column() >= table_->width())
+    if (index.row() < 0 || index.row() >= height_ || index.column() < 0 || index.column() >= width_)
         return QVariant();
 
-    if (role == Qt::DisplayRole)
-        return table_->get(index.row(), index.column());
-
-    if (role == Qt::ForegroundRole)
+    const Cell & cell = cells_[index.row() * width_ + index.column()];
+    switch (role)
     {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        return cell.text;
+    case ValueRole:
+        return cell.value;
+    case BaseValueRole:
+        if (!table_->hasBase())
+            return QVariant();
+        return cell.base;
+    case Qt::ForegroundRole:
         if (table_->isScalar())
             return QVariant();
-
         return QColor(0, 0, 0);
-    }
-
-    if (role == Qt::BackgroundColorRole)
-    {
+    case Qt::BackgroundColorRole:
         if (table_->isScalar())
             return QVariant();
-
-        double diff = table_->maximum() - table_->minimum();
-        if (diff == 0.0)
-            return QColor::fromHsvF((1.0 / 3.0), 1.0, 1.0);
-        double ratio = static_cast<double>(table_->get(index.row(), index.column()) - table_->minimum()) / diff;
-        ratio = std::clamp(ratio, 0.0, 1.0);
-        return QColor::fromHsvF((1.0 - ratio) * (1.0 / 3.0), 1.0, 1.0);
+        return cell.background;
+    case Qt::FontRole:
+        if (cell.modified)
+        {
+            QFont font;
+            font.setBold(true);
+            return font;
+        }
+        return QVariant();
+    case Qt::ToolTipRole:
+        if (cell.modified)
+            return tr("Base: %1").arg(QLocale().toString(cell.base));
+        return QVariant();
+    default:
+        return QVariant();
     }
-
-    return QVariant();
 }
 
 QVariant TableModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -71,16 +164,11 @@ QVariant TableModel::headerData(int section, Qt::Orientation orientation, int ro
     if (table_ == nullptr || role != Qt::DisplayRole)
         return QVariant();
 
-    lt::AxisPtr axis;
-    if (orientation == Qt::Horizontal)
-        axis = table_->xAxis();
-    else if (orientation == Qt::Vertical)
-        axis = table_->yAxis();
-
-    if (!axis)
+    const QVector<QString> & headers = orientation == Qt::Horizontal ? columnHeaders_ : rowHeaders_;
+    if (section < 0 || section >= headers.size())
         return QVariant();
 
-    return QString::number(std::floor(axis->index(section) * 100.0) / 100.0);
+    return headers[section];
 }
 
 bool TableModel::setData(const QModelIndex & index, const QVariant & value, int role)
@@ -91,16 +179,18 @@ bool TableModel::setData(const QModelIndex & index, const QVariant & value, int
     if (role != Qt::EditRole)
         return false;
 
-    if (index.row() < 0 || index.row() >= table_->height() || index.column() < 0 || index.column() >= table_->width())
+    if (index.row() < 0 || index.row() >= height_ || index.column() < 0 || index.column() >= width_)
         return false;
 
     bool ok;
-    double val = value.toDouble(&ok);
+    double val = QLocale().toDouble(value.toString(), &ok);
+    if (!ok)
+        val = value.toDouble(&ok);
     if (!ok)
         return false;
 
+    // The table reports the change, which updates the snapshot
     table_->set(index.row(), index.column(), val);
-    emit dataChanged(index, index);
     return true;
 }
 
@@ -112,3 +202,11 @@ Qt::ItemFlags TableModel::flags(const QModelIndex & index) const
     }
     return Qt::NoItemFlags;
 }
+
+QHash<int, QByteArray> TableModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractTableModel::roleNames();
+    roles.insert(ValueRole, "value");
+    roles.insert(BaseValueRole, "base");
+    return roles;
+}
@@ -3,10 +3,23 @@
 
 #include "lt/rom/table.h"
 #include <QAbstractTableModel>
+#include <QColor>
+#include <QString>
+#include <QVector>
 
+#include <vector>
+
+/* Model of a table backed by a snapshot of its decoded cells. Text and
+ * colours are computed once per change rather than per paint, and only
+ * the cells the table reports as changed are updated. */
 class TableModel : public QAbstractTableModel
 {
 public:
+    // Cell value as a double
+    static constexpr int ValueRole = Qt::UserRole;
+    // Value of the base cell as a double. Invalid if the table has no base.
+    static constexpr int BaseValueRole = Qt::UserRole + 1;
+
     TableModel() = default;
 
     void setTable(lt::Table * table) noexcept;
@@ -20,9 +33,34 @@ public:
     virtual bool setData(const QModelIndex & index, const QVariant & value,
                          int role) override;
     virtual Qt::ItemFlags flags(const QModelIndex & index) const override;
+    virtual QHash<int, QByteArray> roleNames() const override;
 
 private:
+    struct Cell
+    {
+        double value{0.0};
+        double base{0.0};
+        QString text;
+        QColor background;
+        // True if the value differs from the base
+        bool modified{false};
+    };
+
     lt::Table * table_{nullptr};
+    int width_{0};
+    int height_{0};
+    std::vector<Cell> cells_;
+    QVector<QString> columnHeaders_;
+    QVector<QString> rowHeaders_;
+    lt::Table::ChangedEvent::ConnectionPtr changedConnection_;
+    // Incremented by setTable()
+    uint64_t generation_{0};
+
+    // Decodes and formats the cells in `range`
+    void updateCells(const lt::CellRange & range);
+    /* Updates the snapshot after the table changed. Ignored if `generation`
+     * is from before the last setTable(). */
+    void tableChanged(const lt::CellRange & range, uint64_t generation);
 };
 
 #endif
@@ -19,21 +19,13 @@
 #include "timer.h"
 #include "timerrunloop.h"
 
-struct make_shared_enabler : public Timer
-{
-    template <typename... Args>
-    explicit make_shared_enabler(Args &&... args)
-        : Timer(std::forward<Args>(args)...)
-    {
-    }
-};
+#include <algorithm>
 
-Timer::Timer(Timer::Callback && cb) : callback_(std::move(cb)), active_(false)
-{
-}
+Timer::Timer(Timer::Callback && cb) : callback_(std::move(cb)) {}
 
 std::chrono::steady_clock::time_point Timer::nextTrigger() const
 {
+    std::lock_guard<std::mutex> lk(mutex_);
     return nextTrigger_;
 }
 
@@ -44,11 +36,17 @@ void Timer::setTimeout(std::chrono::milliseconds timeout)
     timeout_ = timeout;
     if (active_)
     {
-        // Reinsert
+        // Reschedule
         enable();
     }
 }
 
+void Timer::setRepeating(bool repeating)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    repeating_ = repeating;
+}
+
 Timer::~Timer()
 {
     // std::lock_guard<std::mutex> lk(mutex_);
@@ -58,13 +56,9 @@ void Timer::enable()
 {
     std::lock_guard<std::mutex> lk(mutex_);
     nextTrigger_ = std::chrono::steady_clock::now() + timeout_;
-    if (active_)
-    {
-        // nextTrigger may have changed, so remove and reinsert
-        TimerRunLoop::get().removeTimer(shared_from_this());
-    }
     active_ = true;
-    TimerRunLoop::get().addTimer(shared_from_this());
+    // Replaces any entry scheduled before
+    TimerRunLoop::get().schedule(shared_from_this(), nextTrigger_, ++generation_);
 }
 
 void Timer::disable()
@@ -75,35 +69,51 @@ void Timer::disable()
         return;
     }
     active_ = false;
-    TimerRunLoop::get().removeTimer(shared_from_this());
+    ++generation_;
+    TimerRunLoop::get().cancel(shared_from_this());
 }
 
 bool Timer::active() const { return active_; }
 
 bool Timer::running() const { return running_; }
 
-bool Timer::tryTrigger()
+bool Timer::trigger(uint64_t generation)
 {
-    if (nextTrigger_ < std::chrono::steady_clock::now())
     {
-        trigger();
-        return true;
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (!active_ || generation != generation_)
+        {
+            // Disabled or rescheduled after the entry expired
+            return false;
+        }
+
+        if (repeating_)
+        {
+            // Skip periods that were missed entirely
+            auto period = std::max(timeout_, std::chrono::milliseconds(1));
+            auto now = std::chrono::steady_clock::now();
+            nextTrigger_ += period;
+            if (nextTrigger_ < now)
+            {
+                nextTrigger_ += period * ((now - nextTrigger_) / period + 1);
+            }
+        }
+        else
+        {
+            // Cleared first so the callback may enable the timer again
+            active_ = false;
+        }
     }
-    return false;
-}
-
-void Timer::trigger()
-{
-    // Keep the timer alive
-    auto self = shared_from_this();
 
     running_ = true;
     if (callback_)
     {
         callback_();
     }
-    disable();
     running_ = false;
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    return repeating_ && active_ && generation == generation_;
 }
 
 TimerPtr Timer::create() { return std::make_shared<Timer>(); }
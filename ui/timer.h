@@ -28,10 +28,11 @@
 #include <thread>
 
 class TimerRunLoop;
+struct TimerEntry;
 
-/**
- * @todo write docs
- */
+/* Calls a callback from the timer thread after a timeout. One-shot unless
+ * repeating; repeating timers are rescheduled from their previous deadline
+ * so they do not drift. */
 class Timer : public std::enable_shared_from_this<Timer>
 {
     friend TimerRunLoop;
@@ -45,6 +46,9 @@ public:
     void setCallback(Callback && cb);
     void setTimeout(std::chrono::milliseconds timeout);
     std::chrono::milliseconds timeout() const { return timeout_; }
+    /* Fires every timeout until disabled */
+    void setRepeating(bool repeating);
+    bool repeating() const { return repeating_; }
     /* Starts the timeout timer */
     void enable();
     /* Stops the timeout timer */
@@ -64,22 +68,30 @@ public:
     explicit Timer(Callback && cb);
 
 protected:
-    bool tryTrigger();
-    void trigger();
+    /* Called from the timer thread when the entry scheduled with
+     * `generation` expires. Returns true if the timer repeats. */
+    bool trigger(uint64_t generation);
 
 private:
     std::chrono::milliseconds timeout_{};
 
     std::chrono::steady_clock::time_point nextTrigger_;
 
-    std::mutex mutex_;
+    mutable std::mutex mutex_;
 
     Callback callback_;
 
     // true if the timer is waiting
-    bool active_;
+    bool active_{false};
+    bool repeating_{false};
     // true if the timer is currently being triggered
     std::atomic<bool> running_{};
+    // Incremented by enable() and disable(); entries of older generations
+    // are stale
+    uint64_t generation_{0};
+
+    // Scheduled entry. Only used by the timer thread.
+    TimerEntry * entry_{nullptr};
 };
 using TimerPtr = std::shared_ptr<Timer>;
 
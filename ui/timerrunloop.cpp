@@ -19,8 +19,141 @@
 #include "timerrunloop.h"
 
 #include <algorithm>
+#include <utility>
 
-TimerRunLoop::TimerRunLoop() : running_(false) {}
+TimerWheel::~TimerWheel()
+{
+    for (auto & level : wheel_)
+    {
+        for (TimerEntry * entry : level)
+        {
+            while (entry != nullptr)
+            {
+                delete std::exchange(entry, entry->next);
+            }
+        }
+    }
+}
+
+void TimerWheel::insert(TimerEntry * entry)
+{
+    // Clamp to the range of the wheel. Clamped entries are placed again
+    // when cascaded.
+    uint64_t delta = entry->expiry > current_ ? entry->expiry - current_ : 0;
+    delta = std::min<uint64_t>(delta, (uint64_t{1} << (levels * slotBits)) - 1);
+    const uint64_t expiry = current_ + delta;
+
+    int level = 0;
+    while (level + 1 < levels && delta >= (uint64_t{1} << ((level + 1) * slotBits)))
+    {
+        ++level;
+    }
+
+    entry->level = level;
+    entry->index = static_cast<int>((expiry >> (level * slotBits)) & (slots - 1));
+    TimerEntry *& head = wheel_[level][entry->index];
+    entry->prev = nullptr;
+    entry->next = head;
+    if (head != nullptr)
+    {
+        head->prev = entry;
+    }
+    head = entry;
+
+    ++size_;
+    if (level != 0)
+    {
+        ++upper_;
+    }
+}
+
+void TimerWheel::remove(TimerEntry * entry)
+{
+    if (entry->prev != nullptr)
+    {
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        wheel_[entry->level][entry->index] = entry->next;
+    }
+    if (entry->next != nullptr)
+    {
+        entry->next->prev = entry->prev;
+    }
+    entry->prev = entry->next = nullptr;
+
+    --size_;
+    if (entry->level != 0)
+    {
+        --upper_;
+    }
+}
+
+void TimerWheel::cascade(int level)
+{
+    const auto index = (current_ >> (level * slotBits)) & (slots - 1);
+    TimerEntry * entry = std::exchange(wheel_[level][index], nullptr);
+    while (entry != nullptr)
+    {
+        TimerEntry * next = entry->next;
+        --size_;
+        --upper_;
+        insert(entry);
+        entry = next;
+    }
+}
+
+void TimerWheel::advance(uint64_t tick, std::vector<TimerEntry *> & expired)
+{
+    while (current_ <= tick)
+    {
+        if (size_ == 0)
+        {
+            // Nothing to cascade or expire
+            current_ = tick + 1;
+            break;
+        }
+
+        // Cascade every level whose lower levels wrapped, top down
+        if ((current_ & (slots - 1)) == 0)
+        {
+            int top = 1;
+            while (top + 1 < levels && (current_ & ((uint64_t{1} << ((top + 1) * slotBits)) - 1)) == 0)
+            {
+                ++top;
+            }
+            for (int level = top; level > 0; --level)
+            {
+                cascade(level);
+            }
+        }
+
+        TimerEntry * entry = std::exchange(wheel_[0][current_ & (slots - 1)], nullptr);
+        for (; entry != nullptr; entry = entry->next)
+        {
+            expired.emplace_back(entry);
+            --size_;
+        }
+        ++current_;
+    }
+}
+
+uint64_t TimerWheel::nextTick() const
+{
+    // A cascade is due at the next turn of the first level
+    uint64_t next = upper_ != 0 ? (current_ + slots - 1) & ~(slots - 1) : UINT64_MAX;
+    for (uint64_t tick = current_; tick < current_ + slots && tick < next; ++tick)
+    {
+        if (wheel_[0][tick & (slots - 1)] != nullptr)
+        {
+            return tick;
+        }
+    }
+    return next;
+}
+
+TimerRunLoop::TimerRunLoop() : epoch_(Clock::now()), running_(false) {}
 
 TimerRunLoop & TimerRunLoop::get()
 {
@@ -28,60 +161,145 @@ TimerRunLoop & TimerRunLoop::get()
     return trl;
 }
 
-void TimerRunLoop::addTimer(const std::shared_ptr<Timer> & timer)
+uint64_t TimerRunLoop::toTick(Clock::time_point time) const
 {
-    std::lock_guard<std::mutex> lk(mutex_);
-    queue_.insert(timer);
-    wake_.notify_all();
+    if (time <= epoch_)
+    {
+        return 0;
+    }
+    // Round up so timers never fire early
+    auto ms = std::chrono::ceil<std::chrono::milliseconds>(time - epoch_);
+    return static_cast<uint64_t>(ms.count());
 }
 
-void TimerRunLoop::removeTimer(const std::shared_ptr<Timer> & timer)
+TimerRunLoop::Clock::time_point TimerRunLoop::toTime(uint64_t tick) const
 {
-    std::lock_guard<std::mutex> lk(mutex_);
-    queue_.erase(std::weak_ptr<Timer>(timer));
-    wake_.notify_all();
+    return epoch_ + std::chrono::milliseconds(tick);
 }
 
-void TimerRunLoop::runLoop()
+void TimerRunLoop::schedule(std::shared_ptr<Timer> timer, Clock::time_point deadline, uint64_t generation)
 {
-    std::unique_lock<std::mutex> lk(mutex_);
-    while (running_)
+    push(new Command{std::move(timer), generation, toTick(deadline), nullptr});
+}
+
+void TimerRunLoop::cancel(std::shared_ptr<Timer> timer)
+{
+    push(new Command{std::move(timer), 0, 0, nullptr});
+}
+
+void TimerRunLoop::push(Command * command)
+{
+    // The command belongs to the worker once published
+    Command * head = commands_.load(std::memory_order_relaxed);
+    do
+    {
+        command->next = head;
+    } while (!commands_.compare_exchange_weak(head, command, std::memory_order_release, std::memory_order_relaxed));
+
+    if (head == nullptr)
     {
-        if (queue_.empty())
+        // The worker may be about to sleep. Locking waits until it does so
+        // the notification is not lost.
         {
-            wake_.wait(lk);
-            continue;
+            std::lock_guard<std::mutex> lk(mutex_);
         }
+        wake_.notify_one();
+    }
+}
+
+void TimerRunLoop::applyCommands()
+{
+    // The stack is in reverse order of submission
+    Command * reversed = commands_.exchange(nullptr, std::memory_order_acquire);
+    Command * command = nullptr;
+    while (reversed != nullptr)
+    {
+        Command * next = reversed->next;
+        reversed->next = command;
+        command = reversed;
+        reversed = next;
+    }
 
-        auto begin = queue_.begin();
-        std::chrono::steady_clock::time_point nextTrigger;
-        if (auto ptr = begin->lock())
+    while (command != nullptr)
+    {
+        Timer & timer = *command->timer;
+        TimerEntry * entry = std::exchange(timer.entry_, nullptr);
+        if (entry != nullptr)
         {
-            lk.unlock();
-            if (ptr->tryTrigger())
+            wheel_.remove(entry);
+        }
+
+        if (command->generation != 0)
+        {
+            if (entry == nullptr)
             {
-                lk.lock();
-                continue;
+                entry = new TimerEntry;
+                entry->timer = command->timer;
             }
-            nextTrigger = ptr->nextTrigger();
-            /* We don't want to keep the shared_ptr around while waiting, so
-             * wait and then lock the weak pointer again */
-            lk.lock();
+            entry->expiry = command->expiry;
+            entry->generation = command->generation;
+            wheel_.insert(entry);
+            timer.entry_ = entry;
         }
         else
         {
-            // Dead
-            queue_.erase(begin);
+            delete entry;
+        }
+
+        delete std::exchange(command, command->next);
+    }
+}
+
+void TimerRunLoop::fire(std::vector<TimerEntry *> & expired)
+{
+    for (TimerEntry * entry : expired)
+    {
+        auto timer = entry->timer.lock();
+        if (!timer || timer->entry_ != entry)
+        {
+            // Destroyed
+            delete entry;
             continue;
         }
-        std::weak_ptr<Timer> weak = *begin;
-        wake_.wait_until(lk, nextTrigger);
-        lk.unlock();
-        if (auto ptr = weak.lock())
+        timer->entry_ = nullptr;
+
+        if (timer->trigger(entry->generation))
+        {
+            // Reuse the entry for the next period
+            entry->expiry = toTick(timer->nextTrigger());
+            wheel_.insert(entry);
+            timer->entry_ = entry;
+        }
+        else
+        {
+            delete entry;
+        }
+    }
+    expired.clear();
+}
+
+void TimerRunLoop::runLoop()
+{
+    std::vector<TimerEntry *> expired;
+    auto ready = [this]() { return !running_ || commands_.load() != nullptr; };
+
+    while (running_)
+    {
+        applyCommands();
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - epoch_);
+        wheel_.advance(static_cast<uint64_t>(elapsed.count()), expired);
+        fire(expired);
+
+        std::unique_lock<std::mutex> lk(mutex_);
+        if (wheel_.empty())
+        {
+            wake_.wait(lk, ready);
+        }
+        else
         {
-            ptr->tryTrigger();
+            wake_.wait_until(lk, toTime(wheel_.nextTick()), ready);
         }
-        lk.lock();
     }
 }
 
@@ -98,9 +316,15 @@ void TimerRunLoop::startWorker()
 
 void TimerRunLoop::stopWorker()
 {
-    running_ = false;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        running_ = false;
+    }
     wake_.notify_all();
-    worker_.join();
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
 }
 
 TimerRunLoop::~TimerRunLoop()
@@ -109,4 +333,10 @@ TimerRunLoop::~TimerRunLoop()
     {
         stopWorker();
     }
+
+    Command * command = commands_.exchange(nullptr);
+    while (command != nullptr)
+    {
+        delete std::exchange(command, command->next);
+    }
 }
@@ -20,21 +20,83 @@
 #define LIBRETUNER_TIMERRUNLOOP_H
 
 #include "timer.h"
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <mutex>
-#include <set>
+#include <thread>
+#include <vector>
 
 class Timer;
 
-class TimerRunLoop
+// Timer scheduled in a wheel slot
+struct TimerEntry
+{
+    std::weak_ptr<Timer> timer;
+    uint64_t expiry;
+    uint64_t generation;
+    // Position in the wheel
+    int level{0};
+    int index{0};
+    TimerEntry * prev{nullptr};
+    TimerEntry * next{nullptr};
+};
+
+/* Hierarchical timing wheel with 1ms ticks: four levels of 256 slots, each
+ * slot of a level covering a whole turn of the level below. Inserting and
+ * removing are O(1); when a lower level wraps, the next slot of the level
+ * above is cascaded down. Deadlines up to ~49 days can be represented;
+ * later ones are clamped. Not thread safe. */
+class TimerWheel
 {
 public:
-    static TimerRunLoop & get();
+    static constexpr int levels = 4;
+    static constexpr int slotBits = 8;
+    static constexpr uint64_t slots = 1u << slotBits;
+
+    TimerWheel() = default;
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel & operator=(const TimerWheel &) = delete;
 
-    void addTimer(const std::shared_ptr<Timer> & timer);
+    // Inserts an entry. Past deadlines expire at the next tick.
+    void insert(TimerEntry * entry);
+    void remove(TimerEntry * entry);
+
+    /* Expires every tick up to and including `tick`, appending the expired
+     * entries to `expired`. The entries are no longer in the wheel. */
+    void advance(uint64_t tick, std::vector<TimerEntry *> & expired);
+
+    /* Earliest tick the wheel must be advanced to, either for an expiring
+     * entry or for a cascade. Only valid if not empty. */
+    uint64_t nextTick() const;
+
+    // Next tick that has not been processed
+    inline uint64_t current() const noexcept { return current_; }
+    inline std::size_t size() const noexcept { return size_; }
+    inline bool empty() const noexcept { return size_ == 0; }
+
+private:
+    std::array<std::array<TimerEntry *, slots>, levels> wheel_{};
+    uint64_t current_{0};
+    std::size_t size_{0};
+    // Entries in levels above the first
+    std::size_t upper_{0};
+
+    void cascade(int level);
+};
 
-    void removeTimer(const std::shared_ptr<Timer> & timer);
+/* Runs timers on a single thread. Timers are scheduled and canceled
+ * through a lock-free command stack that the thread applies to its wheel,
+ * so enabling a timer never waits on the thread. Expired timers are
+ * collected per wake-up and triggered together. */
+class TimerRunLoop
+{
+public:
+    static TimerRunLoop & get();
 
     void startWorker();
     void stopWorker();
@@ -42,33 +104,41 @@ public:
     ~TimerRunLoop();
 
 private:
-    TimerRunLoop();
+    friend Timer;
 
-    void runLoop();
+    TimerRunLoop();
 
-    struct TCompare
+    struct Command
     {
-        bool operator()(const std::weak_ptr<Timer> & first,
-                        const std::weak_ptr<Timer> & second) const
-        {
-            if (auto pfirst = first.lock())
-            {
-                if (auto psecond = second.lock())
-                {
-                    return pfirst->nextTrigger() < psecond->nextTrigger();
-                }
-                else
-                {
-                    return false;
-                }
-            }
-            return true;
-        }
+        std::shared_ptr<Timer> timer;
+        // Cancels the timer if zero
+        uint64_t generation;
+        uint64_t expiry;
+        Command * next;
     };
 
+    using Clock = std::chrono::steady_clock;
+
+    // Replaces the scheduled entry of `timer`
+    void schedule(std::shared_ptr<Timer> timer, Clock::time_point deadline, uint64_t generation);
+    void cancel(std::shared_ptr<Timer> timer);
+
+    void push(Command * command);
+    void applyCommands();
+    void fire(std::vector<TimerEntry *> & expired);
+
+    // First tick at or after `time`
+    uint64_t toTick(Clock::time_point time) const;
+    Clock::time_point toTime(uint64_t tick) const;
+
+    void runLoop();
+
+    Clock::time_point epoch_;
+    TimerWheel wheel_;
+    std::atomic<Command *> commands_{nullptr};
+
     std::mutex mutex_;
     std::condition_variable wake_;
-    std::multiset<std::weak_ptr<Timer>, TCompare> queue_;
     std::thread worker_;
 
     std::atomic<bool> running_;
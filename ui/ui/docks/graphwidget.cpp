@@ -95,6 +95,8 @@ void GraphWidget::refresh()
         auto * modelProxy =
             new QtDataVisualization::QItemModelSurfaceDataProxy(model_);
         modelProxy->setUseModelCategories(true);
+        // The display role holds formatted text
+        modelProxy->setValueRole(QStringLiteral("value"));
         series3d_->setDrawMode(
             QtDataVisualization::QSurface3DSeries::DrawSurfaceAndWireframe);
 
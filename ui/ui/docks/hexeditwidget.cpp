@@ -1,67 +1,49 @@
 #include "hexeditwidget.h"
 
-#include <QByteArray>
+#include <QFontDatabase>
 #include <QHBoxLayout>
-#include <QIODevice>
+#include <QHeaderView>
+#include <QTableView>
 
-/*
 HexEditWidget::HexEditWidget(QWidget * parent) : QWidget(parent)
 {
-    buffer_ = new RomHexBuffer;
-
-    auto *document = new QHexDocument(buffer_);
-    auto *hexView = new QHexView;
-    hexView->setDocument(document);
-
-    auto *layout = new QHBoxLayout;
+    view_ = new QTableView;
+    view_->setModel(&model_);
+    view_->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    view_->setShowGrid(false);
+    view_->setSelectionMode(QAbstractItemView::ContiguousSelection);
+
+    // Fixed sizes keep the view from measuring every row of large images
+    QFontMetrics metrics(view_->font());
+    view_->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    view_->verticalHeader()->setDefaultSectionSize(metrics.height() + 4);
+    view_->horizontalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    view_->horizontalHeader()->setDefaultSectionSize(metrics.horizontalAdvance(QStringLiteral("000")));
+    view_->horizontalHeader()->setMinimumSectionSize(0);
+    view_->setColumnWidth(HexModel::asciiColumn,
+                          metrics.horizontalAdvance(QString(HexModel::bytesPerRow + 2, QChar('0'))));
+
+    auto * layout = new QHBoxLayout;
     layout->setContentsMargins(0, 0, 0, 0);
-
-    layout->addWidget(hexView);
-
+    layout->addWidget(view_);
     setLayout(layout);
 }
 
-int RomHexBuffer::length() const
+void HexEditWidget::setRom(const lt::RomPtr & rom)
 {
-    if (!rom_)
-    {
-        return 0;
-    }
-
-    return rom_->size();
+    writeConnection_.reset();
+    model_.setDocument(lt::HexDocument(rom));
 }
 
-void RomHexBuffer::insert(int offset, const QByteArray & data) {}
-
-void RomHexBuffer::remove(int offset, int length) {}
-
-QByteArray RomHexBuffer::read(int offset, int length)
+void HexEditWidget::setTune(const lt::TunePtr & tune)
 {
-    if (!rom_)
+    writeConnection_.reset();
+    model_.setDocument(lt::HexDocument(tune));
+    if (tune)
     {
-        return QByteArray();
+        // Tunes are edited on the UI thread
+        writeConnection_ = tune->onDataWritten([this](int offset, int size) {
+            model_.invalidate(static_cast<std::size_t>(offset), static_cast<std::size_t>(size));
+        });
     }
-    if (offset < 0)
-    {
-        return QByteArray();
-    }
-    if (offset >= rom_->size())
-    {
-        return QByteArray();
-    }
-    int size = std::min<int>(rom_->size() - offset, length);
-
-    return QByteArray(reinterpret_cast<const char *>(&rom_->data()[offset]),
-                      size);
 }
-
-void RomHexBuffer::read(QIODevice * iodevice) {}
-
-void RomHexBuffer::write(QIODevice * iodevice)
-{
-    if (!rom_)
-    {
-        return;
-    }
-    iodevice->write(reinterpret_cast<const char *>(rom_->data()), rom_->size());
-}*/
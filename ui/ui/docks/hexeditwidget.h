@@ -2,44 +2,28 @@
 #define LIBRETUNER_HEXEDITWIDGET_H
 
 #include <QWidget>
-#include <qhexview.h>
 
 #include "lt/rom/rom.h"
-/*
-class RomHexBuffer : public QHexBuffer
-{
-    Q_OBJECT
-public:
-    explicit RomHexBuffer(lt::RomPtr rom = lt::RomPtr()) : rom_(std::move(rom))
-    {
-    }
-
-    int length() const override;
-    void insert(int offset, const QByteArray & data) override;
-    void remove(int offset, int length) override;
-    QByteArray read(int offset, int length) override;
-    void read(QIODevice * iodevice) override;
-    void write(QIODevice * iodevice) override;
+#include "models/hexmodel.h"
 
-    inline void setRom(lt::RomPtr rom) noexcept { rom_ = std::move(rom); }
-
-private:
-    lt::RomPtr rom_;
-};
+class QTableView;
 
+/* Hex view of ROM or tune data. Tune bytes that differ from the base ROM
+ * and table and axis regions are highlighted, and updated as the tune is
+ * written. */
 class HexEditWidget : public QWidget
 {
     Q_OBJECT
 public:
     explicit HexEditWidget(QWidget * parent = nullptr);
 
-    inline void setRom(lt::RomPtr rom) noexcept
-    {
-        buffer_->setRom(std::move(rom));
-    }
+    void setRom(const lt::RomPtr & rom);
+    void setTune(const lt::TunePtr & tune);
 
 private:
-    RomHexBuffer * buffer_;
-};*/
+    HexModel model_;
+    QTableView * view_;
+    lt::MemoryBuffer::WriteEvent::ConnectionPtr writeConnection_;
+};
 
 #endif // LIBRETUNER_HEXEDITWIDGET_H
@@ -25,6 +25,7 @@
 #include "docks/editorwidget.h"
 #include "docks/explorerwidget.h"
 #include "docks/graphwidget.h"
+#include "docks/hexeditwidget.h"
 #include "docks/logview.h"
 #include "docks/overviewwidget.h"
 #include "docks/sidebarwidget.h"
@@ -46,6 +47,7 @@
 #include <QAction>
 #include <QDockWidget>
 #include <QFileDialog>
+#include <QLabel>
 #include <QListView>
 #include <QMdiArea>
 #include <QMenu>
@@ -55,6 +57,7 @@
 #include <QScrollArea>
 #include <QSettings>
 #include <QStatusBar>
+#include <QTimer>
 #include <QWindowStateChangeEvent>
 
 #include <database/definitions.h>
@@ -86,6 +89,7 @@ MainWindow::MainWindow(QWidget * parent) : QMainWindow(parent), linksList_(LT()-
     sidebarDock_ = createSidebarDock();
     tablesDock_ = createTablesDock();
     explorerDock_ = createExplorerDock();
+    hexDock_ = createHexDock();
 
     restoreDocks();
 
@@ -136,6 +140,7 @@ void MainWindow::restoreDocks()
     // Top (central)
 
     tabifyDockWidget(overviewDock_, loggingDock_);
+    tabifyDockWidget(overviewDock_, hexDock_);
 }
 
 void MainWindow::loadSettings()
@@ -208,6 +213,26 @@ void MainWindow::setTune(const lt::TunePtr & tune)
     tune_ = tune;
     emit tuneChanged(tune_.get());
 
+    checksumConnection_.reset();
+    if (tune)
+    {
+        // Edits happen on the UI thread, so the label can be updated directly
+        checksumConnection_ = tune->checksums().onValidityChange([this](std::optional<bool> valid) {
+            if (valid)
+            {
+                updateChecksumStatus(*valid);
+                return;
+            }
+            // Recompute stale checksums once the edit is done rather than on every write
+            QTimer::singleShot(0, this, [this]() {
+                if (tune_)
+                    tune_->checksums().refresh();
+            });
+        });
+        updateChecksumStatus(tune->checksums().refresh());
+    }
+    checksumLabel_->setVisible(!!tune);
+
     flashCurrentAction_->setEnabled(!!tune);
     saveCurrentAction_->setEnabled(!!tune);
 
@@ -378,6 +403,19 @@ QDockWidget * MainWindow::createExplorerDock()
     return dock;
 }
 
+QDockWidget * MainWindow::createHexDock()
+{
+    QDockWidget * dock = new QDockWidget("Hex", this);
+    dock->setObjectName("hex");
+
+    hexEdit_ = new HexEditWidget(dock);
+    dock->setWidget(hexEdit_);
+
+    connect(this, &MainWindow::tuneChanged, [this](const lt::Tune *) { hexEdit_->setTune(tune_); });
+    docks_.emplace_back(dock);
+    return dock;
+}
+
 void MainWindow::setupMenu()
 {
     auto * menuBar = new QMenuBar;
@@ -539,10 +577,28 @@ void MainWindow::setupStatusBar()
         comboDatalink_->setCurrentText(QString::fromStdString(LT()->datalink()->name()));
     }
 
+    checksumLabel_ = new QLabel;
+    checksumLabel_->setVisible(false);
+
+    statusBar()->addPermanentWidget(checksumLabel_);
     statusBar()->addPermanentWidget(comboPlatform);
     statusBar()->addPermanentWidget(comboDatalink_);
 }
 
+void MainWindow::updateChecksumStatus(bool valid)
+{
+    if (valid)
+    {
+        checksumLabel_->setText(tr("Checksums valid"));
+        checksumLabel_->setStyleSheet("");
+    }
+    else
+    {
+        checksumLabel_->setText(tr("Checksums invalid (corrected on flash)"));
+        checksumLabel_->setStyleSheet("color: orange");
+    }
+}
+
 void MainWindow::on_buttonDownloadRom_clicked()
 {
     /*if (downloadWindow_) {
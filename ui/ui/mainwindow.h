@@ -32,6 +32,9 @@
 #include "models/tablemodel.h"
 #include "ui/windows/diagnosticswidget.h"
 
+#include <lt/rom/checksumstate.h>
+
+class QLabel;
 class QListView;
 class QMdiArea;
 
@@ -40,6 +43,7 @@ class TablesWidget;
 class TuneData;
 class SidebarWidget;
 class GraphWidget;
+class HexEditWidget;
 class DefinitionsWindow;
 class ExplorerWidget;
 class VehicleInformationWidget;
@@ -93,6 +97,7 @@ private:
 
     TablesWidget * tables_;
     ExplorerWidget * explorer_;
+    HexEditWidget * hexEdit_;
 
     QAction * flashCurrentAction_;
     QAction * saveCurrentAction_;
@@ -106,9 +111,11 @@ private:
     QDockWidget * editorDock_;
     QDockWidget * graphDock_;
     QDockWidget * explorerDock_;
+    QDockWidget * hexDock_;
 
     void setupMenu();
     void setupStatusBar();
+    void updateChecksumStatus(bool valid);
 
     void hideAllDocks();
     void restoreDocks();
@@ -124,11 +131,15 @@ private:
     QDockWidget * createSidebarDock();
     QDockWidget * createTablesDock();
     QDockWidget * createExplorerDock();
+    QDockWidget * createHexDock();
 
     std::vector<QDockWidget *> docks_;
 
     lt::TunePtr tune_;
 
+    QLabel * checksumLabel_;
+    lt::ChecksumState::ValidityConnectionPtr checksumConnection_;
+
     LinksListModel linksList_;
 
     DatalinksWidget datalinksWindow_;
@@ -6,6 +6,8 @@
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QLineEdit>
+#include <QMessageBox>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QVBoxLayout>
 
@@ -33,11 +35,15 @@ ImportRomDialog::ImportRomDialog(lt::ProjectPtr project, QWidget * parent)
 
     linePath_ = new QLineEdit;
     linePath_->setClearButtonEnabled(true);
-    auto * buttonBrowse = new QPushButton(style()->standardIcon(QStyle::SP_DirOpenIcon), QString());
+    auto * buttonBrowse = new QPushButton(style()->standardIcon(QStyle::SP_FileIcon), QString());
+    buttonBrowse->setToolTip(tr("Select a ROM file"));
+    auto * buttonBrowseDir = new QPushButton(style()->standardIcon(QStyle::SP_DirOpenIcon), QString());
+    buttonBrowseDir->setToolTip(tr("Select a directory of ROM files"));
 
     auto * pathLayout = new QHBoxLayout;
     pathLayout->addWidget(linePath_);
     pathLayout->addWidget(buttonBrowse);
+    pathLayout->addWidget(buttonBrowseDir);
 
     // Main options
     auto * form = new QFormLayout;
@@ -85,27 +91,144 @@ ImportRomDialog::ImportRomDialog(lt::ProjectPtr project, QWidget * parent)
         }
     });
 
+    connect(buttonBrowseDir, &QPushButton::clicked, [this]() {
+        QString path = QFileDialog::getExistingDirectory(nullptr, tr("Select directory of ROM files"),
+                                                         linePath_->text());
+        if (!path.isNull())
+            linePath_->setText(path);
+    });
+
     if (comboPlatform_->count() > 0)
         platformChanged(comboPlatform_->currentIndex());
 
-    connect(buttonImport, &QPushButton::clicked, [this]() {
-        QVariant var = comboPlatform_->currentData(Qt::UserRole);
-        if (!var.canConvert<lt::PlatformPtr>())
-            return;
-
-        auto platform = var.value<lt::PlatformPtr>();
-
-        catchWarning(
-            [&]() {
-                lt::ProjectPtr project = comboProject_->selectedProject();
-                if (!project)
-                    return;
-                // Import and save ROM
-                project->importRom(lineName_->text().toStdString(), linePath_->text().toStdString(), platform)->save();
-                accept();
-            },
-            tr("Error importing ROM"));
-    });
+    connect(buttonImport, &QPushButton::clicked, this, &ImportRomDialog::startImport);
+}
+
+ImportRomDialog::~ImportRomDialog()
+{
+    // Stop the import before the callbacks lose their target
+    import_.reset();
+}
+
+void ImportRomDialog::startImport()
+{
+    if (import_)
+        return;
+
+    QVariant var = comboPlatform_->currentData(Qt::UserRole);
+    if (!var.canConvert<lt::PlatformPtr>())
+        return;
+
+    auto platform = var.value<lt::PlatformPtr>();
+
+    catchWarning(
+        [&]() {
+            lt::ProjectPtr project = comboProject_->selectedProject();
+            if (!project)
+                return;
+
+            std::filesystem::path path(linePath_->text().toStdString());
+            std::vector<std::filesystem::path> paths;
+            if (std::filesystem::is_directory(path))
+            {
+                for (const auto & entry : std::filesystem::directory_iterator(path))
+                {
+                    if (entry.is_regular_file())
+                        paths.emplace_back(entry.path());
+                }
+                if (paths.empty())
+                    throw std::runtime_error("the directory does not contain any files");
+            }
+            else
+                paths.emplace_back(path);
+
+            progress_ = new QProgressDialog(tr("Importing ROMs..."), tr("Abort"), 0, 100, this);
+            progress_->setWindowModality(Qt::WindowModal);
+            progress_->setWindowTitle(tr("LibreTuner - Import ROM"));
+            progress_->setMinimumDuration(0);
+            progress_->setValue(0);
+
+            import_ = std::make_unique<lt::RomImport>(project, LT()->definitions(), platform);
+            finishedConnection_ = import_->onFinished([this]() {
+                QMetaObject::invokeMethod(this, [this]() { finishImport(); }, Qt::QueuedConnection);
+            });
+            // Progress is reported from worker threads; only the value
+            // crosses over, progress_ is read on the UI thread
+            progressConnection_ = import_->onProgress([this](double value) {
+                int percent = static_cast<int>(value * 100);
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, percent]() {
+                        if (progress_)
+                            progress_->setValue(percent);
+                    },
+                    Qt::QueuedConnection);
+            });
+            importJob_ = import_->start(std::move(paths), lineName_->text().toStdString());
+            connect(progress_, &QProgressDialog::canceled, this, [this]() {
+                if (importJob_)
+                    importJob_->cancel();
+            });
+        },
+        tr("Error importing ROM"));
+}
+
+void ImportRomDialog::finishImport()
+{
+    if (!import_)
+        return;
+
+    // Closing the progress dialog emits canceled()
+    bool canceled = importJob_->canceled();
+    importJob_.reset();
+    progressConnection_.reset();
+
+    progress_->close();
+    progress_->deleteLater();
+    progress_ = nullptr;
+
+    int imported = 0;
+    int duplicates = 0;
+    QStringList errors;
+    QStringList badChecksums;
+    for (const lt::ImportResult & result : import_->results())
+    {
+        QString file = QString::fromStdString(result.source.filename().string());
+        if (!result.ok())
+            errors.append(file + ": " + QString::fromStdString(result.error));
+        else if (!result.duplicateOf.empty())
+            ++duplicates;
+        else if (result.rom)
+        {
+            ++imported;
+            if (!result.checksumsValid)
+                badChecksums.append(file);
+        }
+    }
+
+    finishedConnection_.reset();
+    import_.reset();
+
+    QString summary = tr("Imported %1 ROM(s).").arg(imported);
+    if (duplicates != 0)
+        summary += " " + tr("Skipped %1 duplicate file(s).").arg(duplicates);
+    if (canceled)
+        summary += " " + tr("The import was aborted.");
+
+    QStringList details;
+    if (!badChecksums.isEmpty())
+        details.append(tr("Invalid checksums:") + "\n" + badChecksums.join("\n"));
+    if (!errors.isEmpty())
+        details.append(tr("Failed:") + "\n" + errors.join("\n"));
+
+    QMessageBox box(errors.isEmpty() ? QMessageBox::Information : QMessageBox::Warning,
+                    tr("LibreTuner - Import ROM"), summary, QMessageBox::Ok, this);
+    if (!details.isEmpty())
+        box.setDetailedText(details.join("\n\n"));
+    box.exec();
+
+    if (imported != 0)
+        accept();
 }
 
 void ImportRomDialog::platformChanged(int index) {}
@@ -5,20 +5,18 @@
 
 #include <memory>
 
+#include <lt/project/romimport.h>
+
 class QLineEdit;
 class QComboBox;
+class QProgressDialog;
 class ProjectCombo;
 
-namespace lt
-{
-    class Project;
-    using ProjectPtr = std::shared_ptr<Project>;
-}
-
 class ImportRomDialog : public QDialog
 {
 public:
     explicit ImportRomDialog(lt::ProjectPtr project = lt::ProjectPtr(), QWidget * parent = nullptr);
+    ~ImportRomDialog() override;
 
 public slots:
     void platformChanged(int index);
@@ -28,6 +26,19 @@ private:
     QLineEdit * linePath_;
     QComboBox * comboPlatform_;
     ProjectCombo * comboProject_;
+
+    // Running import. Imports run on the job pool so the window stays
+    // responsive.
+    std::unique_ptr<lt::RomImport> import_;
+    lt::JobPtr importJob_;
+    QProgressDialog * progress_{nullptr};
+    lt::RomImport::ProgressEvent::ConnectionPtr progressConnection_;
+    lt::RomImport::FinishedEvent::ConnectionPtr finishedConnection_;
+
+    // Imports the file or every file in the directory in the path field
+    void startImport();
+    // Reports the results of the finished import
+    void finishImport();
 };
 
 #endif // LIBRETUNER_IMPORTROMDIALOG_H